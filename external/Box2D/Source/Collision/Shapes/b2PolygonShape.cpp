@@ -202,6 +202,15 @@ b2PolygonShape::b2PolygonShape(const b2ShapeDef* def)
 	// Compute the oriented bounding box.
 	ComputeOBB(&m_obb, m_vertices, m_vertexCount);
 
+	// Four edges at right angles. The tolerance keeps the edge normals
+	// within 1e-4 radians of the OBB axes, so b2CollideBoxes can trust them.
+	m_isBox = m_vertexCount == 4;
+	for (int32 i = 0; i < m_vertexCount && m_isBox; ++i)
+	{
+		int32 i2 = i + 1 < m_vertexCount ? i + 1 : 0;
+		m_isBox = b2Abs(b2Dot(m_normals[i], m_normals[i2])) < 1.0e-4f;
+	}
+
 	// Create core polygon shape by shifting edges inward.
 	// Also compute the min/max radius for CCD.
 	for (int32 i = 0; i < m_vertexCount; ++i)
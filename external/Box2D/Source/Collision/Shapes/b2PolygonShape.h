@@ -79,6 +79,9 @@ public:
 	/// Get the oriented bounding box relative to the parent body.
 	const b2OBB& GetOBB() const;
 
+	/// Is this a rectangle? Its OBB is then the polygon itself.
+	bool IsBox() const;
+
 	/// Get local centroid relative to the parent body.
 	const b2Vec2& GetCentroid() const;
 
@@ -118,6 +121,7 @@ private:
 	b2Vec2 m_centroid;
 
 	b2OBB m_obb;
+	bool m_isBox;
 
 	b2Vec2 m_vertices[b2_maxPolygonVertices];
 	b2Vec2 m_normals[b2_maxPolygonVertices];
@@ -135,6 +139,11 @@ inline const b2OBB& b2PolygonShape::GetOBB() const
 	return m_obb;
 }
 
+inline bool b2PolygonShape::IsBox() const
+{
+	return m_isBox;
+}
+
 inline const b2Vec2& b2PolygonShape::GetCentroid() const
 {
 	return m_centroid;
@@ -96,19 +96,8 @@ void b2Shape::CreateProxy(b2BroadPhase* broadPhase, const b2XForm& transform)
 	b2AABB aabb;
 	ComputeAABB(&aabb, transform);
 
-	bool inRange = broadPhase->InRange(aabb);
-
-	// You are creating a shape outside the world box.
-	b2Assert(inRange);
-
-	if (inRange)
-	{
-		m_proxyId = broadPhase->CreateProxy(aabb, this);
-	}
-	else
-	{
-		m_proxyId = b2_nullProxy;
-	}
+	b2ProxyFilter filter(m_filter.categoryBits, m_filter.maskBits, m_filter.groupIndex);
+	m_proxyId = broadPhase->CreateProxy(aabb, this, filter);
 }
 
 void b2Shape::DestroyProxy(b2BroadPhase* broadPhase)
@@ -131,15 +120,13 @@ bool b2Shape::Synchronize(b2BroadPhase* broadPhase, const b2XForm& transform1, c
 	b2AABB aabb;
 	ComputeSweptAABB(&aabb, transform1, transform2);
 
-	if (broadPhase->InRange(aabb))
-	{
-		broadPhase->MoveProxy(m_proxyId, aabb);
-		return true;
-	}
-	else
+	if (broadPhase->InRange(aabb) == false)
 	{
 		return false;
 	}
+
+	broadPhase->MoveProxy(m_proxyId, aabb, transform2.position - transform1.position);
+	return true;
 }
 
 void b2Shape::RefilterProxy(b2BroadPhase* broadPhase, const b2XForm& transform)
@@ -154,14 +141,6 @@ void b2Shape::RefilterProxy(b2BroadPhase* broadPhase, const b2XForm& transform)
 	b2AABB aabb;
 	ComputeAABB(&aabb, transform);
 
-	bool inRange = broadPhase->InRange(aabb);
-
-	if (inRange)
-	{
-		m_proxyId = broadPhase->CreateProxy(aabb, this);
-	}
-	else
-	{
-		m_proxyId = b2_nullProxy;
-	}
+	b2ProxyFilter filter(m_filter.categoryBits, m_filter.maskBits, m_filter.groupIndex);
+	m_proxyId = broadPhase->CreateProxy(aabb, this, filter);
 }
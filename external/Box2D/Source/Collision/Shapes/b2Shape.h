@@ -219,7 +219,7 @@ protected:
 	float32 m_friction;
 	float32 m_restitution;
 
-	uint16 m_proxyId;
+	int32 m_proxyId;
 	b2FilterData m_filter;
 
 	bool m_isSensor;
@@ -20,127 +20,116 @@
 #define B2_BROAD_PHASE_H
 
 /*
-This broad phase uses the Sweep and Prune algorithm as described in:
-Collision Detection in Interactive 3D Environments by Gino van den Bergen
-Also, some ideas, such as using integral values for fast compares comes from
-Bullet (http:/www.bulletphysics.com).
+This broad phase keeps the proxies in a dynamic AABB tree (see b2DynamicTree).
+Proxies have fattened AABBs, so a moving shape only touches the tree when it
+leaves its fat AABB. Pairs are persistent and reported through b2PairCallback
+when the fat AABBs of two proxies start and stop overlapping. There is no
+limit on the number of proxies or pairs. The world boundary is optional,
+proxies that leave it are not moved (see InRange).
 */
 
 #include "../Common/b2Settings.h"
 #include "b2Collision.h"
+#include "b2DynamicTree.h"
 #include "b2PairManager.h"
-#include <climits>
 
-#ifdef TARGET_FLOAT32_IS_FIXED
-#define	B2BROADPHASE_MAX	(USHRT_MAX/2)
-#else
-#define	B2BROADPHASE_MAX	USHRT_MAX
-
-#endif
-
-const uint16 b2_invalid = B2BROADPHASE_MAX;
-const uint16 b2_nullEdge = B2BROADPHASE_MAX;
-struct b2BoundValues;
-
-struct b2Bound
+/// Collision filter of a proxy, see b2FilterData. Proxies only form a pair
+/// if their category and mask bits accept each other, or if they share a
+/// positive group.
+struct b2ProxyFilter
 {
-	bool IsLower() const { return (value & 1) == 0; }
-	bool IsUpper() const { return (value & 1) == 1; }
+	b2ProxyFilter(uint16 categoryBits = 0x0001, uint16 maskBits = 0xFFFF, int16 groupIndex = 0)
+		: categoryBits(categoryBits), maskBits(maskBits), groupIndex(groupIndex) {}
 
-	uint16 value;
-	uint16 proxyId;
-	uint16 stabbingCount;
-};
-
-struct b2Proxy
-{
-	uint16 GetNext() const { return lowerBounds[0]; }
-	void SetNext(uint16 next) { lowerBounds[0] = next; }
-	bool IsValid() const { return overlapCount != b2_invalid; }
-
-	uint16 lowerBounds[2], upperBounds[2];
-	uint16 overlapCount;
-	uint16 timeStamp;
-	void* userData;
+	uint16 categoryBits;
+	uint16 maskBits;
+	int16 groupIndex;
 };
 
 class b2BroadPhase
 {
 public:
-	b2BroadPhase(const b2AABB& worldAABB, b2PairCallback* callback);
+	b2BroadPhase(b2PairCallback* callback);
 	~b2BroadPhase();
 
-	// Use this to see if your proxy is in range. If it is not in range,
-	// it should be destroyed. Otherwise you may get O(m^2) pairs, where m
-	// is the number of proxies that are out of range.
-	bool InRange(const b2AABB& aabb) const;
-
-	// Create and destroy proxies. These call Flush first.
-	uint16 CreateProxy(const b2AABB& aabb, void* userData);
+	// Create and destroy proxies. New proxies are paired in the next Commit,
+	// destroying a proxy reports its pairs as removed right away.
+	int32 CreateProxy(const b2AABB& aabb, void* userData, const b2ProxyFilter& filter = b2ProxyFilter());
 	void DestroyProxy(int32 proxyId);
 
 	// Call MoveProxy as many times as you like, then when you are done
 	// call Commit to finalized the proxy pairs (for your time step).
-	void MoveProxy(int32 proxyId, const b2AABB& aabb);
+	// The displacement is used to stretch the fat AABB along the motion.
+	void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
 	void Commit();
 
-	// Get a single proxy. Returns NULL if the id is invalid.
-	b2Proxy* GetProxy(int32 proxyId);
+	// Get the user data of a proxy.
+	void* GetUserData(int32 proxyId) const;
+
+	// Get the fattened AABB of a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	// Set the world boundary, unbounded by default.
+	void SetWorldAABB(const b2AABB& worldAABB);
+
+	// Is the AABB inside the world boundary?
+	bool InRange(const b2AABB& aabb) const;
 
 	// Query an AABB for overlapping proxies, returns the user data and
 	// the count, up to the supplied maximum count.
 	int32 Query(const b2AABB& aabb, void** userData, int32 maxCount);
 
 	void Validate();
-	void ValidatePairs();
 
-private:
-	void ComputeBounds(uint16* lowerValues, uint16* upperValues, const b2AABB& aabb);
-
-	bool TestOverlap(b2Proxy* p1, b2Proxy* p2);
-	bool TestOverlap(const b2BoundValues& b, b2Proxy* p);
+	// Called by the tree while pairing a moved proxy.
+	bool QueryCallback(int32 proxyId);
 
-	void Query(int32* lowerIndex, int32* upperIndex, uint16 lowerValue, uint16 upperValue,
-				b2Bound* bounds, int32 boundCount, int32 axis);
-	void IncrementOverlapCount(int32 proxyId);
-	void IncrementTimeStamp();
+private:
+	void BufferMove(int32 proxyId);
+	void UnBufferMove(int32 proxyId);
+	bool ShouldPair(int32 proxyId1, int32 proxyId2) const;
 
 public:
 	friend class b2PairManager;
 
+	b2DynamicTree m_tree;
 	b2PairManager m_pairManager;
 
-	b2Proxy m_proxyPool[b2_maxProxies];
-	uint16 m_freeProxy;
+	int32 m_proxyCount;
 
-	b2Bound m_bounds[2][2*b2_maxProxies];
+	// Filter of each proxy, indexed by proxy id
+	b2ProxyFilter* m_filters;
+	int32 m_filterCapacity;
 
-	uint16 m_queryResults[b2_maxProxies];
-	int32 m_queryResultCount;
+	// Proxies created or re-inserted since the last Commit
+	int32* m_moveBuffer;
+	int32 m_moveCapacity;
+	int32 m_moveCount;
 
-	b2AABB m_worldAABB;
-	b2Vec2 m_quantizationFactor;
-	int32 m_proxyCount;
-	uint16 m_timeStamp;
+	int32 m_queryProxyId;
 
-	static bool s_validate;
+	b2AABB m_worldAABB;
 };
 
+inline void* b2BroadPhase::GetUserData(int32 proxyId) const
+{
+	return m_tree.GetUserData(proxyId);
+}
 
-inline bool b2BroadPhase::InRange(const b2AABB& aabb) const
+inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
-	b2Vec2 d = b2Max(aabb.lowerBound - m_worldAABB.upperBound, m_worldAABB.lowerBound - aabb.upperBound);
-	return b2Max(d.x, d.y) < 0.0f;
+	return m_tree.GetFatAABB(proxyId);
 }
 
-inline b2Proxy* b2BroadPhase::GetProxy(int32 proxyId)
+inline void b2BroadPhase::SetWorldAABB(const b2AABB& worldAABB)
 {
-	if (proxyId == b2_nullProxy || m_proxyPool[proxyId].IsValid() == false)
-	{
-		return NULL;
-	}
+	m_worldAABB = worldAABB;
+}
 
-	return m_proxyPool + proxyId;
+inline bool b2BroadPhase::InRange(const b2AABB& aabb) const
+{
+	return m_worldAABB.lowerBound.x <= aabb.lowerBound.x && m_worldAABB.lowerBound.y <= aabb.lowerBound.y &&
+		aabb.upperBound.x <= m_worldAABB.upperBound.x && aabb.upperBound.y <= m_worldAABB.upperBound.y;
 }
 
 #endif
@@ -59,15 +59,33 @@ static int32 ClipSegmentToLine(ClipVertex vOut[2], ClipVertex vIn[2],
 	return numOut;
 }
 
+// The routines below take the vertex count of both polygons as a template
+// argument. Zero means any polygon; b2CollideBoxes uses 4, which turns the
+// support and incident edge searches into fixed loops the compiler unrolls.
+// The arithmetic is the same for every count, so are the manifolds.
+template <int32 N>
+inline int32 GetVertexCount(const b2PolygonShape* poly)
+{
+	B2_NOT_USED(poly);
+	return N;
+}
+
+template <>
+inline int32 GetVertexCount<0>(const b2PolygonShape* poly)
+{
+	return poly->GetVertexCount();
+}
+
 // Find the separation between poly1 and poly2 for a give edge normal on poly1.
+template <int32 N>
 static float32 EdgeSeparation(const b2PolygonShape* poly1, const b2XForm& xf1, int32 edge1,
 							  const b2PolygonShape* poly2, const b2XForm& xf2)
 {
-	int32 count1 = poly1->GetVertexCount();
+	int32 count1 = GetVertexCount<N>(poly1);
 	const b2Vec2* vertices1 = poly1->GetVertices();
 	const b2Vec2* normals1 = poly1->GetNormals();
 
-	int32 count2 = poly2->GetVertexCount();
+	int32 count2 = GetVertexCount<N>(poly2);
 	const b2Vec2* vertices2 = poly2->GetVertices();
 
 	b2Assert(0 <= edge1 && edge1 < count1);
@@ -97,11 +115,12 @@ static float32 EdgeSeparation(const b2PolygonShape* poly1, const b2XForm& xf1, i
 }
 
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
+template <int32 N>
 static float32 FindMaxSeparation(int32* edgeIndex,
 								 const b2PolygonShape* poly1, const b2XForm& xf1,
 								 const b2PolygonShape* poly2, const b2XForm& xf2)
 {
-	int32 count1 = poly1->GetVertexCount();
+	int32 count1 = GetVertexCount<N>(poly1);
 	const b2Vec2* normals1 = poly1->GetNormals();
 
 	// Vector pointing from the centroid of poly1 to the centroid of poly2.
@@ -122,7 +141,7 @@ static float32 FindMaxSeparation(int32* edgeIndex,
 	}
 
 	// Get the separation for the edge normal.
-	float32 s = EdgeSeparation(poly1, xf1, edge, poly2, xf2);
+	float32 s = EdgeSeparation<N>(poly1, xf1, edge, poly2, xf2);
 	if (s > 0.0f)
 	{
 		return s;
@@ -130,7 +149,7 @@ static float32 FindMaxSeparation(int32* edgeIndex,
 
 	// Check the separation for the previous edge normal.
 	int32 prevEdge = edge - 1 >= 0 ? edge - 1 : count1 - 1;
-	float32 sPrev = EdgeSeparation(poly1, xf1, prevEdge, poly2, xf2);
+	float32 sPrev = EdgeSeparation<N>(poly1, xf1, prevEdge, poly2, xf2);
 	if (sPrev > 0.0f)
 	{
 		return sPrev;
@@ -138,7 +157,7 @@ static float32 FindMaxSeparation(int32* edgeIndex,
 
 	// Check the separation for the next edge normal.
 	int32 nextEdge = edge + 1 < count1 ? edge + 1 : 0;
-	float32 sNext = EdgeSeparation(poly1, xf1, nextEdge, poly2, xf2);
+	float32 sNext = EdgeSeparation<N>(poly1, xf1, nextEdge, poly2, xf2);
 	if (sNext > 0.0f)
 	{
 		return sNext;
@@ -174,7 +193,7 @@ static float32 FindMaxSeparation(int32* edgeIndex,
 		else
 			edge = bestEdge + 1 < count1 ? bestEdge + 1 : 0;
 
-		s = EdgeSeparation(poly1, xf1, edge, poly2, xf2);
+		s = EdgeSeparation<N>(poly1, xf1, edge, poly2, xf2);
 		if (s > 0.0f)
 		{
 			return s;
@@ -195,14 +214,15 @@ static float32 FindMaxSeparation(int32* edgeIndex,
 	return bestSeparation;
 }
 
+template <int32 N>
 static void FindIncidentEdge(ClipVertex c[2],
 							 const b2PolygonShape* poly1, const b2XForm& xf1, int32 edge1,
 							 const b2PolygonShape* poly2, const b2XForm& xf2)
 {
-	int32 count1 = poly1->GetVertexCount();
+	int32 count1 = GetVertexCount<N>(poly1);
 	const b2Vec2* normals1 = poly1->GetNormals();
 
-	int32 count2 = poly2->GetVertexCount();
+	int32 count2 = GetVertexCount<N>(poly2);
 	const b2Vec2* vertices2 = poly2->GetVertices();
 	const b2Vec2* normals2 = poly2->GetNormals();
 
@@ -246,19 +266,20 @@ static void FindIncidentEdge(ClipVertex c[2],
 // Clip
 
 // The normal points from 1 to 2
-void b2CollidePolygons(b2Manifold* manifold,
-					  const b2PolygonShape* polyA, const b2XForm& xfA,
-					  const b2PolygonShape* polyB, const b2XForm& xfB)
+template <int32 N>
+static void CollidePolygons(b2Manifold* manifold,
+							const b2PolygonShape* polyA, const b2XForm& xfA,
+							const b2PolygonShape* polyB, const b2XForm& xfB)
 {
 	manifold->pointCount = 0;
 
 	int32 edgeA = 0;
-	float32 separationA = FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
+	float32 separationA = FindMaxSeparation<N>(&edgeA, polyA, xfA, polyB, xfB);
 	if (separationA > 0.0f)
 		return;
 
 	int32 edgeB = 0;
-	float32 separationB = FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
+	float32 separationB = FindMaxSeparation<N>(&edgeB, polyB, xfB, polyA, xfA);
 	if (separationB > 0.0f)
 		return;
 
@@ -291,9 +312,9 @@ void b2CollidePolygons(b2Manifold* manifold,
 	}
 
 	ClipVertex incidentEdge[2];
-	FindIncidentEdge(incidentEdge, poly1, xf1, edge1, poly2, xf2);
+	FindIncidentEdge<N>(incidentEdge, poly1, xf1, edge1, poly2, xf2);
 
-	int32 count1 = poly1->GetVertexCount();
+	int32 count1 = GetVertexCount<N>(poly1);
 	const b2Vec2* vertices1 = poly1->GetVertices();
 
 	b2Vec2 v11 = vertices1[edge1];
@@ -350,3 +371,63 @@ void b2CollidePolygons(b2Manifold* manifold,
 
 	manifold->pointCount = pointCount;
 }
+
+void b2CollidePolygons(b2Manifold* manifold,
+					  const b2PolygonShape* polyA, const b2XForm& xfA,
+					  const b2PolygonShape* polyB, const b2XForm& xfB)
+{
+	CollidePolygons<0>(manifold, polyA, xfA, polyB, xfB);
+}
+
+// Separating axis test of the two oriented bounding boxes, which for boxes
+// are the shapes themselves. CollidePolygons finds every axis this test
+// finds, so rejecting only gaps wider than the slop can't change a manifold.
+static bool TestOBBSeparation(const b2PolygonShape* boxA, const b2XForm& xfA,
+							  const b2PolygonShape* boxB, const b2XForm& xfB)
+{
+	const b2OBB& obbA = boxA->GetOBB();
+	const b2OBB& obbB = boxB->GetOBB();
+
+	b2Mat22 RA = b2Mul(xfA.R, obbA.R);
+	b2Mat22 RB = b2Mul(xfB.R, obbB.R);
+
+	// B's axes and the distance between the centers in A's frame.
+	b2Mat22 C = b2MulT(RA, RB);
+	b2Mat22 absC = b2Abs(C);
+	b2Vec2 d = b2Mul(xfB, obbB.center) - b2Mul(xfA, obbA.center);
+	b2Vec2 dA = b2MulT(RA, d);
+
+	const float32 margin = b2_linearSlop;
+
+	// A's axes.
+	b2Vec2 extentsA = obbA.extents + b2Mul(absC, obbB.extents);
+	if (b2Abs(dA.x) > extentsA.x + margin || b2Abs(dA.y) > extentsA.y + margin)
+	{
+		return true;
+	}
+
+	// B's axes.
+	b2Vec2 dB = b2MulT(C, dA);
+	b2Vec2 extentsB = obbB.extents + b2MulT(absC, obbA.extents);
+	if (b2Abs(dB.x) > extentsB.x + margin || b2Abs(dB.y) > extentsB.y + margin)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+void b2CollideBoxes(b2Manifold* manifold,
+					const b2PolygonShape* boxA, const b2XForm& xfA,
+					const b2PolygonShape* boxB, const b2XForm& xfB)
+{
+	b2Assert(boxA->IsBox() && boxB->IsBox());
+
+	if (TestOBBSeparation(boxA, xfA, boxB, xfB))
+	{
+		manifold->pointCount = 0;
+		return;
+	}
+
+	CollidePolygons<4>(manifold, boxA, xfA, boxB, xfB);
+}
@@ -85,6 +85,15 @@ struct b2AABB
 	/// Verify that the bounds are sorted.
 	bool IsValid() const;
 
+	/// Get the perimeter length (the cost metric of the dynamic tree).
+	float32 GetPerimeter() const;
+
+	/// Combine two AABBs into this one.
+	void Combine(const b2AABB& aabb1, const b2AABB& aabb2);
+
+	/// Does this AABB contain the provided AABB?
+	bool Contains(const b2AABB& aabb) const;
+
 	b2Vec2 lowerBound;	///< the lower vertex
 	b2Vec2 upperBound;	///< the upper vertex
 };
@@ -107,11 +116,18 @@ void b2CollidePolygonAndCircle(b2Manifold* manifold,
 							   const b2PolygonShape* polygon, const b2XForm& xf1,
 							   const b2CircleShape* circle, const b2XForm& xf2);
 
-/// Compute the collision manifold between two circles.
+/// Compute the collision manifold between two polygons.
 void b2CollidePolygons(b2Manifold* manifold,
 					   const b2PolygonShape* polygon1, const b2XForm& xf1,
 					   const b2PolygonShape* polygon2, const b2XForm& xf2);
 
+/// Compute the collision manifold between two boxes, see b2PolygonShape::IsBox.
+/// The manifold is the same as from b2CollidePolygons, but boxes that are
+/// clearly apart are rejected by their oriented bounding boxes first.
+void b2CollideBoxes(b2Manifold* manifold,
+					const b2PolygonShape* box1, const b2XForm& xf1,
+					const b2PolygonShape* box2, const b2XForm& xf2);
+
 /// Compute the distance between two shapes and the closest points.
 /// @return the distance between the shapes or zero if they are overlapped/touching.
 float32 b2Distance(b2Vec2* x1, b2Vec2* x2,
@@ -136,6 +152,27 @@ inline bool b2AABB::IsValid() const
 	return valid;
 }
 
+inline float32 b2AABB::GetPerimeter() const
+{
+	float32 wx = upperBound.x - lowerBound.x;
+	float32 wy = upperBound.y - lowerBound.y;
+	return 2.0f * (wx + wy);
+}
+
+inline void b2AABB::Combine(const b2AABB& aabb1, const b2AABB& aabb2)
+{
+	lowerBound = b2Min(aabb1.lowerBound, aabb2.lowerBound);
+	upperBound = b2Max(aabb1.upperBound, aabb2.upperBound);
+}
+
+inline bool b2AABB::Contains(const b2AABB& aabb) const
+{
+	return lowerBound.x <= aabb.lowerBound.x
+		&& lowerBound.y <= aabb.lowerBound.y
+		&& aabb.upperBound.x <= upperBound.x
+		&& aabb.upperBound.y <= upperBound.y;
+}
+
 inline bool b2TestOverlap(const b2AABB& a, const b2AABB& b)
 {
 	b2Vec2 d1, d2;
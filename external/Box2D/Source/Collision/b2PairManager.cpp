@@ -20,12 +20,12 @@
 #include "b2BroadPhase.h"
 
 #include <algorithm>
+#include <cstring>
 
 // Thomas Wang's hash, see: http://www.concentric.net/~Ttwang/tech/inthash.htm
-// This assumes proxyId1 and proxyId2 are 16-bit.
 inline uint32 Hash(uint32 proxyId1, uint32 proxyId2)
 {
-	uint32 key = (proxyId2 << 16) | proxyId1;
+	uint32 key = (proxyId2 * 2654435761u) ^ proxyId1;
 	key = ~key + (key << 15);
 	key = key ^ (key >> 12);
 	key = key + (key << 2);
@@ -61,27 +61,60 @@ inline bool operator < (const b2BufferedPair& pair1, const b2BufferedPair& pair2
 	return false;
 }
 
+// Sort a buffer and drop duplicates, returns the new count.
+static int32 SortUnique(b2BufferedPair* buffer, int32 count)
+{
+	std::sort(buffer, buffer + count);
+
+	int32 unique = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (unique == 0 || Equals(buffer[unique - 1], buffer[i]) == false)
+		{
+			buffer[unique++] = buffer[i];
+		}
+	}
+
+	return unique;
+}
+
 
 b2PairManager::b2PairManager()
 {
-	b2Assert(b2IsPowerOfTwo(b2_tableCapacity) == true);
-	b2Assert(b2_tableCapacity >= b2_maxPairs);
-	for (int32 i = 0; i < b2_tableCapacity; ++i)
+	m_broadPhase = NULL;
+	m_callback = NULL;
+
+	m_pairs = NULL;
+	m_pairCapacity = 0;
+	m_freePair = b2_nullPair;
+	m_pairCount = 0;
+
+	m_tableCapacity = 64;
+	m_hashTable = (int32*)b2Alloc(m_tableCapacity * sizeof(int32));
+	for (int32 i = 0; i < m_tableCapacity; ++i)
 	{
 		m_hashTable[i] = b2_nullPair;
 	}
-	m_freePair = 0;
-	for (int32 i = 0; i < b2_maxPairs; ++i)
-	{
-		m_pairs[i].proxyId1 = b2_nullProxy;
-		m_pairs[i].proxyId2 = b2_nullProxy;
-		m_pairs[i].userData = NULL;
-		m_pairs[i].status = 0;
-		m_pairs[i].next = uint16(i + 1);
-	}
-	m_pairs[b2_maxPairs-1].next = b2_nullPair;
-	m_pairCount = 0;
-	m_pairBufferCount = 0;
+
+	m_proxyPairs = NULL;
+	m_proxyCapacity = 0;
+
+	m_addBuffer = NULL;
+	m_addCount = 0;
+	m_addCapacity = 0;
+
+	m_removeBuffer = NULL;
+	m_removeCount = 0;
+	m_removeCapacity = 0;
+}
+
+b2PairManager::~b2PairManager()
+{
+	b2Free(m_pairs);
+	b2Free(m_hashTable);
+	b2Free(m_proxyPairs);
+	b2Free(m_addBuffer);
+	b2Free(m_removeBuffer);
 }
 
 void b2PairManager::Initialize(b2BroadPhase* broadPhase, b2PairCallback* callback)
@@ -90,6 +123,99 @@ void b2PairManager::Initialize(b2BroadPhase* broadPhase, b2PairCallback* callbac
 	m_callback = callback;
 }
 
+void b2PairManager::GrowPairs()
+{
+	b2Assert(m_freePair == b2_nullPair);
+
+	int32 capacity = b2Max(2 * m_pairCapacity, 64);
+	b2Pair* pairs = (b2Pair*)b2Alloc(capacity * sizeof(b2Pair));
+	if (m_pairs)
+	{
+		memcpy(pairs, m_pairs, m_pairCapacity * sizeof(b2Pair));
+		b2Free(m_pairs);
+	}
+
+	for (int32 i = m_pairCapacity; i < capacity; ++i)
+	{
+		pairs[i].userData = NULL;
+		pairs[i].proxyId1 = b2_nullProxy;
+		pairs[i].proxyId2 = b2_nullProxy;
+		pairs[i].next = (i + 1 < capacity) ? i + 1 : b2_nullPair;
+		pairs[i].next1 = b2_nullPair;
+		pairs[i].next2 = b2_nullPair;
+	}
+
+	m_freePair = m_pairCapacity;
+	m_pairs = pairs;
+	m_pairCapacity = capacity;
+}
+
+void b2PairManager::GrowTable()
+{
+	b2Free(m_hashTable);
+
+	m_tableCapacity *= 2;
+	m_hashTable = (int32*)b2Alloc(m_tableCapacity * sizeof(int32));
+	for (int32 i = 0; i < m_tableCapacity; ++i)
+	{
+		m_hashTable[i] = b2_nullPair;
+	}
+
+	int32 mask = m_tableCapacity - 1;
+	for (int32 i = 0; i < m_pairCapacity; ++i)
+	{
+		b2Pair* pair = m_pairs + i;
+		if (pair->proxyId1 == b2_nullProxy)
+		{
+			continue;
+		}
+
+		int32 hash = Hash(pair->proxyId1, pair->proxyId2) & mask;
+		pair->next = m_hashTable[hash];
+		m_hashTable[hash] = i;
+	}
+}
+
+void b2PairManager::AddProxy(int32 proxyId)
+{
+	if (proxyId >= m_proxyCapacity)
+	{
+		int32 capacity = b2Max(2 * m_proxyCapacity, b2Max(proxyId + 1, 64));
+		int32* proxyPairs = (int32*)b2Alloc(capacity * sizeof(int32));
+		if (m_proxyPairs)
+		{
+			memcpy(proxyPairs, m_proxyPairs, m_proxyCapacity * sizeof(int32));
+			b2Free(m_proxyPairs);
+		}
+
+		for (int32 i = m_proxyCapacity; i < capacity; ++i)
+		{
+			proxyPairs[i] = b2_nullPair;
+		}
+
+		m_proxyPairs = proxyPairs;
+		m_proxyCapacity = capacity;
+	}
+
+	b2Assert(m_proxyPairs[proxyId] == b2_nullPair);
+	m_proxyPairs[proxyId] = b2_nullPair;
+}
+
+void b2PairManager::RemoveProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+
+	while (m_proxyPairs[proxyId] != b2_nullPair)
+	{
+		b2Pair* pair = m_pairs + m_proxyPairs[proxyId];
+		int32 id1 = pair->proxyId1;
+		int32 id2 = pair->proxyId2;
+
+		void* userData = RemovePair(id1, id2);
+		m_callback->PairRemoved(m_broadPhase->GetUserData(id1), m_broadPhase->GetUserData(id2), userData);
+	}
+}
+
 b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2, uint32 hash)
 {
 	int32 index = m_hashTable[hash];
@@ -104,7 +230,7 @@ b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2, uint32 hash)
 		return NULL;
 	}
 
-	b2Assert(index < b2_maxPairs);
+	b2Assert(index < m_pairCapacity);
 
 	return m_pairs + index;
 }
@@ -113,7 +239,7 @@ b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2)
 {
 	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	int32 hash = Hash(proxyId1, proxyId2) & (m_tableCapacity - 1);
 
 	return Find(proxyId1, proxyId2, hash);
 }
@@ -123,7 +249,7 @@ b2Pair* b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
 {
 	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	int32 hash = Hash(proxyId1, proxyId2) & (m_tableCapacity - 1);
 
 	b2Pair* pair = Find(proxyId1, proxyId2, hash);
 	if (pair != NULL)
@@ -131,26 +257,50 @@ b2Pair* b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
 		return pair;
 	}
 
-	b2Assert(m_pairCount < b2_maxPairs);
-	b2Assert(m_freePair != b2_nullPair);
+	if (m_freePair == b2_nullPair)
+	{
+		GrowPairs();
+	}
 
-	uint16 pairIndex = m_freePair;
+	int32 pairIndex = m_freePair;
 	pair = m_pairs + pairIndex;
 	m_freePair = pair->next;
 
-	pair->proxyId1 = (uint16)proxyId1;
-	pair->proxyId2 = (uint16)proxyId2;
-	pair->status = 0;
+	pair->proxyId1 = proxyId1;
+	pair->proxyId2 = proxyId2;
 	pair->userData = NULL;
 	pair->next = m_hashTable[hash];
-
 	m_hashTable[hash] = pairIndex;
 
+	pair->next1 = m_proxyPairs[proxyId1];
+	m_proxyPairs[proxyId1] = pairIndex;
+	pair->next2 = m_proxyPairs[proxyId2];
+	m_proxyPairs[proxyId2] = pairIndex;
+
 	++m_pairCount;
 
+	// Keep the load factor at or below one
+	if (m_pairCount > m_tableCapacity)
+	{
+		GrowTable();
+	}
+
 	return pair;
 }
 
+void b2PairManager::Unlink(int32 proxyId, int32 pairIndex)
+{
+	int32* link = m_proxyPairs + proxyId;
+	while (*link != pairIndex)
+	{
+		b2Assert(*link != b2_nullPair);
+		b2Pair* pair = m_pairs + *link;
+		link = (pair->proxyId1 == proxyId) ? &pair->next1 : &pair->next2;
+	}
+
+	*link = m_pairs[pairIndex].GetNext(proxyId);
+}
+
 // Removes a pair. The pair must exist.
 void* b2PairManager::RemovePair(int32 proxyId1, int32 proxyId2)
 {
@@ -158,17 +308,20 @@ void* b2PairManager::RemovePair(int32 proxyId1, int32 proxyId2)
 
 	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	int32 hash = Hash(proxyId1, proxyId2) & (m_tableCapacity - 1);
 
-	uint16* node = &m_hashTable[hash];
+	int32* node = m_hashTable + hash;
 	while (*node != b2_nullPair)
 	{
 		if (Equals(m_pairs[*node], proxyId1, proxyId2))
 		{
-			uint16 index = *node;
-			*node = m_pairs[*node].next;
-			
+			int32 index = *node;
 			b2Pair* pair = m_pairs + index;
+			*node = pair->next;
+
+			Unlink(proxyId1, index);
+			Unlink(proxyId2, index);
+
 			void* userData = pair->userData;
 
 			// Scrub
@@ -176,7 +329,8 @@ void* b2PairManager::RemovePair(int32 proxyId1, int32 proxyId2)
 			pair->proxyId1 = b2_nullProxy;
 			pair->proxyId2 = b2_nullProxy;
 			pair->userData = NULL;
-			pair->status = 0;
+			pair->next1 = b2_nullPair;
+			pair->next2 = b2_nullPair;
 
 			m_freePair = index;
 			--m_pairCount;
@@ -192,206 +346,88 @@ void* b2PairManager::RemovePair(int32 proxyId1, int32 proxyId2)
 	return NULL;
 }
 
-/*
-As proxies are created and moved, many pairs are created and destroyed. Even worse, the same
-pair may be added and removed multiple times in a single time step of the physics engine. To reduce
-traffic in the pair manager, we try to avoid destroying pairs in the pair manager until the
-end of the physics step. This is done by buffering all the RemovePair requests. AddPair
-requests are processed immediately because we need the hash table entry for quick lookup.
-
-All user user callbacks are delayed until the buffered pairs are confirmed in Commit.
-This is very important because the user callbacks may be very expensive and client logic
-may be harmed if pairs are added and removed within the same time step.
-
-Buffer a pair for addition.
-We may add a pair that is not in the pair manager or pair buffer.
-We may add a pair that is already in the pair manager and pair buffer.
-If the added pair is not a new pair, then it must be in the pair buffer (because RemovePair was called).
-*/
-void b2PairManager::AddBufferedPair(int32 id1, int32 id2)
+void b2PairManager::Buffer(b2BufferedPair*& buffer, int32& count, int32& capacity, int32 proxyId1, int32 proxyId2)
 {
-	b2Assert(id1 != b2_nullProxy && id2 != b2_nullProxy);
-	b2Assert(m_pairBufferCount < b2_maxPairs);
-
-	b2Pair* pair = AddPair(id1, id2);
-
-	// If this pair is not in the pair buffer ...
-	if (pair->IsBuffered() == false)
+	if (count == capacity)
 	{
-		// This must be a newly added pair.
-		b2Assert(pair->IsFinal() == false);
-
-		// Add it to the pair buffer.
-		pair->SetBuffered();
-		m_pairBuffer[m_pairBufferCount].proxyId1 = pair->proxyId1;
-		m_pairBuffer[m_pairBufferCount].proxyId2 = pair->proxyId2;
-		++m_pairBufferCount;
-
-		b2Assert(m_pairBufferCount <= m_pairCount);
+		capacity = b2Max(2 * capacity, 64);
+		b2BufferedPair* old = buffer;
+		buffer = (b2BufferedPair*)b2Alloc(capacity * sizeof(b2BufferedPair));
+		if (old)
+		{
+			memcpy(buffer, old, count * sizeof(b2BufferedPair));
+			b2Free(old);
+		}
 	}
 
-	// Confirm this pair for the subsequent call to Commit.
-	pair->ClearRemoved();
+	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	if (b2BroadPhase::s_validate)
-	{
-		ValidateBuffer();
-	}
+	buffer[count].proxyId1 = proxyId1;
+	buffer[count].proxyId2 = proxyId2;
+	++count;
 }
 
-// Buffer a pair for removal.
-void b2PairManager::RemoveBufferedPair(int32 id1, int32 id2)
+/*
+As in the sweep and prune pair manager, user callbacks are delayed until
+the buffered pairs are confirmed in Commit. Pairs may be buffered more than
+once (both proxies moved), duplicates are dropped there.
+*/
+void b2PairManager::AddBufferedPair(int32 id1, int32 id2)
 {
 	b2Assert(id1 != b2_nullProxy && id2 != b2_nullProxy);
-	b2Assert(m_pairBufferCount < b2_maxPairs);
-
-	b2Pair* pair = Find(id1, id2);
+	b2Assert(id1 != id2);
 
-	if (pair == NULL)
+	// Most queries find pairs that already exist, keep them out of the sort.
+	if (Find(id1, id2) != NULL)
 	{
-		// The pair never existed. This is legal (due to collision filtering).
 		return;
 	}
 
-	// If this pair is not in the pair buffer ...
-	if (pair->IsBuffered() == false)
-	{
-		// This must be an old pair.
-		b2Assert(pair->IsFinal() == true);
-
-		pair->SetBuffered();
-		m_pairBuffer[m_pairBufferCount].proxyId1 = pair->proxyId1;
-		m_pairBuffer[m_pairBufferCount].proxyId2 = pair->proxyId2;
-		++m_pairBufferCount;
-
-		b2Assert(m_pairBufferCount <= m_pairCount);
-	}
-
-	pair->SetRemoved();
-
-	if (b2BroadPhase::s_validate)
-	{
-		ValidateBuffer();
-	}
+	Buffer(m_addBuffer, m_addCount, m_addCapacity, id1, id2);
 }
 
-void b2PairManager::Commit()
+void b2PairManager::RemoveStalePairs(int32 proxyId)
 {
-	int32 removeCount = 0;
-
-	b2Proxy* proxies = m_broadPhase->m_proxyPool;
+	const b2AABB& aabb = m_broadPhase->GetFatAABB(proxyId);
 
-	for (int32 i = 0; i < m_pairBufferCount; ++i)
+	for (int32 index = m_proxyPairs[proxyId]; index != b2_nullPair; index = m_pairs[index].GetNext(proxyId))
 	{
-		b2Pair* pair = Find(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
-		b2Assert(pair->IsBuffered());
-		pair->ClearBuffered();
-
-		b2Assert(pair->proxyId1 < b2_maxProxies && pair->proxyId2 < b2_maxProxies);
-
-		b2Proxy* proxy1 = proxies + pair->proxyId1;
-		b2Proxy* proxy2 = proxies + pair->proxyId2;
-
-		b2Assert(proxy1->IsValid());
-		b2Assert(proxy2->IsValid());
+		const b2Pair* pair = m_pairs + index;
+		int32 other = (pair->proxyId1 == proxyId) ? pair->proxyId2 : pair->proxyId1;
 
-		if (pair->IsRemoved())
+		if (b2TestOverlap(aabb, m_broadPhase->GetFatAABB(other)) == false)
 		{
-			// It is possible a pair was added then removed before a commit. Therefore,
-			// we should be careful not to tell the user the pair was removed when the
-			// the user didn't receive a matching add.
-			if (pair->IsFinal() == true)
-			{
-				m_callback->PairRemoved(proxy1->userData, proxy2->userData, pair->userData);
-			}
-
-			// Store the ids so we can actually remove the pair below.
-			m_pairBuffer[removeCount].proxyId1 = pair->proxyId1;
-			m_pairBuffer[removeCount].proxyId2 = pair->proxyId2;
-			++removeCount;
-		}
-		else
-		{
-			b2Assert(m_broadPhase->TestOverlap(proxy1, proxy2) == true);
-
-			if (pair->IsFinal() == false)
-			{
-				pair->userData = m_callback->PairAdded(proxy1->userData, proxy2->userData);
-				pair->SetFinal();
-			}
+			Buffer(m_removeBuffer, m_removeCount, m_removeCapacity, pair->proxyId1, pair->proxyId2);
 		}
 	}
-
-	for (int32 i = 0; i < removeCount; ++i)
-	{
-		RemovePair(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
-	}
-
-	m_pairBufferCount = 0;
-
-	if (b2BroadPhase::s_validate)
-	{
-		ValidateTable();
-	}
 }
 
-void b2PairManager::ValidateBuffer()
+void b2PairManager::Commit()
 {
-#ifdef _DEBUG
-	b2Assert(m_pairBufferCount <= m_pairCount);
-
-	std::sort(m_pairBuffer, m_pairBuffer + m_pairBufferCount);
-
-	for (int32 i = 0; i < m_pairBufferCount; ++i)
+	m_removeCount = SortUnique(m_removeBuffer, m_removeCount);
+	for (int32 i = 0; i < m_removeCount; ++i)
 	{
-		if (i > 0)
-		{
-			b2Assert(Equals(m_pairBuffer[i], m_pairBuffer[i-1]) == false);
-		}
-
-		b2Pair* pair = Find(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
-		b2Assert(pair->IsBuffered());
+		int32 id1 = m_removeBuffer[i].proxyId1;
+		int32 id2 = m_removeBuffer[i].proxyId2;
 
-		b2Assert(pair->proxyId1 != pair->proxyId2);
-		b2Assert(pair->proxyId1 < b2_maxProxies);
-		b2Assert(pair->proxyId2 < b2_maxProxies);
-
-		b2Proxy* proxy1 = m_broadPhase->m_proxyPool + pair->proxyId1;
-		b2Proxy* proxy2 = m_broadPhase->m_proxyPool + pair->proxyId2;
-
-		b2Assert(proxy1->IsValid() == true);
-		b2Assert(proxy2->IsValid() == true);
+		void* userData = RemovePair(id1, id2);
+		m_callback->PairRemoved(m_broadPhase->GetUserData(id1), m_broadPhase->GetUserData(id2), userData);
 	}
-#endif
-}
+	m_removeCount = 0;
 
-void b2PairManager::ValidateTable()
-{
-#ifdef _DEBUG
-	for (int32 i = 0; i < b2_tableCapacity; ++i)
+	m_addCount = SortUnique(m_addBuffer, m_addCount);
+	for (int32 i = 0; i < m_addCount; ++i)
 	{
-		uint16 index = m_hashTable[i];
-		while (index != b2_nullPair)
-		{
-			b2Pair* pair = m_pairs + index;
-			b2Assert(pair->IsBuffered() == false);
-			b2Assert(pair->IsFinal() == true);
-			b2Assert(pair->IsRemoved() == false);
-
-			b2Assert(pair->proxyId1 != pair->proxyId2);
-			b2Assert(pair->proxyId1 < b2_maxProxies);
-			b2Assert(pair->proxyId2 < b2_maxProxies);
-
-			b2Proxy* proxy1 = m_broadPhase->m_proxyPool + pair->proxyId1;
-			b2Proxy* proxy2 = m_broadPhase->m_proxyPool + pair->proxyId2;
+		int32 id1 = m_addBuffer[i].proxyId1;
+		int32 id2 = m_addBuffer[i].proxyId2;
 
-			b2Assert(proxy1->IsValid() == true);
-			b2Assert(proxy2->IsValid() == true);
-
-			b2Assert(m_broadPhase->TestOverlap(proxy1, proxy2) == true);
-
-			index = pair->next;
+		if (Find(id1, id2) != NULL)
+		{
+			continue;
 		}
+
+		b2Pair* pair = AddPair(id1, id2);
+		pair->userData = m_callback->PairAdded(m_broadPhase->GetUserData(id1), m_broadPhase->GetUserData(id2));
 	}
-#endif
+	m_addCount = 0;
 }
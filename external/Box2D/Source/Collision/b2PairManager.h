@@ -17,8 +17,9 @@
 */
 
 // The pair manager is used by the broad-phase to quickly add/remove/find pairs
-// of overlapping proxies. It is based closely on code provided by Pierre Terdiman.
-// http://www.codercorner.com/IncrementalSAP.txt
+// of overlapping proxies. Pairs live in a growable pool, are found through a
+// growable hash table and are threaded into a list per proxy, so there is no
+// fixed capacity and all pairs of a proxy can be visited without a full scan.
 
 #ifndef B2_PAIR_MANAGER_H
 #define B2_PAIR_MANAGER_H
@@ -26,47 +27,27 @@
 #include "../Common/b2Settings.h"
 #include "../Common/b2Math.h"
 
-#include <climits>
-
 class b2BroadPhase;
-struct b2Proxy;
 
-const uint16 b2_nullPair = USHRT_MAX;
-const uint16 b2_nullProxy = USHRT_MAX;
-const int32 b2_tableCapacity = b2_maxPairs;	// must be a power of two
-const int32 b2_tableMask = b2_tableCapacity - 1;
+const int32 b2_nullPair = -1;
+const int32 b2_nullProxy = -1;
 
 struct b2Pair
 {
-	enum
-	{
-		e_pairBuffered	= 0x0001,
-		e_pairRemoved	= 0x0002,
-		e_pairFinal		= 0x0004,
-	};
-
-	void SetBuffered()		{ status |= e_pairBuffered; }
-	void ClearBuffered()	{ status &= ~e_pairBuffered; }
-	bool IsBuffered()		{ return (status & e_pairBuffered) == e_pairBuffered; }
-
-	void SetRemoved()		{ status |= e_pairRemoved; }
-	void ClearRemoved()		{ status &= ~e_pairRemoved; }
-	bool IsRemoved()		{ return (status & e_pairRemoved) == e_pairRemoved; }
-
-	void SetFinal()		{ status |= e_pairFinal; }
-	bool IsFinal()		{ return (status & e_pairFinal) == e_pairFinal; }
+	int32 GetNext(int32 proxyId) const { return proxyId == proxyId1 ? next1 : next2; }
 
 	void* userData;
-	uint16 proxyId1;
-	uint16 proxyId2;
-	uint16 next;
-	uint16 status;
+	int32 proxyId1;
+	int32 proxyId2;
+	int32 next;		// hash chain (or free list)
+	int32 next1;	// next pair of proxyId1
+	int32 next2;	// next pair of proxyId2
 };
 
 struct b2BufferedPair
 {
-	uint16 proxyId1;
-	uint16 proxyId2;
+	int32 proxyId1;
+	int32 proxyId2;
 };
 
 class b2PairCallback
@@ -87,35 +68,61 @@ class b2PairManager
 {
 public:
 	b2PairManager();
+	~b2PairManager();
 
 	void Initialize(b2BroadPhase* broadPhase, b2PairCallback* callback);
 
+	// Make room for the pair list of a new proxy.
+	void AddProxy(int32 proxyId);
+
+	// Remove all pairs of a proxy right away (the proxy is going away).
+	void RemoveProxy(int32 proxyId);
+
+	// Buffer a pair of overlapping proxies. Pairs that already exist are ignored.
 	void AddBufferedPair(int32 proxyId1, int32 proxyId2);
-	void RemoveBufferedPair(int32 proxyId1, int32 proxyId2);
 
+	// Buffer all pairs of a proxy whose fat AABBs no longer overlap for removal.
+	void RemoveStalePairs(int32 proxyId);
+
+	// Report buffered pairs to the callback, sorted by proxy id so the order
+	// does not depend on the shape of the tree.
 	void Commit();
 
-private:
 	b2Pair* Find(int32 proxyId1, int32 proxyId2);
+
+private:
 	b2Pair* Find(int32 proxyId1, int32 proxyId2, uint32 hashValue);
 
 	b2Pair* AddPair(int32 proxyId1, int32 proxyId2);
 	void* RemovePair(int32 proxyId1, int32 proxyId2);
 
-	void ValidateBuffer();
-	void ValidateTable();
+	void Unlink(int32 proxyId, int32 pairIndex);
+	void GrowPairs();
+	void GrowTable();
+	void Buffer(b2BufferedPair*& buffer, int32& count, int32& capacity, int32 proxyId1, int32 proxyId2);
 
 public:
 	b2BroadPhase *m_broadPhase;
 	b2PairCallback *m_callback;
-	b2Pair m_pairs[b2_maxPairs];
-	uint16 m_freePair;
+
+	b2Pair* m_pairs;
+	int32 m_pairCapacity;
+	int32 m_freePair;
 	int32 m_pairCount;
 
-	b2BufferedPair m_pairBuffer[b2_maxPairs];
-	int32 m_pairBufferCount;
+	int32* m_hashTable;
+	int32 m_tableCapacity;	// power of two
+
+	int32* m_proxyPairs;	// first pair of each proxy
+	int32 m_proxyCapacity;
+
+	b2BufferedPair* m_addBuffer;
+	int32 m_addCount;
+	int32 m_addCapacity;
 
-	uint16 m_hashTable[b2_tableCapacity];
+	b2BufferedPair* m_removeBuffer;
+	int32 m_removeCount;
+	int32 m_removeCapacity;
 };
 
 #endif
@@ -45,6 +45,8 @@ public:
 
 private:
 
+	static bool InitializeBlockSizeLookup();
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
@@ -21,7 +21,7 @@
 
 b2Version b2_version = {2, 0, 1};
 
-int32 b2_byteCount = 0;
+std::atomic<int32> b2_byteCount(0);
 
 
 
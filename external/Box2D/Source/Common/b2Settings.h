@@ -21,6 +21,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <atomic>
 
 #define B2_NOT_USED(x) 
 #define b2Assert(A) assert(A)
@@ -73,8 +74,16 @@ const float32 b2_pi = 3.14159265359f;
 // Collision
 const int32 b2_maxManifoldPoints = 2;
 const int32 b2_maxPolygonVertices = 8;
-const int32 b2_maxProxies = 512*4;				// this must be a power of two
-const int32 b2_maxPairs = 8 * b2_maxProxies;	// this must be a power of two
+
+/// This is used to fatten AABBs in the dynamic tree. This allows proxies
+/// to move by a small amount without triggering a tree adjustment.
+/// This is in meters.
+const float32 b2_aabbExtension = 0.1f;
+
+/// This is used to fatten AABBs in the dynamic tree. This is used to predict
+/// the future position based on the current displacement.
+/// This is a dimensionless multiplier.
+const float32 b2_aabbMultiplier = 2.0f;
 
 // Dynamics
 
@@ -140,8 +149,9 @@ const float32 b2_angularSleepTolerance = 2.0f / 180.0f;		// 2 degrees/s
 
 // Memory Allocation
 
-/// The current number of bytes allocated through b2Alloc.
-extern int32 b2_byteCount;
+/// The current number of bytes allocated through b2Alloc. This is atomic
+/// because parallel island solves may allocate from several threads.
+extern std::atomic<int32> b2_byteCount;
 
 /// Implement this function to use your own memory allocator.
 void* b2Alloc(int32 size);
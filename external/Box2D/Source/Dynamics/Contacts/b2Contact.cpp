@@ -57,11 +57,10 @@ void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* dest
 
 b2Contact* b2Contact::Create(b2Shape* shape1, b2Shape* shape2, b2BlockAllocator* allocator)
 {
-	if (s_initialized == false)
-	{
-		InitializeRegisters();
-		s_initialized = true;
-	}
+	// Function-local static, so that the registers are set up exactly
+	// once even if several worlds are stepped on different threads
+	static bool initialized = (InitializeRegisters(), s_initialized = true);
+	B2_NOT_USED(initialized);
 
 	b2ShapeType type1 = shape1->GetType();
 	b2ShapeType type2 = shape2->GetType();
@@ -147,7 +146,8 @@ void b2Contact::Update(b2ContactListener* listener)
 {
 	int32 oldCount = GetManifoldCount();
 
-	Evaluate(listener);
+	// Unreported contacts don't call the listener at all.
+	Evaluate((m_flags & e_reportFlag) ? listener : NULL);
 
 	int32 newCount = GetManifoldCount();
 
@@ -160,8 +160,17 @@ void b2Contact::Update(b2ContactListener* listener)
 		body2->WakeUp();
 	}
 
+	UpdateSlowFlag();
+}
+
+void b2Contact::UpdateSlowFlag()
+{
+	b2Body* body1 = m_shape1->GetBody();
+	b2Body* body2 = m_shape2->GetBody();
+
 	// Slow contacts don't generate TOI events.
-	if (body1->IsStatic() || body1->IsBullet() || body2->IsStatic() || body2->IsBullet())
+	if ((body1->IsStatic() || body1->IsBullet() || body2->IsStatic() || body2->IsBullet()) &&
+		body1->IsTOIDisabled() == false && body2->IsTOIDisabled() == false)
 	{
 		m_flags &= ~e_slowFlag;
 	}
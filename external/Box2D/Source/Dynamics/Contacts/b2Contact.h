@@ -117,6 +117,7 @@ public:
 		e_slowFlag		= 0x0002,
 		e_islandFlag	= 0x0004,
 		e_toiFlag		= 0x0008,
+		e_reportFlag	= 0x0010,
 	};
 
 	static void AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destroyFcn,
@@ -130,6 +131,7 @@ public:
 	virtual ~b2Contact() {}
 
 	void Update(b2ContactListener* listener);
+	void UpdateSlowFlag();
 	virtual void Evaluate(b2ContactListener* listener) = 0;
 	static b2ContactRegister s_registers[e_shapeTypeCount][e_shapeTypeCount];
 	static bool s_initialized;
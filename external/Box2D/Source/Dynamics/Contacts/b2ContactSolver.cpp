@@ -21,11 +21,366 @@
 #include "../b2Body.h"
 #include "../b2World.h"
 #include "../../Common/b2StackAllocator.h"
+#include <cstring>
+
+#if defined(__SSE2__) && !defined(TARGET_FLOAT32_IS_FIXED)
+#include <emmintrin.h>
+#define B2_SIMD_SOLVER
+#endif
+
+// The batched solvers put up to b2_solverLanes contact constraints that share
+// no dynamic body in a batch, as a structure of arrays with one lane per
+// constraint. Unused lanes and points have no bodies and zero masses, so
+// solving them changes nothing.
+const int32 b2_solverLanes = 4;
+const int32 b2_solverColors = 32;
+
+struct b2ContactBatch
+{
+	int32 constraints[b2_solverLanes];
+	b2Body* body1[b2_solverLanes];
+	b2Body* body2[b2_solverLanes];
+	float32 normalX[b2_solverLanes];
+	float32 normalY[b2_solverLanes];
+	float32 friction[b2_solverLanes];
+	float32 invMass1[b2_solverLanes];
+	float32 invI1[b2_solverLanes];
+	float32 invMass2[b2_solverLanes];
+	float32 invI2[b2_solverLanes];
+	float32 r1X[b2_maxManifoldPoints][b2_solverLanes];
+	float32 r1Y[b2_maxManifoldPoints][b2_solverLanes];
+	float32 r2X[b2_maxManifoldPoints][b2_solverLanes];
+	float32 r2Y[b2_maxManifoldPoints][b2_solverLanes];
+	float32 normalMass[b2_maxManifoldPoints][b2_solverLanes];
+	float32 tangentMass[b2_maxManifoldPoints][b2_solverLanes];
+	float32 velocityBias[b2_maxManifoldPoints][b2_solverLanes];
+};
+
+// The colors used by a dynamic body while coloring the contact graph.
+struct b2BodyColors
+{
+	b2Body* body;
+	uint32 colors;
+};
+
+// Lane arithmetic for the batched solvers. Max and Min pick the same operand
+// as the SSE instructions, so that both give bit-identical results.
+struct b2ScalarLanes
+{
+	struct Float
+	{
+		float32 lane[b2_solverLanes];
+	};
+
+	static Float Load(const float32* p)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = p[i];
+		return r;
+	}
+
+	static void Store(float32* p, const Float& a)
+	{
+		for (int32 i = 0; i < b2_solverLanes; ++i) p[i] = a.lane[i];
+	}
+
+	static Float Zero()
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = 0.0f;
+		return r;
+	}
+
+	static Float Add(const Float& a, const Float& b)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = a.lane[i] + b.lane[i];
+		return r;
+	}
+
+	static Float Sub(const Float& a, const Float& b)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = a.lane[i] - b.lane[i];
+		return r;
+	}
+
+	static Float Mul(const Float& a, const Float& b)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = a.lane[i] * b.lane[i];
+		return r;
+	}
+
+	static Float Neg(const Float& a)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = -a.lane[i];
+		return r;
+	}
+
+	static Float Max(const Float& a, const Float& b)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = a.lane[i] > b.lane[i] ? a.lane[i] : b.lane[i];
+		return r;
+	}
+
+	static Float Min(const Float& a, const Float& b)
+	{
+		Float r;
+		for (int32 i = 0; i < b2_solverLanes; ++i) r.lane[i] = a.lane[i] < b.lane[i] ? a.lane[i] : b.lane[i];
+		return r;
+	}
+};
+
+#ifdef B2_SIMD_SOLVER
+struct b2SSELanes
+{
+	typedef __m128 Float;
+
+	static Float Load(const float32* p) { return _mm_loadu_ps(p); }
+	static void Store(float32* p, Float a) { _mm_storeu_ps(p, a); }
+	static Float Zero() { return _mm_setzero_ps(); }
+	static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float Neg(Float a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+	static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+};
+#endif
+
+// Solve the constraints of a batch, with the same operations in the same
+// order as SolveConstraint does for each of them.
+template <typename Lanes>
+void b2ContactSolver::SolveBatch(const b2ContactBatch* batch, b2ContactConstraint* constraints)
+{
+	typedef typename Lanes::Float Float;
+
+	float32 v1X[b2_solverLanes], v1Y[b2_solverLanes], w1[b2_solverLanes];
+	float32 v2X[b2_solverLanes], v2Y[b2_solverLanes], w2[b2_solverLanes];
+	float32 normalImpulse[b2_maxManifoldPoints][b2_solverLanes];
+	float32 tangentImpulse[b2_maxManifoldPoints][b2_solverLanes];
+
+	// Gather.
+	for (int32 i = 0; i < b2_solverLanes; ++i)
+	{
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			normalImpulse[j][i] = 0.0f;
+			tangentImpulse[j][i] = 0.0f;
+		}
+
+		if (batch->constraints[i] < 0)
+		{
+			v1X[i] = v1Y[i] = w1[i] = 0.0f;
+			v2X[i] = v2Y[i] = w2[i] = 0.0f;
+			continue;
+		}
+
+		b2ContactConstraint* c = constraints + batch->constraints[i];
+		for (int32 j = 0; j < c->pointCount; ++j)
+		{
+			normalImpulse[j][i] = c->points[j].normalImpulse;
+			tangentImpulse[j][i] = c->points[j].tangentImpulse;
+		}
+
+		b2Body* b1 = batch->body1[i];
+		b2Body* b2 = batch->body2[i];
+		v1X[i] = b1->m_linearVelocity.x;
+		v1Y[i] = b1->m_linearVelocity.y;
+		w1[i] = b1->m_angularVelocity;
+		v2X[i] = b2->m_linearVelocity.x;
+		v2Y[i] = b2->m_linearVelocity.y;
+		w2[i] = b2->m_angularVelocity;
+	}
+
+	Float V1X = Lanes::Load(v1X);
+	Float V1Y = Lanes::Load(v1Y);
+	Float W1 = Lanes::Load(w1);
+	Float V2X = Lanes::Load(v2X);
+	Float V2Y = Lanes::Load(v2Y);
+	Float W2 = Lanes::Load(w2);
+
+	Float invMass1 = Lanes::Load(batch->invMass1);
+	Float invI1 = Lanes::Load(batch->invI1);
+	Float invMass2 = Lanes::Load(batch->invMass2);
+	Float invI2 = Lanes::Load(batch->invI2);
+	Float normalX = Lanes::Load(batch->normalX);
+	Float normalY = Lanes::Load(batch->normalY);
+	Float tangentX = normalY;
+	Float tangentY = Lanes::Neg(normalX);
+	Float friction = Lanes::Load(batch->friction);
+	Float zero = Lanes::Zero();
+
+	// Solve normal constraints
+	for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+	{
+		Float r1X = Lanes::Load(batch->r1X[j]);
+		Float r1Y = Lanes::Load(batch->r1Y[j]);
+		Float r2X = Lanes::Load(batch->r2X[j]);
+		Float r2Y = Lanes::Load(batch->r2Y[j]);
+		Float impulse = Lanes::Load(normalImpulse[j]);
+
+		// Relative velocity at contact
+		Float dvX = Lanes::Add(Lanes::Sub(Lanes::Sub(V2X, Lanes::Mul(W2, r2Y)), V1X), Lanes::Mul(W1, r1Y));
+		Float dvY = Lanes::Sub(Lanes::Sub(Lanes::Add(V2Y, Lanes::Mul(W2, r2X)), V1Y), Lanes::Mul(W1, r1X));
+
+		// Compute normal impulse
+		Float vn = Lanes::Add(Lanes::Mul(dvX, normalX), Lanes::Mul(dvY, normalY));
+		Float velocityBias = Lanes::Load(batch->velocityBias[j]);
+		Float lambda = Lanes::Mul(Lanes::Neg(Lanes::Load(batch->normalMass[j])), Lanes::Sub(vn, velocityBias));
+
+		// Clamp the accumulated impulse
+		Float newImpulse = Lanes::Max(Lanes::Add(impulse, lambda), zero);
+		lambda = Lanes::Sub(newImpulse, impulse);
+
+		// Apply contact impulse
+		Float PX = Lanes::Mul(lambda, normalX);
+		Float PY = Lanes::Mul(lambda, normalY);
+
+		V1X = Lanes::Sub(V1X, Lanes::Mul(invMass1, PX));
+		V1Y = Lanes::Sub(V1Y, Lanes::Mul(invMass1, PY));
+		W1 = Lanes::Sub(W1, Lanes::Mul(invI1, Lanes::Sub(Lanes::Mul(r1X, PY), Lanes::Mul(r1Y, PX))));
+
+		V2X = Lanes::Add(V2X, Lanes::Mul(invMass2, PX));
+		V2Y = Lanes::Add(V2Y, Lanes::Mul(invMass2, PY));
+		W2 = Lanes::Add(W2, Lanes::Mul(invI2, Lanes::Sub(Lanes::Mul(r2X, PY), Lanes::Mul(r2Y, PX))));
+
+		Lanes::Store(normalImpulse[j], newImpulse);
+	}
+
+	// Solve tangent constraints
+	for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+	{
+		Float r1X = Lanes::Load(batch->r1X[j]);
+		Float r1Y = Lanes::Load(batch->r1Y[j]);
+		Float r2X = Lanes::Load(batch->r2X[j]);
+		Float r2Y = Lanes::Load(batch->r2Y[j]);
+		Float impulse = Lanes::Load(tangentImpulse[j]);
+
+		// Relative velocity at contact
+		Float dvX = Lanes::Add(Lanes::Sub(Lanes::Sub(V2X, Lanes::Mul(W2, r2Y)), V1X), Lanes::Mul(W1, r1Y));
+		Float dvY = Lanes::Sub(Lanes::Sub(Lanes::Add(V2Y, Lanes::Mul(W2, r2X)), V1Y), Lanes::Mul(W1, r1X));
+
+		// Compute tangent force
+		Float vt = Lanes::Add(Lanes::Mul(dvX, tangentX), Lanes::Mul(dvY, tangentY));
+		Float lambda = Lanes::Mul(Lanes::Load(batch->tangentMass[j]), Lanes::Neg(vt));
+
+		// Clamp the accumulated force
+		Float maxFriction = Lanes::Mul(friction, Lanes::Load(normalImpulse[j]));
+		Float newImpulse = Lanes::Max(Lanes::Neg(maxFriction), Lanes::Min(Lanes::Add(impulse, lambda), maxFriction));
+		lambda = Lanes::Sub(newImpulse, impulse);
+
+		// Apply contact impulse
+		Float PX = Lanes::Mul(lambda, tangentX);
+		Float PY = Lanes::Mul(lambda, tangentY);
+
+		V1X = Lanes::Sub(V1X, Lanes::Mul(invMass1, PX));
+		V1Y = Lanes::Sub(V1Y, Lanes::Mul(invMass1, PY));
+		W1 = Lanes::Sub(W1, Lanes::Mul(invI1, Lanes::Sub(Lanes::Mul(r1X, PY), Lanes::Mul(r1Y, PX))));
+
+		V2X = Lanes::Add(V2X, Lanes::Mul(invMass2, PX));
+		V2Y = Lanes::Add(V2Y, Lanes::Mul(invMass2, PY));
+		W2 = Lanes::Add(W2, Lanes::Mul(invI2, Lanes::Sub(Lanes::Mul(r2X, PY), Lanes::Mul(r2Y, PX))));
+
+		Lanes::Store(tangentImpulse[j], newImpulse);
+	}
+
+	Lanes::Store(v1X, V1X);
+	Lanes::Store(v1Y, V1Y);
+	Lanes::Store(w1, W1);
+	Lanes::Store(v2X, V2X);
+	Lanes::Store(v2Y, V2Y);
+	Lanes::Store(w2, W2);
+
+	// Scatter. A static body can be in several lanes, and in islands
+	// solved by other tasks, so it is never written.
+	for (int32 i = 0; i < b2_solverLanes; ++i)
+	{
+		if (batch->constraints[i] < 0)
+		{
+			continue;
+		}
+
+		b2ContactConstraint* c = constraints + batch->constraints[i];
+		for (int32 j = 0; j < c->pointCount; ++j)
+		{
+			c->points[j].normalImpulse = normalImpulse[j][i];
+			c->points[j].tangentImpulse = tangentImpulse[j][i];
+		}
+
+		b2Body* b1 = batch->body1[i];
+		b2Body* b2 = batch->body2[i];
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity.Set(v1X[i], v1Y[i]);
+			b1->m_angularVelocity = w1[i];
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity.Set(v2X[i], v2Y[i]);
+			b2->m_angularVelocity = w2[i];
+		}
+	}
+}
+
+void b2ContactSolver::PackConstraint(b2ContactBatch* batch, int32 lane, const b2ContactConstraint* c, int32 index)
+{
+	batch->constraints[lane] = index;
+	batch->body1[lane] = c->body1;
+	batch->body2[lane] = c->body2;
+	batch->normalX[lane] = c->normal.x;
+	batch->normalY[lane] = c->normal.y;
+	batch->friction[lane] = c->friction;
+	batch->invMass1[lane] = c->body1->m_invMass;
+	batch->invI1[lane] = c->body1->m_invI;
+	batch->invMass2[lane] = c->body2->m_invMass;
+	batch->invI2[lane] = c->body2->m_invI;
+
+	for (int32 j = 0; j < c->pointCount; ++j)
+	{
+		const b2ContactConstraintPoint* ccp = c->points + j;
+		batch->r1X[j][lane] = ccp->r1.x;
+		batch->r1Y[j][lane] = ccp->r1.y;
+		batch->r2X[j][lane] = ccp->r2.x;
+		batch->r2Y[j][lane] = ccp->r2.y;
+		batch->normalMass[j][lane] = ccp->normalMass;
+		batch->tangentMass[j][lane] = ccp->tangentMass;
+		batch->velocityBias[j][lane] = ccp->velocityBias;
+	}
+}
+
+// Find the colors of a dynamic body, adding it to the table if needed.
+// Static bodies have no colors, any number of constraints of a batch may
+// share them.
+static uint32* b2FindColors(b2BodyColors* table, int32 tableSize, b2Body* body)
+{
+	if (body->IsStatic())
+	{
+		return NULL;
+	}
+
+	int32 i = int32((size_t(body) >> 4) * 2654435761u) & (tableSize - 1);
+	while (table[i].body != NULL && table[i].body != body)
+	{
+		i = (i + 1) & (tableSize - 1);
+	}
+
+	table[i].body = body;
+	return &table[i].colors;
+}
 
 b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator)
 {
 	m_step = step;
 	m_allocator = allocator;
+	m_batches = NULL;
+	m_batchCount = 0;
+	m_unbatched = NULL;
+	m_unbatchedCount = 0;
 
 	m_constraintCount = 0;
 	for (int32 i = 0; i < contactCount; ++i)
@@ -132,13 +487,108 @@ b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, i
 	}
 
 	b2Assert(count == m_constraintCount);
+
+	if (step.contactSolver != e_sequentialSolver)
+	{
+		BuildBatches();
+	}
 }
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_batches)
+	{
+		m_allocator->Free(m_unbatched);
+		m_allocator->Free(m_batches);
+	}
 	m_allocator->Free(m_constraints);
 }
 
+// Greedy coloring of the contact graph: each constraint gets the first color
+// that neither of its dynamic bodies has yet. Each color is then cut into
+// batches in constraint order, and constraints beyond the last color are
+// left for the sequential solver.
+void b2ContactSolver::BuildBatches()
+{
+	// Only the last batch of each color can have unused lanes.
+	int32 batchCapacity = m_constraintCount / b2_solverLanes + b2_solverColors;
+	m_batches = (b2ContactBatch*)m_allocator->Allocate(batchCapacity * sizeof(b2ContactBatch));
+	m_unbatched = (int32*)m_allocator->Allocate(m_constraintCount * sizeof(int32));
+
+	int32* colors = (int32*)m_allocator->Allocate(m_constraintCount * sizeof(int32));
+
+	int32 tableSize = 16;
+	while (tableSize < 4 * m_constraintCount)
+	{
+		tableSize *= 2;
+	}
+	b2BodyColors* table = (b2BodyColors*)m_allocator->Allocate(tableSize * sizeof(b2BodyColors));
+	memset(table, 0, tableSize * sizeof(b2BodyColors));
+
+	int32 colorCount = 0;
+	for (int32 i = 0; i < m_constraintCount; ++i)
+	{
+		b2ContactConstraint* c = m_constraints + i;
+		uint32* colors1 = b2FindColors(table, tableSize, c->body1);
+		uint32* colors2 = b2FindColors(table, tableSize, c->body2);
+		uint32 used = (colors1 ? *colors1 : 0) | (colors2 ? *colors2 : 0);
+
+		int32 color = 0;
+		while (color < b2_solverColors && (used & (1u << color)))
+		{
+			++color;
+		}
+
+		colors[i] = color;
+		if (color == b2_solverColors)
+		{
+			m_unbatched[m_unbatchedCount++] = i;
+			continue;
+		}
+
+		if (colors1)
+		{
+			*colors1 |= 1u << color;
+		}
+		if (colors2)
+		{
+			*colors2 |= 1u << color;
+		}
+		colorCount = b2Max(colorCount, color + 1);
+	}
+
+	for (int32 color = 0; color < colorCount; ++color)
+	{
+		b2ContactBatch* batch = NULL;
+		int32 lane = b2_solverLanes;
+
+		for (int32 i = 0; i < m_constraintCount; ++i)
+		{
+			if (colors[i] != color)
+			{
+				continue;
+			}
+
+			if (lane == b2_solverLanes)
+			{
+				b2Assert(m_batchCount < batchCapacity);
+				batch = m_batches + m_batchCount++;
+				memset(batch, 0, sizeof(b2ContactBatch));
+				for (int32 j = 0; j < b2_solverLanes; ++j)
+				{
+					batch->constraints[j] = -1;
+				}
+				lane = 0;
+			}
+
+			PackConstraint(batch, lane++, m_constraints + i, i);
+		}
+	}
+
+	m_allocator->Free(table);
+	m_allocator->Free(colors);
+}
+
 void b2ContactSolver::InitVelocityConstraints(const b2TimeStep& step)
 {
 	// Warm start.
@@ -163,10 +613,17 @@ void b2ContactSolver::InitVelocityConstraints(const b2TimeStep& step)
 				ccp->normalImpulse *= step.dtRatio;
 				ccp->tangentImpulse *= step.dtRatio;
 				b2Vec2 P = ccp->normalImpulse * normal + ccp->tangentImpulse * tangent;
-				b1->m_angularVelocity -= invI1 * b2Cross(ccp->r1, P);
-				b1->m_linearVelocity -= invMass1 * P;
-				b2->m_angularVelocity += invI2 * b2Cross(ccp->r2, P);
-				b2->m_linearVelocity += invMass2 * P;
+				if (!b1->IsStatic())
+				{
+					b1->m_angularVelocity -= invI1 * b2Cross(ccp->r1, P);
+					b1->m_linearVelocity -= invMass1 * P;
+				}
+
+				if (!b2->IsStatic())
+				{
+					b2->m_angularVelocity += invI2 * b2Cross(ccp->r2, P);
+					b2->m_linearVelocity += invMass2 * P;
+				}
 			}
 		}
 		else
@@ -181,107 +638,151 @@ void b2ContactSolver::InitVelocityConstraints(const b2TimeStep& step)
 	}
 }
 
-void b2ContactSolver::SolveVelocityConstraints()
+void b2ContactSolver::SolveConstraint(b2ContactConstraint* c)
 {
-	for (int32 i = 0; i < m_constraintCount; ++i)
-	{
-		b2ContactConstraint* c = m_constraints + i;
-		b2Body* b1 = c->body1;
-		b2Body* b2 = c->body2;
-		float32 w1 = b1->m_angularVelocity;
-		float32 w2 = b2->m_angularVelocity;
-		b2Vec2 v1 = b1->m_linearVelocity;
-		b2Vec2 v2 = b2->m_linearVelocity;
-		float32 invMass1 = b1->m_invMass;
-		float32 invI1 = b1->m_invI;
-		float32 invMass2 = b2->m_invMass;
-		float32 invI2 = b2->m_invI;
-		b2Vec2 normal = c->normal;
-		b2Vec2 tangent = b2Cross(normal, 1.0f);
-		float32 friction = c->friction;
+	b2Body* b1 = c->body1;
+	b2Body* b2 = c->body2;
+	float32 w1 = b1->m_angularVelocity;
+	float32 w2 = b2->m_angularVelocity;
+	b2Vec2 v1 = b1->m_linearVelocity;
+	b2Vec2 v2 = b2->m_linearVelocity;
+	float32 invMass1 = b1->m_invMass;
+	float32 invI1 = b1->m_invI;
+	float32 invMass2 = b2->m_invMass;
+	float32 invI2 = b2->m_invI;
+	b2Vec2 normal = c->normal;
+	b2Vec2 tangent = b2Cross(normal, 1.0f);
+	float32 friction = c->friction;
 //#define DEFERRED_UPDATE
 #ifdef DEFERRED_UPDATE
-		b2Vec2 b1_linearVelocity = b1->m_linearVelocity;
-		float32 b1_angularVelocity = b1->m_angularVelocity;
-		b2Vec2 b2_linearVelocity = b2->m_linearVelocity;
-		float32 b2_angularVelocity = b2->m_angularVelocity;
+	b2Vec2 b1_linearVelocity = b1->m_linearVelocity;
+	float32 b1_angularVelocity = b1->m_angularVelocity;
+	b2Vec2 b2_linearVelocity = b2->m_linearVelocity;
+	float32 b2_angularVelocity = b2->m_angularVelocity;
 #endif
-		// Solve normal constraints
-		for (int32 j = 0; j < c->pointCount; ++j)
-		{
-			b2ContactConstraintPoint* ccp = c->points + j;
+	// Solve normal constraints
+	for (int32 j = 0; j < c->pointCount; ++j)
+	{
+		b2ContactConstraintPoint* ccp = c->points + j;
 
-			// Relative velocity at contact
-			b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
+		// Relative velocity at contact
+		b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
 
-			// Compute normal impulse
-			float32 vn = b2Dot(dv, normal);
-			float32 lambda = -ccp->normalMass * (vn - ccp->velocityBias);
+		// Compute normal impulse
+		float32 vn = b2Dot(dv, normal);
+		float32 lambda = -ccp->normalMass * (vn - ccp->velocityBias);
 
-			// b2Clamp the accumulated impulse
-			float32 newImpulse = b2Max(ccp->normalImpulse + lambda, 0.0f);
-			lambda = newImpulse - ccp->normalImpulse;
+		// b2Clamp the accumulated impulse
+		float32 newImpulse = b2Max(ccp->normalImpulse + lambda, 0.0f);
+		lambda = newImpulse - ccp->normalImpulse;
 
-			// Apply contact impulse
-			b2Vec2 P = lambda * normal;
+		// Apply contact impulse
+		b2Vec2 P = lambda * normal;
 #ifdef DEFERRED_UPDATE
-			b1_linearVelocity -= invMass1 * P;
-			b1_angularVelocity -= invI1 * b2Cross(r1, P);
+		b1_linearVelocity -= invMass1 * P;
+		b1_angularVelocity -= invI1 * b2Cross(r1, P);
 
-			b2_linearVelocity += invMass2 * P;
-			b2_angularVelocity += invI2 * b2Cross(r2, P);
+		b2_linearVelocity += invMass2 * P;
+		b2_angularVelocity += invI2 * b2Cross(r2, P);
 #else
-			v1 -= invMass1 * P;
-			w1 -= invI1 * b2Cross(ccp->r1, P);
+		v1 -= invMass1 * P;
+		w1 -= invI1 * b2Cross(ccp->r1, P);
 
-			v2 += invMass2 * P;
-			w2 += invI2 * b2Cross(ccp->r2, P);
+		v2 += invMass2 * P;
+		w2 += invI2 * b2Cross(ccp->r2, P);
 #endif
-			ccp->normalImpulse = newImpulse;
-		}
+		ccp->normalImpulse = newImpulse;
+	}
 
 #ifdef DEFERRED_UPDATE
+	if (!b1->IsStatic())
+	{
 		b1->m_linearVelocity = b1_linearVelocity;
 		b1->m_angularVelocity = b1_angularVelocity;
+	}
+
+	if (!b2->IsStatic())
+	{
 		b2->m_linearVelocity = b2_linearVelocity;
 		b2->m_angularVelocity = b2_angularVelocity;
+	}
 #endif
-		// Solve tangent constraints
-		for (int32 j = 0; j < c->pointCount; ++j)
-		{
-			b2ContactConstraintPoint* ccp = c->points + j;
+	// Solve tangent constraints
+	for (int32 j = 0; j < c->pointCount; ++j)
+	{
+		b2ContactConstraintPoint* ccp = c->points + j;
 
-			// Relative velocity at contact
-			b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
+		// Relative velocity at contact
+		b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
 
-			// Compute tangent force
-			float32 vt = b2Dot(dv, tangent);
-			float32 lambda = ccp->tangentMass * (-vt);
+		// Compute tangent force
+		float32 vt = b2Dot(dv, tangent);
+		float32 lambda = ccp->tangentMass * (-vt);
 
-			// b2Clamp the accumulated force
-			float32 maxFriction = friction * ccp->normalImpulse;
-			float32 newImpulse = b2Clamp(ccp->tangentImpulse + lambda, -maxFriction, maxFriction);
-			lambda = newImpulse - ccp->tangentImpulse;
+		// b2Clamp the accumulated force
+		float32 maxFriction = friction * ccp->normalImpulse;
+		float32 newImpulse = b2Clamp(ccp->tangentImpulse + lambda, -maxFriction, maxFriction);
+		lambda = newImpulse - ccp->tangentImpulse;
 
-			// Apply contact impulse
-			b2Vec2 P = lambda * tangent;
+		// Apply contact impulse
+		b2Vec2 P = lambda * tangent;
 
-			v1 -= invMass1 * P;
-			w1 -= invI1 * b2Cross(ccp->r1, P);
+		v1 -= invMass1 * P;
+		w1 -= invI1 * b2Cross(ccp->r1, P);
 
-			v2 += invMass2 * P;
-			w2 += invI2 * b2Cross(ccp->r2, P);
+		v2 += invMass2 * P;
+		w2 += invI2 * b2Cross(ccp->r2, P);
 
-			ccp->tangentImpulse = newImpulse;
-		}
+		ccp->tangentImpulse = newImpulse;
+	}
 
+	if (!b1->IsStatic())
+	{
 		b1->m_linearVelocity = v1;
 		b1->m_angularVelocity = w1;
+	}
+
+	if (!b2->IsStatic())
+	{
 		b2->m_linearVelocity = v2;
 		b2->m_angularVelocity = w2;
 	}
 }
 
+void b2ContactSolver::SolveVelocityConstraints()
+{
+	if (m_batches == NULL)
+	{
+		for (int32 i = 0; i < m_constraintCount; ++i)
+		{
+			SolveConstraint(m_constraints + i);
+		}
+		return;
+	}
+
+#ifdef B2_SIMD_SOLVER
+	if (m_step.contactSolver == e_batchedSolver)
+	{
+		for (int32 i = 0; i < m_batchCount; ++i)
+		{
+			SolveBatch<b2SSELanes>(m_batches + i, m_constraints);
+		}
+	}
+	else
+#endif
+	{
+		for (int32 i = 0; i < m_batchCount; ++i)
+		{
+			SolveBatch<b2ScalarLanes>(m_batches + i, m_constraints);
+		}
+	}
+
+	for (int32 i = 0; i < m_unbatchedCount; ++i)
+	{
+		SolveConstraint(m_constraints + m_unbatched[i]);
+	}
+}
+
 void b2ContactSolver::FinalizeVelocityConstraints()
 {
 	for (int32 i = 0; i < m_constraintCount; ++i)
@@ -344,13 +845,19 @@ bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
 
 			b2Vec2 impulse = dImpulse * normal;
 
-			b1->m_sweep.c -= invMass1 * impulse;
-			b1->m_sweep.a -= invI1 * b2Cross(r1, impulse);
-			b1->SynchronizeTransform();
+			if (!b1->IsStatic())
+			{
+				b1->m_sweep.c -= invMass1 * impulse;
+				b1->m_sweep.a -= invI1 * b2Cross(r1, impulse);
+				b1->SynchronizeTransform();
+			}
 
-			b2->m_sweep.c += invMass2 * impulse;
-			b2->m_sweep.a += invI2 * b2Cross(r2, impulse);
-			b2->SynchronizeTransform();
+			if (!b2->IsStatic())
+			{
+				b2->m_sweep.c += invMass2 * impulse;
+				b2->m_sweep.a += invI2 * b2Cross(r2, impulse);
+				b2->SynchronizeTransform();
+			}
 		}
 	}
 
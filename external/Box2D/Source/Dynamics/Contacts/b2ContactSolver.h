@@ -27,6 +27,7 @@ class b2Contact;
 class b2Body;
 class b2Island;
 class b2StackAllocator;
+struct b2ContactBatch;
 
 struct b2ContactConstraintPoint
 {
@@ -68,10 +69,24 @@ public:
 
 	bool SolvePositionConstraints(float32 baumgarte);
 
+	void BuildBatches();
+
+	static void SolveConstraint(b2ContactConstraint* c);
+	static void PackConstraint(b2ContactBatch* batch, int32 lane, const b2ContactConstraint* c, int32 index);
+	template <typename Lanes>
+	static void SolveBatch(const b2ContactBatch* batch, b2ContactConstraint* constraints);
+
 	b2TimeStep m_step;
 	b2StackAllocator* m_allocator;
 	b2ContactConstraint* m_constraints;
 	int m_constraintCount;
+
+	// Batched solvers only: the colored batches, and the constraints
+	// that did not fit in any color, solved one by one after them.
+	b2ContactBatch* m_batches;
+	int32 m_batchCount;
+	int32* m_unbatched;
+	int32 m_unbatchedCount;
 };
 
 #endif
@@ -19,6 +19,7 @@
 #include <cstring>
 #include "b2PolyContact.h"
 #include "../b2Body.h"
+#include "../../Collision/Shapes/b2PolygonShape.h"
 #include "../b2WorldCallbacks.h"
 #include "../../Common/b2BlockAllocator.h"
 
@@ -53,7 +54,16 @@ void b2PolygonContact::Evaluate(b2ContactListener* listener)
 	b2Manifold m0;
 	memcpy(&m0, &m_manifold, sizeof(b2Manifold));
 
-	b2CollidePolygons(&m_manifold, (b2PolygonShape*)m_shape1, b1->GetXForm(), (b2PolygonShape*)m_shape2, b2->GetXForm());
+	b2PolygonShape* poly1 = (b2PolygonShape*)m_shape1;
+	b2PolygonShape* poly2 = (b2PolygonShape*)m_shape2;
+	if (poly1->IsBox() && poly2->IsBox())
+	{
+		b2CollideBoxes(&m_manifold, poly1, b1->GetXForm(), poly2, b2->GetXForm());
+	}
+	else
+	{
+		b2CollidePolygons(&m_manifold, poly1, b1->GetXForm(), poly2, b2->GetXForm());
+	}
 
 	bool persisted[b2_maxManifoldPoints] = {false, false};
 
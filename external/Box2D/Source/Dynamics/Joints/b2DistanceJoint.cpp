@@ -114,10 +114,17 @@ void b2DistanceJoint::InitVelocityConstraints(const b2TimeStep& step)
 	{
 		m_impulse *= step.dtRatio;
 		b2Vec2 P = m_impulse * m_u;
-		b1->m_linearVelocity -= b1->m_invMass * P;
-		b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
-		b2->m_linearVelocity += b2->m_invMass * P;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity -= b1->m_invMass * P;
+			b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += b2->m_invMass * P;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+		}
 	}
 	else
 	{
@@ -144,10 +151,17 @@ void b2DistanceJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	m_impulse += impulse;
 
 	b2Vec2 P = impulse * m_u;
-	b1->m_linearVelocity -= b1->m_invMass * P;
-	b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
-	b2->m_linearVelocity += b2->m_invMass * P;
-	b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+	if (!b1->IsStatic())
+	{
+		b1->m_linearVelocity -= b1->m_invMass * P;
+		b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
+	}
+
+	if (!b2->IsStatic())
+	{
+		b2->m_linearVelocity += b2->m_invMass * P;
+		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+	}
 }
 
 bool b2DistanceJoint::SolvePositionConstraints()
@@ -173,13 +187,19 @@ bool b2DistanceJoint::SolvePositionConstraints()
 	m_u = d;
 	b2Vec2 P = impulse * m_u;
 
-	b1->m_sweep.c -= b1->m_invMass * P;
-	b1->m_sweep.a -= b1->m_invI * b2Cross(r1, P);
-	b2->m_sweep.c += b2->m_invMass * P;
-	b2->m_sweep.a += b2->m_invI * b2Cross(r2, P);
+	if (!b1->IsStatic())
+	{
+		b1->m_sweep.c -= b1->m_invMass * P;
+		b1->m_sweep.a -= b1->m_invI * b2Cross(r1, P);
+		b1->SynchronizeTransform();
+	}
 
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (!b2->IsStatic())
+	{
+		b2->m_sweep.c += b2->m_invMass * P;
+		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P);
+		b2->SynchronizeTransform();
+	}
 
 	return b2Abs(C) < b2_linearSlop;
 }
@@ -149,10 +149,17 @@ void b2GearJoint::InitVelocityConstraints(const b2TimeStep& step)
 	{
 		// Warm starting.
 		float32 P = B2FORCE_SCALE(step.dt) * m_force;
-		b1->m_linearVelocity += b1->m_invMass * P * m_J.linear1;
-		b1->m_angularVelocity += b1->m_invI * P * m_J.angular1;
-		b2->m_linearVelocity += b2->m_invMass * P * m_J.linear2;
-		b2->m_angularVelocity += b2->m_invI * P * m_J.angular2;
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += b1->m_invMass * P * m_J.linear1;
+			b1->m_angularVelocity += b1->m_invI * P * m_J.angular1;
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += b2->m_invMass * P * m_J.linear2;
+			b2->m_angularVelocity += b2->m_invI * P * m_J.angular2;
+		}
 	}
 	else
 	{
@@ -172,10 +179,17 @@ void b2GearJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	m_force += force;
 
 	float32 P = B2FORCE_SCALE(step.dt) * force;
-	b1->m_linearVelocity += b1->m_invMass * P * m_J.linear1;
-	b1->m_angularVelocity += b1->m_invI * P * m_J.angular1;
-	b2->m_linearVelocity += b2->m_invMass * P * m_J.linear2;
-	b2->m_angularVelocity += b2->m_invI * P * m_J.angular2;
+	if (!b1->IsStatic())
+	{
+		b1->m_linearVelocity += b1->m_invMass * P * m_J.linear1;
+		b1->m_angularVelocity += b1->m_invI * P * m_J.angular1;
+	}
+
+	if (!b2->IsStatic())
+	{
+		b2->m_linearVelocity += b2->m_invMass * P * m_J.linear2;
+		b2->m_angularVelocity += b2->m_invI * P * m_J.angular2;
+	}
 }
 
 bool b2GearJoint::SolvePositionConstraints()
@@ -208,13 +222,19 @@ bool b2GearJoint::SolvePositionConstraints()
 
 	float32 impulse = -m_mass * C;
 
-	b1->m_sweep.c += b1->m_invMass * impulse * m_J.linear1;
-	b1->m_sweep.a += b1->m_invI * impulse * m_J.angular1;
-	b2->m_sweep.c += b2->m_invMass * impulse * m_J.linear2;
-	b2->m_sweep.a += b2->m_invI * impulse * m_J.angular2;
+	if (!b1->IsStatic())
+	{
+		b1->m_sweep.c += b1->m_invMass * impulse * m_J.linear1;
+		b1->m_sweep.a += b1->m_invI * impulse * m_J.angular1;
+		b1->SynchronizeTransform();
+	}
 
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (!b2->IsStatic())
+	{
+		b2->m_sweep.c += b2->m_invMass * impulse * m_J.linear2;
+		b2->m_sweep.a += b2->m_invI * impulse * m_J.angular2;
+		b2->SynchronizeTransform();
+	}
 
 	return linearError < b2_linearSlop;
 }
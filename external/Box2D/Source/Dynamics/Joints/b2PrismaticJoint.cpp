@@ -167,11 +167,17 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2TimeStep& step)
 		float32 L1 = B2FORCE_SCALE(step.dt) * (m_force * m_linearJacobian.angular1 - m_torque + (m_motorForce + m_limitForce) * m_motorJacobian.angular1);
 		float32 L2 = B2FORCE_SCALE(step.dt) * (m_force * m_linearJacobian.angular2 + m_torque + (m_motorForce + m_limitForce) * m_motorJacobian.angular2);
 
-		b1->m_linearVelocity += invMass1 * P1;
-		b1->m_angularVelocity += invI1 * L1;
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += invMass1 * P1;
+			b1->m_angularVelocity += invI1 * L1;
+		}
 
-		b2->m_linearVelocity += invMass2 * P2;
-		b2->m_angularVelocity += invI2 * L2;
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += invMass2 * P2;
+			b2->m_angularVelocity += invI2 * L2;
+		}
 	}
 	else
 	{
@@ -198,11 +204,17 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	m_force += force;
 
 	float32 P = B2FORCE_SCALE(step.dt) * force;
-	b1->m_linearVelocity += (invMass1 * P) * m_linearJacobian.linear1;
-	b1->m_angularVelocity += invI1 * P * m_linearJacobian.angular1;
+	if (!b1->IsStatic())
+	{
+		b1->m_linearVelocity += (invMass1 * P) * m_linearJacobian.linear1;
+		b1->m_angularVelocity += invI1 * P * m_linearJacobian.angular1;
+	}
 
-	b2->m_linearVelocity += (invMass2 * P) * m_linearJacobian.linear2;
-	b2->m_angularVelocity += invI2 * P * m_linearJacobian.angular2;
+	if (!b2->IsStatic())
+	{
+		b2->m_linearVelocity += (invMass2 * P) * m_linearJacobian.linear2;
+		b2->m_angularVelocity += invI2 * P * m_linearJacobian.angular2;
+	}
 
 	// Solve angular constraint.
 	float32 angularCdot = b2->m_angularVelocity - b1->m_angularVelocity;
@@ -210,8 +222,15 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	m_torque += torque;
 
 	float32 L = B2FORCE_SCALE(step.dt) * torque;
-	b1->m_angularVelocity -= invI1 * L;
-	b2->m_angularVelocity += invI2 * L;
+	if (!b1->IsStatic())
+	{
+		b1->m_angularVelocity -= invI1 * L;
+	}
+
+	if (!b2->IsStatic())
+	{
+		b2->m_angularVelocity += invI2 * L;
+	}
 
 	// Solve linear motor constraint.
 	if (m_enableMotor && m_limitState != e_equalLimits)
@@ -223,11 +242,17 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		motorForce = m_motorForce - oldMotorForce;
 
 		float32 P = B2FORCE_SCALE(step.dt) * motorForce;
-		b1->m_linearVelocity += (invMass1 * P) * m_motorJacobian.linear1;
-		b1->m_angularVelocity += invI1 * P * m_motorJacobian.angular1;
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += (invMass1 * P) * m_motorJacobian.linear1;
+			b1->m_angularVelocity += invI1 * P * m_motorJacobian.angular1;
+		}
 
-		b2->m_linearVelocity += (invMass2 * P) * m_motorJacobian.linear2;
-		b2->m_angularVelocity += invI2 * P * m_motorJacobian.angular2;
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += (invMass2 * P) * m_motorJacobian.linear2;
+			b2->m_angularVelocity += invI2 * P * m_motorJacobian.angular2;
+		}
 	}
 
 	// Solve linear limit constraint.
@@ -255,11 +280,17 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
 
 		float32 P = B2FORCE_SCALE(step.dt) * limitForce;
 
-		b1->m_linearVelocity += (invMass1 * P) * m_motorJacobian.linear1;
-		b1->m_angularVelocity += invI1 * P * m_motorJacobian.angular1;
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += (invMass1 * P) * m_motorJacobian.linear1;
+			b1->m_angularVelocity += invI1 * P * m_motorJacobian.angular1;
+		}
 
-		b2->m_linearVelocity += (invMass2 * P) * m_motorJacobian.linear2;
-		b2->m_angularVelocity += invI2 * P * m_motorJacobian.angular2;
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += (invMass2 * P) * m_motorJacobian.linear2;
+			b2->m_angularVelocity += invI2 * P * m_motorJacobian.angular2;
+		}
 	}
 }
 
@@ -284,11 +315,17 @@ bool b2PrismaticJoint::SolvePositionConstraints()
 	linearC = b2Clamp(linearC, -b2_maxLinearCorrection, b2_maxLinearCorrection);
 	float32 linearImpulse = -m_linearMass * linearC;
 
-	b1->m_sweep.c += (invMass1 * linearImpulse) * m_linearJacobian.linear1;
-	b1->m_sweep.a += invI1 * linearImpulse * m_linearJacobian.angular1;
+	if (!b1->IsStatic())
+	{
+		b1->m_sweep.c += (invMass1 * linearImpulse) * m_linearJacobian.linear1;
+		b1->m_sweep.a += invI1 * linearImpulse * m_linearJacobian.angular1;
+	}
 	//b1->SynchronizeTransform(); // updated by angular constraint
-	b2->m_sweep.c += (invMass2 * linearImpulse) * m_linearJacobian.linear2;
-	b2->m_sweep.a += invI2 * linearImpulse * m_linearJacobian.angular2;
+	if (!b2->IsStatic())
+	{
+		b2->m_sweep.c += (invMass2 * linearImpulse) * m_linearJacobian.linear2;
+		b2->m_sweep.a += invI2 * linearImpulse * m_linearJacobian.angular2;
+	}
 	//b2->SynchronizeTransform(); // updated by angular constraint
 
 	float32 positionError = b2Abs(linearC);
@@ -299,11 +336,17 @@ bool b2PrismaticJoint::SolvePositionConstraints()
 	angularC = b2Clamp(angularC, -b2_maxAngularCorrection, b2_maxAngularCorrection);
 	float32 angularImpulse = -m_angularMass * angularC;
 
-	b1->m_sweep.a -= b1->m_invI * angularImpulse;
-	b2->m_sweep.a += b2->m_invI * angularImpulse;
+	if (!b1->IsStatic())
+	{
+		b1->m_sweep.a -= b1->m_invI * angularImpulse;
+		b1->SynchronizeTransform();
+	}
 
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (!b2->IsStatic())
+	{
+		b2->m_sweep.a += b2->m_invI * angularImpulse;
+		b2->SynchronizeTransform();
+	}
 
 	float32 angularError = b2Abs(angularC);
 
@@ -352,13 +395,19 @@ bool b2PrismaticJoint::SolvePositionConstraints()
 			limitImpulse = m_limitPositionImpulse - oldLimitImpulse;
 		}
 
-		b1->m_sweep.c += (invMass1 * limitImpulse) * m_motorJacobian.linear1;
-		b1->m_sweep.a += invI1 * limitImpulse * m_motorJacobian.angular1;
-		b2->m_sweep.c += (invMass2 * limitImpulse) * m_motorJacobian.linear2;
-		b2->m_sweep.a += invI2 * limitImpulse * m_motorJacobian.angular2;
+		if (!b1->IsStatic())
+		{
+			b1->m_sweep.c += (invMass1 * limitImpulse) * m_motorJacobian.linear1;
+			b1->m_sweep.a += invI1 * limitImpulse * m_motorJacobian.angular1;
+			b1->SynchronizeTransform();
+		}
 
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		if (!b2->IsStatic())
+		{
+			b2->m_sweep.c += (invMass2 * limitImpulse) * m_motorJacobian.linear2;
+			b2->m_sweep.a += invI2 * limitImpulse * m_motorJacobian.angular2;
+			b2->SynchronizeTransform();
+		}
 	}
 
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
@@ -175,10 +175,17 @@ void b2PulleyJoint::InitVelocityConstraints(const b2TimeStep& step)
 		// Warm starting.
 		b2Vec2 P1 = B2FORCE_SCALE(step.dt) * (-m_force - m_limitForce1) * m_u1;
 		b2Vec2 P2 = B2FORCE_SCALE(step.dt) * (-m_ratio * m_force - m_limitForce2) * m_u2;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += b1->m_invMass * P1;
+			b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += b2->m_invMass * P2;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		}
 	}
 	else
 	{
@@ -209,10 +216,17 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 
 		b2Vec2 P1 = -B2FORCE_SCALE(step.dt) * force * m_u1;
 		b2Vec2 P2 = -B2FORCE_SCALE(step.dt) * m_ratio * force * m_u2;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += b1->m_invMass * P1;
+			b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += b2->m_invMass * P2;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		}
 	}
 
 	if (m_limitState1 == e_atUpperLimit)
@@ -226,8 +240,11 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		force = m_limitForce1 - oldForce;
 
 		b2Vec2 P1 = -B2FORCE_SCALE(step.dt) * force * m_u1;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity += b1->m_invMass * P1;
+			b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		}
 	}
 
 	if (m_limitState2 == e_atUpperLimit)
@@ -241,8 +258,11 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		force = m_limitForce2 - oldForce;
 
 		b2Vec2 P2 = -B2FORCE_SCALE(step.dt) * force * m_u2;
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += b2->m_invMass * P2;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		}
 	}
 }
 
@@ -301,13 +321,19 @@ bool b2PulleyJoint::SolvePositionConstraints()
 		b2Vec2 P1 = -impulse * m_u1;
 		b2Vec2 P2 = -m_ratio * impulse * m_u2;
 
-		b1->m_sweep.c += b1->m_invMass * P1;
-		b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
-		b2->m_sweep.c += b2->m_invMass * P2;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
+		if (!b1->IsStatic())
+		{
+			b1->m_sweep.c += b1->m_invMass * P1;
+			b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
+			b1->SynchronizeTransform();
+		}
 
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		if (!b2->IsStatic())
+		{
+			b2->m_sweep.c += b2->m_invMass * P2;
+			b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
+			b2->SynchronizeTransform();
+		}
 	}
 
 	if (m_limitState1 == e_atUpperLimit)
@@ -336,10 +362,12 @@ bool b2PulleyJoint::SolvePositionConstraints()
 		impulse = m_limitPositionImpulse1 - oldLimitPositionImpulse;
 
 		b2Vec2 P1 = -impulse * m_u1;
-		b1->m_sweep.c += b1->m_invMass * P1;
-		b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
-
-		b1->SynchronizeTransform();
+		if (!b1->IsStatic())
+		{
+			b1->m_sweep.c += b1->m_invMass * P1;
+			b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
+			b1->SynchronizeTransform();
+		}
 	}
 
 	if (m_limitState2 == e_atUpperLimit)
@@ -368,10 +396,12 @@ bool b2PulleyJoint::SolvePositionConstraints()
 		impulse = m_limitPositionImpulse2 - oldLimitPositionImpulse;
 
 		b2Vec2 P2 = -impulse * m_u2;
-		b2->m_sweep.c += b2->m_invMass * P2;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
-
-		b2->SynchronizeTransform();
+		if (!b2->IsStatic())
+		{
+			b2->m_sweep.c += b2->m_invMass * P2;
+			b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
+			b2->SynchronizeTransform();
+		}
 	}
 
 	return linearError < b2_linearSlop;
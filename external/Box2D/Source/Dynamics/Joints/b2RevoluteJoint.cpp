@@ -138,11 +138,17 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 	if (step.warmStarting)
 	{
-		b1->m_linearVelocity -= B2FORCE_SCALE(step.dt) * invMass1 * m_pivotForce;
-		b1->m_angularVelocity -= B2FORCE_SCALE(step.dt) * invI1 * (b2Cross(r1, m_pivotForce) + B2FORCE_INV_SCALE(m_motorForce + m_limitForce));
+		if (!b1->IsStatic())
+		{
+			b1->m_linearVelocity -= B2FORCE_SCALE(step.dt) * invMass1 * m_pivotForce;
+			b1->m_angularVelocity -= B2FORCE_SCALE(step.dt) * invI1 * (b2Cross(r1, m_pivotForce) + B2FORCE_INV_SCALE(m_motorForce + m_limitForce));
+		}
 
-		b2->m_linearVelocity += B2FORCE_SCALE(step.dt) * invMass2 * m_pivotForce;
-		b2->m_angularVelocity += B2FORCE_SCALE(step.dt) * invI2 * (b2Cross(r2, m_pivotForce) + B2FORCE_INV_SCALE(m_motorForce + m_limitForce));
+		if (!b2->IsStatic())
+		{
+			b2->m_linearVelocity += B2FORCE_SCALE(step.dt) * invMass2 * m_pivotForce;
+			b2->m_angularVelocity += B2FORCE_SCALE(step.dt) * invI2 * (b2Cross(r2, m_pivotForce) + B2FORCE_INV_SCALE(m_motorForce + m_limitForce));
+		}
 	}
 	else
 	{
@@ -168,11 +174,17 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	m_pivotForce += pivotForce;
 
 	b2Vec2 P = B2FORCE_SCALE(step.dt) * pivotForce;
-	b1->m_linearVelocity -= b1->m_invMass * P;
-	b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
+	if (!b1->IsStatic())
+	{
+		b1->m_linearVelocity -= b1->m_invMass * P;
+		b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
+	}
 
-	b2->m_linearVelocity += b2->m_invMass * P;
-	b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+	if (!b2->IsStatic())
+	{
+		b2->m_linearVelocity += b2->m_invMass * P;
+		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+	}
 
 	if (m_enableMotor && m_limitState != e_equalLimits)
 	{
@@ -183,8 +195,15 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		motorForce = m_motorForce - oldMotorForce;
 
 		float32 P = step.dt * motorForce;
-		b1->m_angularVelocity -= b1->m_invI * P;
-		b2->m_angularVelocity += b2->m_invI * P;
+		if (!b1->IsStatic())
+		{
+			b1->m_angularVelocity -= b1->m_invI * P;
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_angularVelocity += b2->m_invI * P;
+		}
 	}
 
 	if (m_enableLimit && m_limitState != e_inactiveLimit)
@@ -210,8 +229,15 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		}
 
 		float32 P = step.dt * limitForce;
-		b1->m_angularVelocity -= b1->m_invI * P;
-		b2->m_angularVelocity += b2->m_invI * P;
+		if (!b1->IsStatic())
+		{
+			b1->m_angularVelocity -= b1->m_invI * P;
+		}
+
+		if (!b2->IsStatic())
+		{
+			b2->m_angularVelocity += b2->m_invI * P;
+		}
 	}
 }
 
@@ -254,14 +280,19 @@ bool b2RevoluteJoint::SolvePositionConstraints()
 	b2Mat22 K = K1 + K2 + K3;
 	b2Vec2 impulse = K.Solve(-ptpC);
 
-	b1->m_sweep.c -= b1->m_invMass * impulse;
-	b1->m_sweep.a -= b1->m_invI * b2Cross(r1, impulse);
-
-	b2->m_sweep.c += b2->m_invMass * impulse;
-	b2->m_sweep.a += b2->m_invI * b2Cross(r2, impulse);
+	if (!b1->IsStatic())
+	{
+		b1->m_sweep.c -= b1->m_invMass * impulse;
+		b1->m_sweep.a -= b1->m_invI * b2Cross(r1, impulse);
+		b1->SynchronizeTransform();
+	}
 
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (!b2->IsStatic())
+	{
+		b2->m_sweep.c += b2->m_invMass * impulse;
+		b2->m_sweep.a += b2->m_invI * b2Cross(r2, impulse);
+		b2->SynchronizeTransform();
+	}
 
 	// Handle limits.
 	float32 angularError = 0.0f;
@@ -303,11 +334,17 @@ bool b2RevoluteJoint::SolvePositionConstraints()
 			limitImpulse = m_limitPositionImpulse - oldLimitImpulse;
 		}
 
-		b1->m_sweep.a -= b1->m_invI * limitImpulse;
-		b2->m_sweep.a += b2->m_invI * limitImpulse;
+		if (!b1->IsStatic())
+		{
+			b1->m_sweep.a -= b1->m_invI * limitImpulse;
+			b1->SynchronizeTransform();
+		}
 
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		if (!b2->IsStatic())
+		{
+			b2->m_sweep.a += b2->m_invI * limitImpulse;
+			b2->SynchronizeTransform();
+		}
 	}
 
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
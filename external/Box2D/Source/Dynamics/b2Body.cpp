@@ -20,6 +20,8 @@
 #include "b2World.h"
 #include "Joints/b2Joint.h"
 #include "../Collision/Shapes/b2Shape.h"
+#include "../Collision/Shapes/b2CircleShape.h"
+#include "../Collision/Shapes/b2PolygonShape.h"
 
 b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 {
@@ -43,6 +45,7 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	{
 		m_flags |= e_sleepFlag;
 	}
+	SetContinuous(bd->continuous);
 
 	m_world = world;
 
@@ -342,13 +345,7 @@ bool b2Body::SetXForm(const b2Vec2& position, float32 angle)
 
 	if (freeze == true)
 	{
-		m_flags |= e_frozenFlag;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		for (b2Shape* s = m_shapeList; s; s = s->m_next)
-		{
-			s->DestroyProxy(m_world->m_broadPhase);
-		}
+		Freeze();
 
 		// Failure
 		return false;
@@ -359,6 +356,53 @@ bool b2Body::SetXForm(const b2Vec2& position, float32 angle)
 	return true;
 }
 
+void b2Body::UpdateMovingFast()
+{
+	if ((m_flags & e_fastTOIFlag) == 0)
+	{
+		return;
+	}
+
+	// To pass through another shape, or far enough into it to be pushed
+	// out the other side, a shape has to move at least half its thickness.
+	float32 halfThickness = B2_FLT_MAX;
+	float32 sweepRadius = 0.0f;
+	for (b2Shape* s = m_shapeList; s; s = s->m_next)
+	{
+		if (s->GetType() == e_polygonShape)
+		{
+			const b2Vec2& extents = ((b2PolygonShape*)s)->GetOBB().extents;
+			halfThickness = b2Min(halfThickness, b2Min(extents.x, extents.y));
+		}
+		else if (s->GetType() == e_circleShape)
+		{
+			halfThickness = b2Min(halfThickness, ((b2CircleShape*)s)->GetRadius());
+		}
+		sweepRadius = b2Max(sweepRadius, s->GetSweepRadius());
+	}
+
+	float32 motion = (m_sweep.c - m_sweep.c0).Length() + b2Abs(m_sweep.a - m_sweep.a0) * sweepRadius;
+	if (motion > 0.5f * halfThickness)
+	{
+		m_flags |= e_movingFastFlag;
+	}
+	else
+	{
+		m_flags &= ~e_movingFastFlag;
+	}
+}
+
+void b2Body::Freeze()
+{
+	m_flags |= e_frozenFlag;
+	m_linearVelocity.SetZero();
+	m_angularVelocity = 0.0f;
+	for (b2Shape* s = m_shapeList; s; s = s->m_next)
+	{
+		s->DestroyProxy(m_world->m_broadPhase);
+	}
+}
+
 bool b2Body::SynchronizeShapes()
 {
 	b2XForm xf1;
@@ -377,13 +421,7 @@ bool b2Body::SynchronizeShapes()
 
 	if (inRange == false)
 	{
-		m_flags |= e_frozenFlag;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		for (b2Shape* s = m_shapeList; s; s = s->m_next)
-		{
-			s->DestroyProxy(m_world->m_broadPhase);
-		}
+		Freeze();
 
 		// Failure
 		return false;
@@ -31,6 +31,22 @@ class b2World;
 struct b2JointEdge;
 struct b2ContactEdge;
 
+/// How a body takes part in continuous collision detection (CCD).
+enum b2ContinuousType
+{
+	/// Prevented from tunneling through static bodies. This is the default.
+	e_continuousStatic,
+
+	/// No CCD at all, the body may tunnel through thin shapes.
+	e_continuousNone,
+
+	/// Prevented from tunneling through static bodies, but only in steps in
+	/// which the body moves further than half of its thinnest shape. Slower
+	/// bodies can't pass through anything, so the TOI computations for them
+	/// are skipped and the regular contacts take care of them.
+	e_continuousFast,
+};
+
 /// A body definition holds all the data needed to construct a rigid body.
 /// You can safely re-use body definitions.
 struct b2BodyDef
@@ -50,6 +66,7 @@ struct b2BodyDef
 		isSleeping = false;
 		fixedRotation = false;
 		isBullet = false;
+		continuous = e_continuousStatic;
 	}
 
 	/// You can use this to initialized the mass properties of the body.
@@ -92,6 +109,9 @@ struct b2BodyDef
 	/// static bodies.
 	/// @warning You should use this flag sparingly since it increases processing time.
 	bool isBullet;
+
+	/// How this body takes part in CCD unless it is a bullet.
+	b2ContinuousType continuous;
 };
 
 /// A rigid body.
@@ -228,6 +248,12 @@ public:
 	/// Should this body be treated like a bullet for continuous collision detection?
 	void SetBullet(bool flag);
 
+	/// Get the CCD type of this body, which applies unless it is a bullet.
+	b2ContinuousType GetContinuous() const;
+
+	/// Set the CCD type of this body, which applies unless it is a bullet.
+	void SetContinuous(b2ContinuousType type);
+
 	/// Is this body static (immovable)?
 	bool IsStatic() const;
 
@@ -237,6 +263,12 @@ public:
 	/// Is this body frozen?
 	bool IsFrozen() const;
 
+	/// Take this body out of the simulation for good, like a body that left
+	/// the world. Its shapes leave the broad-phase, which destroys all of
+	/// its contacts, and it is never solved again.
+	/// @warning This function is locked during callbacks.
+	void Freeze();
+
 	/// Is this body sleeping (not simulating).
 	bool IsSleeping() const;
 
@@ -274,6 +306,7 @@ private:
 	friend class b2Island;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
+	friend class b2Contact;
 	
 	friend class b2DistanceJoint;
 	friend class b2GearJoint;
@@ -291,6 +324,9 @@ private:
 		e_allowSleepFlag	= 0x0010,
 		e_bulletFlag		= 0x0020,
 		e_fixedRotationFlag	= 0x0040,
+		e_noTOIFlag			= 0x0080,
+		e_fastTOIFlag		= 0x0100,
+		e_movingFastFlag	= 0x0200,
 	};
 
 	// m_type
@@ -314,6 +350,13 @@ private:
 
 	void Advance(float32 t);
 
+	// Updates the moving fast flag of e_continuousFast bodies from the
+	// motion of the current step.
+	void UpdateMovingFast();
+
+	// Is CCD off in the current step? From the bullet flag and the CCD type.
+	bool IsTOIDisabled() const;
+
 	uint16 m_flags;
 	int16 m_type;
 
@@ -450,6 +493,43 @@ inline void b2Body::SetBullet(bool flag)
 	}
 }
 
+inline b2ContinuousType b2Body::GetContinuous() const
+{
+	if (m_flags & e_noTOIFlag)
+	{
+		return e_continuousNone;
+	}
+	else if (m_flags & e_fastTOIFlag)
+	{
+		return e_continuousFast;
+	}
+
+	return e_continuousStatic;
+}
+
+inline void b2Body::SetContinuous(b2ContinuousType type)
+{
+	m_flags &= ~(e_noTOIFlag | e_fastTOIFlag | e_movingFastFlag);
+	if (type == e_continuousNone)
+	{
+		m_flags |= e_noTOIFlag;
+	}
+	else if (type == e_continuousFast)
+	{
+		m_flags |= e_fastTOIFlag;
+	}
+}
+
+inline bool b2Body::IsTOIDisabled() const
+{
+	if ((m_flags & e_bulletFlag) || m_type == e_staticType)
+	{
+		return false;
+	}
+
+	return (m_flags & e_noTOIFlag) || ((m_flags & e_fastTOIFlag) && (m_flags & e_movingFastFlag) == 0);
+}
+
 inline bool b2Body::IsStatic() const
 {
 	return m_type == e_staticType;
@@ -320,7 +320,14 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool correct
 		{
 			for (int32 i = 0; i < m_bodyCount; ++i)
 			{
+				// Static bodies can be shared with other islands, the
+				// world puts them to sleep (see b2World::SolveIslands).
 				b2Body* b = m_bodies[i];
+				if (b->IsStatic())
+				{
+					continue;
+				}
+
 				b->m_flags |= b2Body::e_sleepFlag;
 				b->m_linearVelocity = b2Vec2_zero;
 				b->m_angularVelocity = 0.0f;
@@ -390,6 +397,11 @@ void b2Island::Report(b2ContactConstraint* constraints)
 	for (int32 i = 0; i < m_contactCount; ++i)
 	{
 		b2Contact* c = m_contacts[i];
+		if ((c->m_flags & b2Contact::e_reportFlag) == 0)
+		{
+			continue;
+		}
+
 		b2ContactConstraint* cc = constraints + i;
 		b2ContactResult cr;
 		cr.shape1 = c->GetShape1();
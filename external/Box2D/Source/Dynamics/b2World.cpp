@@ -27,10 +27,11 @@
 #include "../Collision/Shapes/b2PolygonShape.h"
 #include <new>
 
-b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
+b2World::b2World(const b2Vec2& gravity, bool doSleep)
 {
 	m_destructionListener = NULL;
 	m_boundaryListener = NULL;
+	m_moveListener = NULL;
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = NULL;
 	m_debugDraw = NULL;
@@ -46,6 +47,7 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 	m_positionCorrection = true;
 	m_warmStarting = true;
 	m_continuousPhysics = true;
+	m_contactSolver = e_sequentialSolver;
 
 	m_allowSleep = doSleep;
 	m_gravity = gravity;
@@ -53,10 +55,19 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 	m_lock = false;
 
 	m_inv_dt0 = 0.0f;
+	m_islandCount = 0;
+	m_toiQueryCount = 0;
+	m_toiEventCount = 0;
+
+	m_taskAllocators = NULL;
+	m_taskExecutor = NULL;
+	m_taskCount = 0;
+
+	m_controllerList = NULL;
 
 	m_contactManager.m_world = this;
 	void* mem = b2Alloc(sizeof(b2BroadPhase));
-	m_broadPhase = new (mem) b2BroadPhase(worldAABB, &m_contactManager);
+	m_broadPhase = new (mem) b2BroadPhase(&m_contactManager);
 
 	b2BodyDef bd;
 	m_groundBody = CreateBody(&bd);
@@ -67,6 +78,7 @@ b2World::~b2World()
 	DestroyBody(m_groundBody);
 	m_broadPhase->~b2BroadPhase();
 	b2Free(m_broadPhase);
+	SetTaskExecutor(NULL, 0);
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -79,6 +91,16 @@ void b2World::SetBoundaryListener(b2BoundaryListener* listener)
 	m_boundaryListener = listener;
 }
 
+void b2World::SetWorldAABB(const b2AABB& worldAABB)
+{
+	m_broadPhase->SetWorldAABB(worldAABB);
+}
+
+void b2World::SetMoveListener(b2MoveListener* listener)
+{
+	m_moveListener = listener;
+}
+
 void b2World::SetContactFilter(b2ContactFilter* filter)
 {
 	m_contactFilter = filter;
@@ -89,11 +111,80 @@ void b2World::SetContactListener(b2ContactListener* listener)
 	m_contactListener = listener;
 }
 
+void b2World::AddController(b2Controller* controller)
+{
+	b2Assert(controller->m_prev == NULL && controller->m_next == NULL && controller != m_controllerList);
+
+	// Append, controllers are stepped in the order they were added.
+	if (m_controllerList == NULL)
+	{
+		m_controllerList = controller;
+		return;
+	}
+
+	b2Controller* last = m_controllerList;
+	while (last->m_next)
+	{
+		last = last->m_next;
+	}
+
+	last->m_next = controller;
+	controller->m_prev = last;
+}
+
+void b2World::RemoveController(b2Controller* controller)
+{
+	if (controller->m_prev)
+	{
+		controller->m_prev->m_next = controller->m_next;
+	}
+
+	if (controller->m_next)
+	{
+		controller->m_next->m_prev = controller->m_prev;
+	}
+
+	if (controller == m_controllerList)
+	{
+		m_controllerList = controller->m_next;
+	}
+
+	controller->m_prev = NULL;
+	controller->m_next = NULL;
+}
+
 void b2World::SetDebugDraw(b2DebugDraw* debugDraw)
 {
 	m_debugDraw = debugDraw;
 }
 
+void b2World::SetTaskExecutor(b2TaskExecutor* executor, int32 threadCount)
+{
+	b2Assert(m_lock == false);
+
+	for (int32 i = 0; i < m_taskCount; ++i)
+	{
+		m_taskAllocators[i].~b2StackAllocator();
+	}
+	b2Free(m_taskAllocators);
+	m_taskAllocators = NULL;
+	m_taskExecutor = NULL;
+	m_taskCount = 0;
+
+	if (executor == NULL || threadCount < 2)
+	{
+		return;
+	}
+
+	m_taskExecutor = executor;
+	m_taskCount = threadCount;
+	m_taskAllocators = (b2StackAllocator*)b2Alloc(threadCount * sizeof(b2StackAllocator));
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		new (m_taskAllocators + i) b2StackAllocator;
+	}
+}
+
 b2Body* b2World::CreateBody(const b2BodyDef* def)
 {
 	b2Assert(m_lock == false);
@@ -316,14 +407,8 @@ void b2World::Refilter(b2Shape* shape)
 }
 
 // Find islands, integrate and solve constraints, solve position constraints
-void b2World::Solve(const b2TimeStep& step)
+void b2World::ClearIslandFlags()
 {
-	m_positionIterationCount = 0;
-
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount, m_contactCount, m_jointCount, &m_stackAllocator, m_contactListener);
-
-	// Clear all the island flags.
 	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
 		b->m_flags &= ~b2Body::e_islandFlag;
@@ -336,6 +421,96 @@ void b2World::Solve(const b2TimeStep& step)
 	{
 		j->m_islandFlag = false;
 	}
+}
+
+// Add everything connected to the seed body to the island, by a depth first
+// search (DFS) on the constraint graph.
+void b2World::BuildIsland(b2Body* seed, b2Island* island, b2Body** stack, int32 stackSize)
+{
+	int32 stackCount = 0;
+	stack[stackCount++] = seed;
+	seed->m_flags |= b2Body::e_islandFlag;
+
+	while (stackCount > 0)
+	{
+		// Grab the next body off the stack and add it to the island.
+		b2Body* b = stack[--stackCount];
+		island->Add(b);
+
+		// Make sure the body is awake.
+		b->m_flags &= ~b2Body::e_sleepFlag;
+
+		// To keep islands as small as possible, we don't
+		// propagate islands across static bodies.
+		if (b->IsStatic())
+		{
+			continue;
+		}
+
+		// Search all contacts connected to this body.
+		for (b2ContactEdge* cn = b->m_contactList; cn; cn = cn->next)
+		{
+			// Has this contact already been added to an island?
+			if (cn->contact->m_flags & (b2Contact::e_islandFlag | b2Contact::e_nonSolidFlag))
+			{
+				continue;
+			}
+
+			// Is this contact touching?
+			if (cn->contact->GetManifoldCount() == 0)
+			{
+				continue;
+			}
+
+			island->Add(cn->contact);
+			cn->contact->m_flags |= b2Contact::e_islandFlag;
+
+			b2Body* other = cn->other;
+
+			// Was the other body already added to this island?
+			if (other->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			b2Assert(stackCount < stackSize);
+			stack[stackCount++] = other;
+			other->m_flags |= b2Body::e_islandFlag;
+		}
+
+		// Search all joints connect to this body.
+		for (b2JointEdge* jn = b->m_jointList; jn; jn = jn->next)
+		{
+			if (jn->joint->m_islandFlag == true)
+			{
+				continue;
+			}
+
+			island->Add(jn->joint);
+			jn->joint->m_islandFlag = true;
+
+			b2Body* other = jn->other;
+			if (other->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			b2Assert(stackCount < stackSize);
+			stack[stackCount++] = other;
+			other->m_flags |= b2Body::e_islandFlag;
+		}
+	}
+}
+
+void b2World::SolveIslands(const b2TimeStep& step)
+{
+	m_positionIterationCount = 0;
+	m_islandCount = 0;
+
+	// Size the island for the worst case.
+	b2Island island(m_bodyCount, m_contactCount, m_jointCount, &m_stackAllocator, m_contactListener);
+
+	ClearIslandFlags();
 
 	// Build and simulate all awake islands.
 	int32 stackSize = m_bodyCount;
@@ -354,97 +529,314 @@ void b2World::Solve(const b2TimeStep& step)
 
 		// Reset island and stack.
 		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
+		BuildIsland(seed, &island, stack, stackSize);
 
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		island.Solve(step, m_gravity, m_positionCorrection, m_allowSleep);
+		++m_islandCount;
+		m_positionIterationCount = b2Max(m_positionIterationCount, island.m_positionIterationCount);
+
+		// Post solve cleanup. The seed is not static, so it tells whether
+		// the island fell asleep. Its static bodies sleep with it, until
+		// another island wakes them.
+		bool sleeping = island.m_bodies[0]->IsSleeping();
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			island.Add(b);
+			// Allow static bodies to participate in other islands.
+			b2Body* b = island.m_bodies[i];
+			if (b->IsStatic())
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
+				if (sleeping)
+				{
+					b->m_flags |= b2Body::e_sleepFlag;
+				}
+			}
+			else if (m_moveListener != NULL)
+			{
+				m_moveListener->Moved(b);
+			}
+		}
+	}
 
-			// Make sure the body is awake.
-			b->m_flags &= ~b2Body::e_sleepFlag;
+	m_stackAllocator.Free(stack);
+}
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->IsStatic())
+// The bodies, contacts, joints and contact results of one island, as ranges
+// of the arrays collected by b2World::SolveIslandsParallel.
+struct b2IslandRange
+{
+	int32 bodyStart;
+	int32 bodyCount;
+	int32 contactStart;
+	int32 contactCount;
+	int32 jointStart;
+	int32 jointCount;
+	int32 resultStart;
+	int32 resultCount;
+	int32 task;
+	int32 positionIterationCount;
+};
+
+// Keeps the contact results of an island until all islands are solved.
+class b2ContactResultBuffer : public b2ContactListener
+{
+public:
+	b2ContactResultBuffer(b2ContactResult* results)
+	{
+		m_results = results;
+		m_count = 0;
+	}
+
+	void Result(const b2ContactResult* point)
+	{
+		m_results[m_count++] = *point;
+	}
+
+	b2ContactResult* m_results;
+	int32 m_count;
+};
+
+// Solves the islands assigned to one task, with the task's own stack allocator.
+class b2IslandTask : public b2Task
+{
+public:
+	void Execute(int32 index)
+	{
+		b2StackAllocator* allocator = m_allocators + index;
+
+		for (int32 i = 0; i < m_rangeCount; ++i)
+		{
+			b2IslandRange* range = m_ranges + i;
+			if (range->task != index)
 			{
 				continue;
 			}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* cn = b->m_contactList; cn; cn = cn->next)
+			b2ContactResultBuffer buffer(m_results + range->resultStart);
+			b2Island island(range->bodyCount, range->contactCount, range->jointCount,
+							allocator, m_results ? &buffer : NULL);
+
+			for (int32 j = 0; j < range->bodyCount; ++j)
 			{
-				// Has this contact already been added to an island?
-				if (cn->contact->m_flags & (b2Contact::e_islandFlag | b2Contact::e_nonSolidFlag))
-				{
-					continue;
-				}
+				island.Add(m_islands->m_bodies[range->bodyStart + j]);
+			}
+			for (int32 j = 0; j < range->contactCount; ++j)
+			{
+				island.Add(m_islands->m_contacts[range->contactStart + j]);
+			}
+			for (int32 j = 0; j < range->jointCount; ++j)
+			{
+				island.Add(m_islands->m_joints[range->jointStart + j]);
+			}
 
-				// Is this contact touching?
-				if (cn->contact->GetManifoldCount() == 0)
-				{
-					continue;
-				}
+			island.Solve(*m_step, m_gravity, m_correctPositions, m_allowSleep);
+			range->positionIterationCount = island.m_positionIterationCount;
 
-				island.Add(cn->contact);
-				cn->contact->m_flags |= b2Contact::e_islandFlag;
+			b2Assert(m_results == NULL || buffer.m_count == range->resultCount);
+		}
+	}
 
-				b2Body* other = cn->other;
+	const b2TimeStep* m_step;
+	b2Vec2 m_gravity;
+	bool m_correctPositions;
+	bool m_allowSleep;
+
+	b2StackAllocator* m_allocators;
+	b2Island* m_islands;
+	b2IslandRange* m_ranges;
+	int32 m_rangeCount;
+	b2ContactResult* m_results;
+};
+
+// Like SolveIslands, but all islands are found first and then solved by
+// several tasks. Islands only share static bodies, which the island and
+// its solvers only read. So every island computes exactly what it would
+// in the serial solver, no matter which task solves it or when. The sleep
+// flags of static bodies are set afterwards, in island order.
+void b2World::SolveIslandsParallel(const b2TimeStep& step)
+{
+	m_positionIterationCount = 0;
+	m_islandCount = 0;
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	// All islands end to end. Static bodies can be in several islands,
+	// but at most once per contact or joint.
+	b2Island islands(m_bodyCount + m_contactCount + m_jointCount, m_contactCount, m_jointCount,
+					 &m_stackAllocator, NULL);
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+	ClearIslandFlags();
+
+	int32 stackSize = m_bodyCount;
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+	b2IslandRange* ranges = (b2IslandRange*)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2IslandRange));
+	int32 rangeCount = 0;
+	int32 resultCount = 0;
+
+	// Find all awake islands, in the same order as SolveIslands.
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	{
+		if (seed->m_flags & (b2Body::e_islandFlag | b2Body::e_sleepFlag | b2Body::e_frozenFlag))
+		{
+			continue;
+		}
+
+		if (seed->IsStatic())
+		{
+			continue;
+		}
+
+		b2IslandRange* range = ranges + rangeCount++;
+		range->bodyStart = islands.m_bodyCount;
+		range->contactStart = islands.m_contactCount;
+		range->jointStart = islands.m_jointCount;
+
+		BuildIsland(seed, &islands, stack, stackSize);
+
+		range->bodyCount = islands.m_bodyCount - range->bodyStart;
+		range->contactCount = islands.m_contactCount - range->contactStart;
+		range->jointCount = islands.m_jointCount - range->jointStart;
+
+		for (int32 i = range->bodyStart; i < islands.m_bodyCount; ++i)
+		{
+			// Allow static bodies to participate in other islands.
+			b2Body* b = islands.m_bodies[i];
+			if (b->IsStatic())
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
 			}
+		}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* jn = b->m_jointList; jn; jn = jn->next)
+		// b2Island::Report gives one result per manifold point of every
+		// reported contact.
+		range->resultStart = resultCount;
+		for (int32 i = range->contactStart; i < islands.m_contactCount; ++i)
+		{
+			b2Contact* c = islands.m_contacts[i];
+			if ((c->m_flags & b2Contact::e_reportFlag) == 0)
 			{
-				if (jn->joint->m_islandFlag == true)
-				{
-					continue;
-				}
+				continue;
+			}
 
-				island.Add(jn->joint);
-				jn->joint->m_islandFlag = true;
+			b2Manifold* manifolds = c->GetManifolds();
+			for (int32 j = 0; j < c->GetManifoldCount(); ++j)
+			{
+				resultCount += manifolds[j].pointCount;
+			}
+		}
+		range->resultCount = resultCount - range->resultStart;
+	}
 
-				b2Body* other = jn->other;
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	b2ContactResult* results = NULL;
+	if (m_contactListener)
+	{
+		results = (b2ContactResult*)m_stackAllocator.Allocate(resultCount * sizeof(b2ContactResult));
+	}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+	// Give each island to the least loaded task. This only balances the
+	// work, which task solves an island does not change its results.
+	int32 taskCount = b2Min(m_taskCount, rangeCount);
+	int32* loads = (int32*)m_stackAllocator.Allocate(taskCount * sizeof(int32));
+	for (int32 i = 0; i < taskCount; ++i)
+	{
+		loads[i] = 0;
+	}
+	for (int32 i = 0; i < rangeCount; ++i)
+	{
+		b2IslandRange* range = ranges + i;
+		range->task = 0;
+		for (int32 j = 1; j < taskCount; ++j)
+		{
+			if (loads[j] < loads[range->task])
+			{
+				range->task = j;
 			}
 		}
+		loads[range->task] += range->bodyCount + range->contactCount + range->jointCount;
+	}
+	m_stackAllocator.Free(loads);
+
+	b2IslandTask task;
+	task.m_step = &step;
+	task.m_gravity = m_gravity;
+	task.m_correctPositions = m_positionCorrection;
+	task.m_allowSleep = m_allowSleep;
+	task.m_allocators = m_taskAllocators;
+	task.m_islands = &islands;
+	task.m_ranges = ranges;
+	task.m_rangeCount = rangeCount;
+	task.m_results = results;
+
+	if (taskCount > 1)
+	{
+		m_taskExecutor->Run(&task, taskCount);
+	}
+	else if (taskCount == 1)
+	{
+		task.Execute(0);
+	}
 
-		island.Solve(step, m_gravity, m_positionCorrection, m_allowSleep);
-		m_positionIterationCount = b2Max(m_positionIterationCount, island.m_positionIterationCount);
+	// Report in island order, like the serial solver.
+	for (int32 i = 0; i < rangeCount; ++i)
+	{
+		b2IslandRange* range = ranges + i;
+		m_positionIterationCount = b2Max(m_positionIterationCount, range->positionIterationCount);
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		// A static body sleeps if the last island it is in fell asleep,
+		// as SolveIslands builds each island after solving the previous.
+		bool sleeping = islands.m_bodies[range->bodyStart]->IsSleeping();
+		for (int32 j = range->bodyStart; j < range->bodyStart + range->bodyCount; ++j)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
+			b2Body* b = islands.m_bodies[j];
 			if (b->IsStatic())
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				if (sleeping)
+				{
+					b->m_flags |= b2Body::e_sleepFlag;
+				}
+				else
+				{
+					b->m_flags &= ~b2Body::e_sleepFlag;
+				}
+			}
+			else if (m_moveListener != NULL)
+			{
+				m_moveListener->Moved(b);
+			}
+		}
+
+		if (results)
+		{
+			for (int32 j = 0; j < range->resultCount; ++j)
+			{
+				m_contactListener->Result(results + range->resultStart + j);
 			}
 		}
 	}
+	m_islandCount = rangeCount;
 
+	if (results)
+	{
+		m_stackAllocator.Free(results);
+	}
+	m_stackAllocator.Free(ranges);
 	m_stackAllocator.Free(stack);
+}
+
+void b2World::Solve(const b2TimeStep& step)
+{
+	// Step controllers, their forces are integrated below.
+	for (b2Controller* c = m_controllerList; c; c = c->m_next)
+	{
+		c->Step(this, step);
+	}
+
+	if (m_taskExecutor != NULL)
+	{
+		SolveIslandsParallel(step);
+	}
+	else
+	{
+		SolveIslands(step);
+	}
 
 	// Synchronize shapes, check for out of range bodies.
 	for (b2Body* b = m_bodyList; b; b = b->GetNext())
@@ -488,12 +880,16 @@ void b2World::SolveTOI(const b2TimeStep& step)
 	{
 		b->m_flags &= ~b2Body::e_islandFlag;
 		b->m_sweep.t0 = 0.0f;
+		b->UpdateMovingFast();
 	}
 
 	for (b2Contact* c = m_contactList; c; c = c->m_next)
 	{
 		// Invalidate TOI
 		c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+
+		// Bodies may have sped up or slowed down since the contact was updated.
+		c->UpdateSlowFlag();
 	}
 
 	// Find TOI events and solve them.
@@ -549,6 +945,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 				// Compute the time of impact.
 				toi = b2TimeOfImpact(c->m_shape1, b1->m_sweep, c->m_shape2, b2->m_sweep);
+				++m_toiQueryCount;
 
 				b2Assert(0.0f <= toi && toi <= 1.0f);
 
@@ -576,6 +973,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			break;
 		}
 
+		++m_toiEventCount;
+
 		// Advance the bodies to the TOI.
 		b2Shape* s1 = minContact->GetShape1();
 		b2Shape* s2 = minContact->GetShape2();
@@ -676,6 +1075,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Assert(subStep.dt > B2_FLT_EPSILON);
 		subStep.inv_dt = 1.0f / subStep.dt;
 		subStep.maxIterations = step.maxIterations;
+		subStep.contactSolver = step.contactSolver;
 
 		island.SolveTOI(subStep);
 
@@ -696,6 +1096,11 @@ void b2World::SolveTOI(const b2TimeStep& step)
 				continue;
 			}
 
+			if (m_moveListener != NULL)
+			{
+				m_moveListener->Moved(b);
+			}
+
 			// Update shapes (for broad-phase). If the shapes go out of
 			// the world AABB then shapes and contacts may be destroyed,
 			// including contacts that are
@@ -750,6 +1155,10 @@ void b2World::Step(float32 dt, int32 iterations)
 
 	step.positionCorrection = m_positionCorrection;
 	step.warmStarting = m_warmStarting;
+	step.contactSolver = m_contactSolver;
+
+	m_toiQueryCount = 0;
+	m_toiEventCount = 0;
 	
 	// Update contacts.
 	m_contactManager.Collide();
@@ -930,77 +1339,50 @@ void b2World::DrawDebugData()
 	if (flags & b2DebugDraw::e_pairBit)
 	{
 		b2BroadPhase* bp = m_broadPhase;
-		b2Vec2 invQ;
-		invQ.Set(1.0f / bp->m_quantizationFactor.x, 1.0f / bp->m_quantizationFactor.y);
 		b2Color color(0.9f, 0.9f, 0.3f);
 
-		for (int32 i = 0; i < b2_tableCapacity; ++i)
+		for (int32 i = 0; i < bp->m_pairManager.m_pairCapacity; ++i)
 		{
-			uint16 index = bp->m_pairManager.m_hashTable[i];
-			while (index != b2_nullPair)
+			b2Pair* pair = bp->m_pairManager.m_pairs + i;
+			if (pair->proxyId1 == b2_nullProxy)
 			{
-				b2Pair* pair = bp->m_pairManager.m_pairs + index;
-				b2Proxy* p1 = bp->m_proxyPool + pair->proxyId1;
-				b2Proxy* p2 = bp->m_proxyPool + pair->proxyId2;
-
-				b2AABB b1, b2;
-				b1.lowerBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p1->lowerBounds[0]].value;
-				b1.lowerBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p1->lowerBounds[1]].value;
-				b1.upperBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p1->upperBounds[0]].value;
-				b1.upperBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p1->upperBounds[1]].value;
-				b2.lowerBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p2->lowerBounds[0]].value;
-				b2.lowerBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p2->lowerBounds[1]].value;
-				b2.upperBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p2->upperBounds[0]].value;
-				b2.upperBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p2->upperBounds[1]].value;
-
-				b2Vec2 x1 = 0.5f * (b1.lowerBound + b1.upperBound);
-				b2Vec2 x2 = 0.5f * (b2.lowerBound + b2.upperBound);
-
-				m_debugDraw->DrawSegment(x1, x2, color);
-
-				index = pair->next;
+				continue;
 			}
+
+			const b2AABB& b1 = bp->GetFatAABB(pair->proxyId1);
+			const b2AABB& b2 = bp->GetFatAABB(pair->proxyId2);
+
+			b2Vec2 x1 = 0.5f * (b1.lowerBound + b1.upperBound);
+			b2Vec2 x2 = 0.5f * (b2.lowerBound + b2.upperBound);
+
+			m_debugDraw->DrawSegment(x1, x2, color);
 		}
 	}
 
 	if (flags & b2DebugDraw::e_aabbBit)
 	{
 		b2BroadPhase* bp = m_broadPhase;
-		b2Vec2 worldLower = bp->m_worldAABB.lowerBound;
-		b2Vec2 worldUpper = bp->m_worldAABB.upperBound;
-
-		b2Vec2 invQ;
-		invQ.Set(1.0f / bp->m_quantizationFactor.x, 1.0f / bp->m_quantizationFactor.y);
 		b2Color color(0.9f, 0.3f, 0.9f);
-		for (int32 i = 0; i < b2_maxProxies; ++i)
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			b2Proxy* p = bp->m_proxyPool + i;
-			if (p->IsValid() == false)
+			for (b2Shape* s = b->GetShapeList(); s; s = s->GetNext())
 			{
-				continue;
-			}
+				if (s->m_proxyId == b2_nullProxy)
+				{
+					continue;
+				}
 
-			b2AABB b;
-			b.lowerBound.x = worldLower.x + invQ.x * bp->m_bounds[0][p->lowerBounds[0]].value;
-			b.lowerBound.y = worldLower.y + invQ.y * bp->m_bounds[1][p->lowerBounds[1]].value;
-			b.upperBound.x = worldLower.x + invQ.x * bp->m_bounds[0][p->upperBounds[0]].value;
-			b.upperBound.y = worldLower.y + invQ.y * bp->m_bounds[1][p->upperBounds[1]].value;
+				const b2AABB& aabb = bp->GetFatAABB(s->m_proxyId);
 
-			b2Vec2 vs[4];
-			vs[0].Set(b.lowerBound.x, b.lowerBound.y);
-			vs[1].Set(b.upperBound.x, b.lowerBound.y);
-			vs[2].Set(b.upperBound.x, b.upperBound.y);
-			vs[3].Set(b.lowerBound.x, b.upperBound.y);
+				b2Vec2 vs[4];
+				vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
+				vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+				vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
+				vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
 
-			m_debugDraw->DrawPolygon(vs, 4, color);
+				m_debugDraw->DrawPolygon(vs, 4, color);
+			}
 		}
-
-		b2Vec2 vs[4];
-		vs[0].Set(worldLower.x, worldLower.y);
-		vs[1].Set(worldUpper.x, worldLower.y);
-		vs[2].Set(worldUpper.x, worldUpper.y);
-		vs[3].Set(worldLower.x, worldUpper.y);
-		m_debugDraw->DrawPolygon(vs, 4, b2Color(0.3f, 0.9f, 0.9f));
 	}
 
 	if (flags & b2DebugDraw::e_obbBit)
@@ -34,6 +34,15 @@ class b2Joint;
 class b2Shape;
 class b2Contact;
 class b2BroadPhase;
+class b2Island;
+
+/// Contact velocity solvers, see b2World::SetContactSolver.
+enum b2ContactSolverType
+{
+	e_sequentialSolver,		///< one contact constraint after the other
+	e_batchedSolver,		///< graph colored batches, several at a time with SIMD
+	e_batchedScalarSolver,	///< the same batches without SIMD, for testing
+};
 
 struct b2TimeStep
 {
@@ -43,6 +52,7 @@ struct b2TimeStep
 	int32 maxIterations;
 	bool warmStarting;
 	bool positionCorrection;
+	b2ContactSolverType contactSolver;
 };
 
 /// The world class manages all physics entities, dynamic simulation,
@@ -51,11 +61,10 @@ struct b2TimeStep
 class b2World
 {
 public:
-	/// Construct a world object.
-	/// @param worldAABB a bounding box that completely encompasses all your shapes.
+	/// Construct a world object. The world has no bounds, see SetWorldAABB.
 	/// @param gravity the world gravity vector.
 	/// @param doSleep improve performance by not simulating inactive bodies.
-	b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep);
+	b2World(const b2Vec2& gravity, bool doSleep);
 
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
@@ -63,9 +72,18 @@ public:
 	/// Register a destruction listener.
 	void SetDestructionListener(b2DestructionListener* listener);
 
-	/// Register a broad-phase boundary listener.
+	/// Register a broad-phase boundary listener. It is called for bodies
+	/// that left the world bounds and were frozen.
 	void SetBoundaryListener(b2BoundaryListener* listener);
 
+	/// Set the world bounds. A body with a shape leaving them is frozen:
+	/// it stops moving and no longer collides. The world is unbounded by
+	/// default.
+	void SetWorldAABB(const b2AABB& worldAABB);
+
+	/// Register a listener for the bodies moved by the solver.
+	void SetMoveListener(b2MoveListener* listener);
+
 	/// Register a contact filter to provide specific control over collision.
 	/// Otherwise the default filter is used (b2_defaultFilter).
 	void SetContactFilter(b2ContactFilter* filter);
@@ -73,6 +91,21 @@ public:
 	/// Register a contact event listener
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Add a controller, stepped by every b2World::Step. The world does not
+	/// own the controller, remove it before deleting it.
+	void AddController(b2Controller* controller);
+
+	/// Remove a controller that was added with AddController.
+	void RemoveController(b2Controller* controller);
+
+	/// Solve islands concurrently, as up to threadCount tasks run by the
+	/// executor. Each task solves its islands with its own stack allocator,
+	/// and contact results are reported after the solve, in the same order
+	/// as the serial solver would. The simulation is bit-identical to the
+	/// serial solver. Pass NULL or a thread count below 2 to solve serially
+	/// (the default). The executor must outlive the world or be unset.
+	void SetTaskExecutor(b2TaskExecutor* executor, int32 threadCount);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside the b2World::Step method, so make sure your renderer is ready to
 	/// consume draw commands when you call Step().
@@ -139,6 +172,14 @@ public:
 	/// Enable/disable continuous physics. For testing.
 	void SetContinuousPhysics(bool flag) { m_continuousPhysics = flag; }
 
+	/// Choose the contact velocity solver. The batched solvers color the
+	/// contact graph so that no two constraints of a batch share a dynamic
+	/// body, and solve each batch in SIMD lanes (SSE2) where available.
+	/// Both batched solvers give bit-identical results, but not the same
+	/// results as the sequential solver (the default), which solves the
+	/// constraints in a different order.
+	void SetContactSolver(b2ContactSolverType type) { m_contactSolver = type; }
+
 	/// Perform validation of internal data structures.
 	void Validate();
 
@@ -157,6 +198,15 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
+	/// Get the number of awake islands solved in the last step.
+	int32 GetIslandCount() const;
+
+	/// Get the number of time of impact computations in the last step.
+	int32 GetTOIQueryCount() const;
+
+	/// Get the number of TOI events (sub-steps) solved in the last step.
+	int32 GetTOIEventCount() const;
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
@@ -166,6 +216,10 @@ private:
 	friend class b2ContactManager;
 
 	void Solve(const b2TimeStep& step);
+	void SolveIslands(const b2TimeStep& step);
+	void SolveIslandsParallel(const b2TimeStep& step);
+	void ClearIslandFlags();
+	void BuildIsland(b2Body* seed, b2Island* island, b2Body** stack, int32 stackSize);
 	void SolveTOI(const b2TimeStep& step);
 
 	void DrawJoint(b2Joint* joint);
@@ -175,6 +229,11 @@ private:
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
+	// One stack allocator per parallel island solve task.
+	b2StackAllocator* m_taskAllocators;
+	b2TaskExecutor* m_taskExecutor;
+	int32 m_taskCount;
+
 	bool m_lock;
 
 	b2BroadPhase* m_broadPhase;
@@ -197,13 +256,19 @@ private:
 
 	b2DestructionListener* m_destructionListener;
 	b2BoundaryListener* m_boundaryListener;
+	b2MoveListener* m_moveListener;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2DebugDraw* m_debugDraw;
 
+	b2Controller* m_controllerList;
+
 	float32 m_inv_dt0;
 
 	int32 m_positionIterationCount;
+	int32 m_islandCount;
+	int32 m_toiQueryCount;
+	int32 m_toiEventCount;
 
 	// This is for debugging the solver.
 	bool m_positionCorrection;
@@ -213,6 +278,8 @@ private:
 
 	// This is for debugging the solver.
 	bool m_continuousPhysics;
+
+	b2ContactSolverType m_contactSolver;
 };
 
 inline b2Body* b2World::GetGroundBody()
@@ -245,6 +312,21 @@ inline int32 b2World::GetContactCount() const
 	return m_contactCount;
 }
 
+inline int32 b2World::GetIslandCount() const
+{
+	return m_islandCount;
+}
+
+inline int32 b2World::GetTOIQueryCount() const
+{
+	return m_toiQueryCount;
+}
+
+inline int32 b2World::GetTOIEventCount() const
+{
+	return m_toiEventCount;
+}
+
 inline void b2World::SetGravity(const b2Vec2& gravity)
 {
 	m_gravity = gravity;
@@ -37,6 +37,14 @@ bool b2ContactFilter::ShouldCollide(b2Shape* shape1, b2Shape* shape2)
 	return collide;
 }
 
+// By default all contacts are reported.
+bool b2ContactFilter::ShouldReport(b2Shape* shape1, b2Shape* shape2)
+{
+	B2_NOT_USED(shape1);
+	B2_NOT_USED(shape2);
+	return true;
+}
+
 b2DebugDraw::b2DebugDraw()
 {
 	m_drawFlags = 0;
@@ -25,10 +25,12 @@ struct b2Vec2;
 struct b2XForm;
 class b2Shape;
 class b2Body;
+class b2World;
 class b2Joint;
 class b2Contact;
 struct b2ContactPoint;
 struct b2ContactResult;
+struct b2TimeStep;
 
 /// Joints and shapes are destroyed when their associated
 /// body is destroyed. Implement this listener so that you
@@ -60,6 +62,20 @@ public:
 };
 
 
+/// Implement this class to learn which bodies the solver moved in a time
+/// step, for example to keep a spatial index of the bodies up to date.
+class b2MoveListener
+{
+public:
+	virtual ~b2MoveListener() {}
+
+	/// Called after the step solved the body, also if it fell asleep.
+	/// Bodies are reported in island order, with any number of threads.
+	/// @warning you can't modify the world inside this callback.
+	virtual void Moved(b2Body* body) = 0;
+};
+
+
 /// Implement this class to provide collision filtering. In other words, you can implement
 /// this class if you want finer control over contact creation.
 class b2ContactFilter
@@ -69,7 +85,14 @@ public:
 
 	/// Return true if contact calculations should be performed between these two shapes.
 	/// @warning for performance reasons this is only called when the AABBs begin to overlap.
+	/// @warning the broad-phase already drops pairs that the filter data of the
+	/// shapes excludes, so this can only reject more pairs.
 	virtual bool ShouldCollide(b2Shape* shape1, b2Shape* shape2);
+
+	/// Return true if the contact listener should hear about the contact
+	/// points of these two shapes. Contacts that are not reported cost no
+	/// listener calls at all. Called once, when the contact is created.
+	virtual bool ShouldReport(b2Shape* shape1, b2Shape* shape2);
 };
 
 /// The default contact filter.
@@ -106,6 +129,51 @@ public:
 	virtual void Result(const b2ContactResult* point) { B2_NOT_USED(point); }
 };
 
+/// Implement this class to apply forces from inside b2World::Step, for
+/// example a force field that queries the world for the shapes it covers.
+/// Controllers are stepped in the order they were added, after collision
+/// and before the islands are built, so bodies they wake up are solved in
+/// the same step. See b2World::AddController.
+class b2Controller
+{
+public:
+	b2Controller() : m_prev(NULL), m_next(NULL) {}
+
+	virtual ~b2Controller() {}
+
+	/// Called once per step (not for a zero time step).
+	virtual void Step(b2World* world, const b2TimeStep& step) = 0;
+
+private:
+	friend class b2World;
+
+	b2Controller* m_prev;
+	b2Controller* m_next;
+};
+
+/// A unit of work handed to a b2TaskExecutor.
+class b2Task
+{
+public:
+	virtual ~b2Task() {}
+
+	/// Run the task with the given index. Tasks with different indices
+	/// may run at the same time on different threads.
+	virtual void Execute(int32 index) = 0;
+};
+
+/// Implement this class to let the world solve islands on worker threads.
+/// Box2D does not create threads itself, see b2World::SetTaskExecutor.
+class b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// Call task->Execute(i) for every i in [0, count) and return once
+	/// all of them have finished.
+	virtual void Run(b2Task* task, int32 count) = 0;
+};
+
 /// Color for debug drawing. Each value has the range [0,1].
 struct b2Color
 {
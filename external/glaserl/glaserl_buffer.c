@@ -49,7 +49,7 @@ glaserl_buffer_resize(glaserl_buffer_t *buffer, size_t size)
 }
 
 void
-glaserl_buffer_append(glaserl_buffer_t *buffer, void *data, size_t size)
+glaserl_buffer_append(glaserl_buffer_t *buffer, const void *data, size_t size)
 {
     if (buffer->frozen) {
         assert(0);
@@ -40,7 +40,7 @@ void
 glaserl_buffer_resize(glaserl_buffer_t *buffer, size_t size);
 
 void
-glaserl_buffer_append(glaserl_buffer_t *buffer, void *data, size_t size);
+glaserl_buffer_append(glaserl_buffer_t *buffer, const void *data, size_t size);
 
 void
 glaserl_buffer_freeze(glaserl_buffer_t *buffer);
@@ -95,6 +95,16 @@ glaserl_texture_disable(glaserl_texture_t *texture)
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void
+glaserl_texture_upload(glaserl_texture_t *texture, int x, int y,
+        int width, int height, unsigned char *rgba)
+{
+    glaserl_texture_enable(texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height,
+                    GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glaserl_texture_disable(texture);
+}
+
 void
 glaserl_texture_map_uv(glaserl_texture_t *texture, float *u, float *v)
 {
@@ -53,6 +53,10 @@ glaserl_texture_enable(glaserl_texture_t *texture);
 void
 glaserl_texture_disable(glaserl_texture_t *texture);
 
+void
+glaserl_texture_upload(glaserl_texture_t *texture, int x, int y,
+        int width, int height, unsigned char *rgba);
+
 void
 glaserl_texture_map_uv(glaserl_texture_t *texture, float *u, float *v);
 
@@ -72,7 +72,7 @@ public:
     }
 
     void resize(size_t size) { glaserl_buffer_resize(d, size); }
-    void append(void *data, size_t size) { glaserl_buffer_append(d, data, size); }
+    void append(const void *data, size_t size) { glaserl_buffer_append(d, data, size); }
     void freeze() { glaserl_buffer_freeze(d); }
     size_t enable() { return glaserl_buffer_enable(d); }
     void disable() { glaserl_buffer_disable(d); }
@@ -115,6 +115,7 @@ public:
     void disable() { glaserl_texture_disable(d); }
     int width() { return d->width; }
     int height() { return d->height; }
+    void upload(int x, int y, int w, int h, unsigned char *rgba) { glaserl_texture_upload(d, x, y, w, h, rgba); }
     void map_uv(float &u, float &v) { glaserl_texture_map_uv(d, &u, &v); }
 
     glaserl_texture_t *d;
@@ -131,3 +131,46 @@ StbLoader::render_font(void *buffer, size_t len, StbLoader_Color color, int size
 
     return new StbLoader_RGBA((char *)pixels, w, h, do_free);
 }
+
+StbLoader_Font::StbLoader_Font(void *buffer, size_t len, int size)
+    : font(new stbtt_fontinfo)
+    , scale(0.f)
+    , h(0)
+    , descent(0)
+{
+    stbtt_InitFont(font, (const unsigned char *)buffer,
+        stbtt_GetFontOffsetForIndex((const unsigned char *)buffer, 0));
+
+    // Same scaling as render_font()
+    float addscale = 1.25;
+    h = size * addscale;
+    scale = stbtt_ScaleForPixelHeight(font, size * addscale);
+
+    int ascent, lineGap;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, &lineGap);
+    descent *= scale;
+}
+
+StbLoader_Font::~StbLoader_Font()
+{
+    delete font;
+}
+
+unsigned char *
+StbLoader_Font::glyph(uint32_t codepoint, int *w, int *h, int *x, int *y, int *advance)
+{
+    int xo, yo;
+    unsigned char *cb = stbtt_GetCodepointBitmap(font, scale, scale,
+            codepoint, w, h, &xo, &yo);
+
+    int adv, bearing;
+    stbtt_GetCodepointHMetrics(font, codepoint, &adv, &bearing);
+    adv *= scale;
+    bearing *= scale;
+
+    *x = xo;
+    *y = this->h + yo + descent;
+    *advance = xo + adv - bearing;
+
+    return cb;
+}
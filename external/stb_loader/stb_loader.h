@@ -25,6 +25,28 @@ struct StbLoader_Color {
     float a;
 };
 
+struct stbtt_fontinfo;
+
+// Glyph rasterizer for one (font, size), the buffer must outlive it
+class StbLoader_Font {
+public:
+    StbLoader_Font(void *buffer, size_t len, int size);
+    ~StbLoader_Font();
+
+    int height() { return h; }
+
+    // Returns w*h coverage values (release with free()) or NULL for
+    // empty glyphs; x/y is the offset from the pen position to the top
+    // left of the bitmap, with y relative to the top of the line
+    unsigned char *glyph(uint32_t codepoint, int *w, int *h, int *x, int *y, int *advance);
+
+private:
+    stbtt_fontinfo *font;
+    float scale;
+    int h;
+    int descent;
+};
+
 class StbLoader {
 public:
     static StbLoader_RGBA *
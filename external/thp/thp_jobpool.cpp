@@ -0,0 +1,124 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "thp_jobpool.h"
+
+#include <algorithm>
+
+thp::JobPool::JobPool(int threads)
+    : workers()
+    , threads()
+    , mutex()
+    , queued_cond()
+    , done_cond()
+    , queued(0)
+    , pending(0)
+    , next(0)
+    , quit(false)
+{
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i=0; i<threads; i++) {
+        workers.emplace_back(new Worker());
+    }
+
+    for (int i=0; i<threads; i++) {
+        this->threads.emplace_back([this, i] () { run(i); });
+    }
+}
+
+thp::JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    queued_cond.notify_all();
+
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void
+thp::JobPool::submit(std::function<void()> job)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Worker &worker = *workers[next++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> worker_lock(worker.mutex);
+        worker.jobs.push_back(job);
+    }
+
+    queued++;
+    pending++;
+    queued_cond.notify_one();
+}
+
+void
+thp::JobPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cond.wait(lock, [this] () { return pending == 0; });
+}
+
+bool
+thp::JobPool::take(int index, std::function<void()> &job)
+{
+    // Own queue first (newest job), then steal the oldest job of others
+    for (int i=0; i<workers.size(); i++) {
+        Worker &worker = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.jobs.empty()) {
+            if (i == 0) {
+                job = std::move(worker.jobs.back());
+                worker.jobs.pop_back();
+            } else {
+                job = std::move(worker.jobs.front());
+                worker.jobs.pop_front();
+            }
+            queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+thp::JobPool::run(int index)
+{
+    while (true) {
+        std::function<void()> job;
+        if (take(index, job)) {
+            job();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                done_cond.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        queued_cond.wait(lock, [this] () { return quit || queued > 0; });
+        if (quit && queued == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef THP_JOBPOOL_H
+#define THP_JOBPOOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+namespace thp {
+
+class JobPool {
+    public:
+        // threads: number of worker threads (0 = one per CPU core)
+        JobPool(int threads=0);
+        ~JobPool();
+
+        // Queue a job; jobs are spread round-robin over the workers,
+        // and idle workers steal from the queues of busy ones
+        void submit(std::function<void()> job);
+
+        // Block until all submitted jobs have finished
+        void wait();
+
+        int size() { return workers.size(); }
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<std::function<void()>> jobs;
+        };
+
+        void run(int index);
+        bool take(int index, std::function<void()> &job);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::mutex mutex;
+        std::condition_variable queued_cond;
+        std::condition_variable done_cond;
+        std::atomic<int> queued;
+        int pending;
+        int next;
+        bool quit;
+};
+
+}; /* namespace thp */
+
+#endif /* THP_JOBPOOL_H */
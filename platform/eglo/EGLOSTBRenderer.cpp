@@ -23,28 +23,32 @@
 #include "stb_loader.h"
 
 
-class EGLOFontData : public NP::FontData {
+class EGLOFontData : public GLFontData {
 public:
-    EGLOFontData(const char *filename, int size);
+    EGLOFontData(Blob *blob, int size);
     ~EGLOFontData();
 
-    std::string filename;
+    // Read once, stb_truetype renders straight from this buffer
+    Blob *blob;
+    StbLoader_Font font;
 };
 
-EGLOFontData::EGLOFontData(const char *filename, int size)
-    : NP::FontData(size)
-    , filename(filename)
+EGLOFontData::EGLOFontData(Blob *blob, int size)
+    : GLFontData(size, 0)
+    , blob(blob)
+    , font(blob->data, blob->len, size)
 {
+    height = font.height();
 }
 
 EGLOFontData::~EGLOFontData()
 {
+    delete blob;
 }
 
 
 EGLOSTBRenderer::EGLOSTBRenderer(Vec2 world_size, Vec2 framebuffer_size)
     : GLRenderer(world_size)
-    , m_texture_cache()
 {
     GLRenderer::init(framebuffer_size);
 }
@@ -54,51 +58,36 @@ EGLOSTBRenderer::~EGLOSTBRenderer()
 }
 
 NP::Texture
-EGLOSTBRenderer::load(const char *filename, bool cache)
+EGLOSTBRenderer::decode(const char *filename)
 {
-    std::string fn(filename);
-
-    if (cache) {
-        // Cache lookup
-        for (auto &item: m_texture_cache) {
-            if (item.first == fn) {
-                return item.second;
-            }
-        }
-    }
-
     Blob *blob = Config::readBlob(filename);
     StbLoader_RGBA *rgba = StbLoader::decode_image(blob->data, blob->len);
     delete blob;
     NP::Texture result = GLRenderer::load((unsigned char *)rgba->data, rgba->w, rgba->h);
     delete rgba;
 
-    if (cache) {
-        // Store loaded image in cache
-        m_texture_cache[fn] = result;
-    }
-
     return result;
 }
 
 NP::Font
 EGLOSTBRenderer::load(const char *filename, int size)
 {
-    return NP::Font(new EGLOFontData(filename, size));
+    return NP::Font(new EGLOFontData(Config::readBlob(filename), size));
 }
 
 void
-EGLOSTBRenderer::metrics(const NP::Font &font, const char *text, int *width, int *height)
+EGLOSTBRenderer::glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph)
 {
     EGLOFontData *data = static_cast<EGLOFontData *>(font.get());
 
-    Blob *blob = Config::readBlob(data->filename);
-    StbLoader_RGBA *rgba = StbLoader::render_font(blob->data, blob->len,
-            StbLoader_Color(0.f, 0.f, 0.f, 1.f), data->size, text);
-    *width = rgba->w;
-    *height = rgba->h;
-    delete rgba;
-    delete blob;
+    unsigned char *bitmap = data->font.glyph(codepoint, &glyph.w, &glyph.h,
+            &glyph.x, &glyph.y, &glyph.advance);
+    if (bitmap) {
+        glyph.coverage.assign(bitmap, bitmap + glyph.w * glyph.h);
+        free(bitmap);
+    } else {
+        glyph.w = glyph.h = 0;
+    }
 }
 
 NP::Texture
@@ -114,12 +103,10 @@ EGLOSTBRenderer::text(const NP::Font &font, const char *text, int rgb)
     float g = 1.f * (uint8_t)((rgb >> 8) & 0xff) / 255.f;
     float b = 1.f * (uint8_t)((rgb) & 0xff) / 255.f;
 
-    Blob *blob = Config::readBlob(data->filename);
-    StbLoader_RGBA *rgba = StbLoader::render_font(blob->data, blob->len,
+    StbLoader_RGBA *rgba = StbLoader::render_font(data->blob->data, data->blob->len,
             StbLoader_Color(r, g, b, 1.f), data->size, text);
     NP::Texture result = GLRenderer::load((unsigned char *)rgba->data, rgba->w, rgba->h);
     delete rgba;
-    delete blob;
     return result;
 }
 
@@ -29,17 +29,15 @@ public:
     EGLOSTBRenderer(Vec2 world_size, Vec2 framebuffer_size);
     ~EGLOSTBRenderer();
 
-    virtual NP::Texture load(const char *filename, bool cache);
-
     virtual NP::Font load(const char *filename, int size);
 
-    virtual void metrics(const NP::Font &font, const char *text, int *width, int *height);
     virtual NP::Texture text(const NP::Font &font, const char *text, int rgb);
 
     virtual void swap();
 
-private:
-    std::map<std::string, NP::Texture> m_texture_cache;
+protected:
+    virtual NP::Texture decode(const char *filename);
+    virtual void glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph);
 };
 
 #endif /* NUMPTYPHYSICS_EGLOSTBRENDERER_H */
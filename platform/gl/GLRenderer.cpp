@@ -24,6 +24,7 @@
 #include <initializer_list>
 #include <cstring>
 #include <cstdlib>
+#include <map>
 
 
 struct fRect {
@@ -102,7 +103,8 @@ public:
     void submitRewind(Glaserl::Texture &texture, const FloatArray &data);
     void submitSaturation(Glaserl::Texture &texture, const FloatArray &data);
     void submitBlur(Glaserl::Texture &texture, const FloatArray &data);
-    void submitPath(float *data, size_t size);
+    void submitPath(const float *data, size_t size);
+    void submitGlyphs(Glaserl::Texture &texture, float *data, size_t size);
     void flush();
 
     void setupProjection(Rect world_rect, Vec2 framebuffer_size, bool offscreen);
@@ -110,6 +112,7 @@ public:
 private:
     void drawTextured();
     void drawPath();
+    void drawGlyphs();
 
     vmath::mat4<float> projection;
 
@@ -121,6 +124,7 @@ private:
 
     Glaserl::Program path_program;
     Glaserl::Buffer path_buffer;
+    GLMeshData path_scratch;
 
     Glaserl::Program rewind_program;
     Glaserl::Buffer rewind_buffer;
@@ -128,12 +132,17 @@ private:
     Glaserl::Program saturation_program;
     Glaserl::Buffer saturation_buffer;
 
+    Glaserl::Program glyph_program;
+    Glaserl::Buffer glyph_buffer;
+    Glaserl::Texture glyph_texture;
+
     enum ProgramType {
         NONE,
         TEXTURED,
         BLUR,
         PATH,
         REWIND,
+        GLYPHS,
     };
 
     enum ProgramType active_program;
@@ -270,6 +279,31 @@ const char *path_fragment_shader_src =
 "}\n"
 ;
 
+const char *glyph_vertex_shader_src =
+"attribute vec4 vtxcoord;\n"
+"attribute vec2 texcoord;\n"
+"attribute vec4 color;\n"
+"uniform mat4 projection;\n"
+"varying vec2 tex;\n"
+"varying vec4 col;\n"
+"\n"
+"void main() {\n"
+"    gl_Position = projection * vtxcoord;\n"
+"    tex = texcoord;\n"
+"    col = color;\n"
+"}\n"
+;
+
+const char *glyph_fragment_shader_src =
+"varying vec2 tex;\n"
+"varying vec4 col;\n"
+"uniform sampler2D texture;\n"
+"\n"
+"void main() {\n"
+"    gl_FragColor = vec4(col.rgb, col.a * texture2D(texture, tex).a);\n"
+"}\n"
+;
+
 GLRendererPriv::GLRendererPriv(Vec2 world_size)
     : projection()
     , textured_program(Glaserl::program(
@@ -308,6 +342,7 @@ GLRendererPriv::GLRendererPriv(Vec2 world_size)
                 "projection",
                 NULL))
     , path_buffer(Glaserl::buffer())
+    , path_scratch()
     , rewind_program(Glaserl::program(
                 rewind_vertex_shader_src,
                 rewind_fragment_shader_src,
@@ -336,6 +371,20 @@ GLRendererPriv::GLRendererPriv(Vec2 world_size)
                 "alpha",
                 NULL))
     , saturation_buffer(Glaserl::buffer())
+    , glyph_program(Glaserl::program(
+                glyph_vertex_shader_src,
+                glyph_fragment_shader_src,
+                // Attributes
+                "vtxcoord", 2,
+                "texcoord", 2,
+                "color", 4,
+                NULL,
+                // Uniforms
+                "projection",
+                "texture",
+                NULL))
+    , glyph_buffer(Glaserl::buffer())
+    , glyph_texture()
     , active_program(NONE)
     , world_size(world_size)
     , framebuffer_size(world_size)
@@ -383,7 +432,7 @@ GLRendererPriv::setupProjection(Rect world_rect, Vec2 framebuffer_size, bool off
     }
 
     auto m = vmath::transpose(projection);
-    for (auto p: {textured_program, blur_program, path_program, rewind_program, saturation_program}) {
+    for (auto p: {textured_program, blur_program, path_program, rewind_program, saturation_program, glyph_program}) {
         with (p, [&m] (const Glaserl::Program &program) {
             glUniformMatrix4fv(program->uniform_location("projection"), 1, GL_FALSE, m);
         });
@@ -447,7 +496,7 @@ GLRendererPriv::submitSaturation(Glaserl::Texture &texture, const FloatArray &da
 }
 
 void
-GLRendererPriv::submitPath(float *data, size_t size)
+GLRendererPriv::submitPath(const float *data, size_t size)
 {
     if (active_program != PATH) {
         flush();
@@ -464,12 +513,146 @@ GLRendererPriv::drawPath()
     active_program = NONE;
 }
 
+void
+GLRendererPriv::submitGlyphs(Glaserl::Texture &texture, float *data, size_t size)
+{
+    if (active_program != GLYPHS || glyph_texture != texture) {
+        flush();
+    }
+
+    glyph_buffer->append(data, size);
+    glyph_texture = texture;
+    active_program = GLYPHS;
+}
+
+void
+GLRendererPriv::drawGlyphs()
+{
+    with(glyph_texture, [this] (const Glaserl::Texture &texture) {
+        Glaserl::Util::render_triangle_strip(glyph_program, glyph_buffer);
+    });
+    glyph_texture.reset();
+    active_program = NONE;
+}
+
 void
 GLRendererPriv::flush()
 {
     if (active_program == PATH) {
         drawPath();
+    } else if (active_program == GLYPHS) {
+        drawGlyphs();
+    }
+}
+
+
+struct GLAtlasGlyph {
+    float u1, v1, u2, v2;
+    int w, h, x, y, advance;
+};
+
+/**
+ * One texture per (font, size) holding every glyph rendered so far,
+ * packed into rows ("shelves") left to right, top to bottom.
+ **/
+class GLGlyphAtlas {
+public:
+    GLGlyphAtlas();
+
+    const GLAtlasGlyph *find(uint32_t codepoint);
+    const GLAtlasGlyph &insert(uint32_t codepoint, const GLGlyph &glyph);
+
+    Glaserl::Texture texture;
+
+private:
+    enum {
+        SIZE = 512,
+        PADDING = 1, // avoid bleeding of neighbours with GL_LINEAR
+    };
+
+    std::map<uint32_t, GLAtlasGlyph> glyphs;
+    std::vector<unsigned char> rgba;
+    int cursor_x;
+    int cursor_y;
+    int row_height;
+};
+
+GLGlyphAtlas::GLGlyphAtlas()
+    : texture(Glaserl::texture(nullptr, SIZE, SIZE))
+    , glyphs()
+    , rgba()
+    , cursor_x(0)
+    , cursor_y(0)
+    , row_height(0)
+{
+}
+
+const GLAtlasGlyph *
+GLGlyphAtlas::find(uint32_t codepoint)
+{
+    auto it = glyphs.find(codepoint);
+    if (it == glyphs.end()) {
+        return nullptr;
     }
+
+    return &it->second;
+}
+
+const GLAtlasGlyph &
+GLGlyphAtlas::insert(uint32_t codepoint, const GLGlyph &glyph)
+{
+    GLAtlasGlyph &result = glyphs[codepoint];
+    result = { 0.f, 0.f, 0.f, 0.f, 0, 0, glyph.x, glyph.y, glyph.advance };
+
+    if (glyph.w <= 0 || glyph.h <= 0) {
+        // Whitespace, only the advance matters
+        return result;
+    }
+
+    if (cursor_x + glyph.w > SIZE) {
+        // Start a new shelf
+        cursor_x = 0;
+        cursor_y += row_height + PADDING;
+        row_height = 0;
+    }
+
+    if (glyph.w > SIZE || cursor_y + glyph.h > SIZE) {
+        LOG_WARNING("Glyph atlas full, not drawing U+%04X", codepoint);
+        return result;
+    }
+
+    rgba.resize(glyph.w * glyph.h * 4);
+    for (int i=0; i<glyph.w*glyph.h; i++) {
+        rgba[i*4+0] = rgba[i*4+1] = rgba[i*4+2] = 0xff;
+        rgba[i*4+3] = glyph.coverage[i];
+    }
+    texture->upload(cursor_x, cursor_y, glyph.w, glyph.h, rgba.data());
+
+    result.u1 = float(cursor_x) / SIZE;
+    result.v1 = float(cursor_y) / SIZE;
+    texture->map_uv(result.u1, result.v1);
+    result.u2 = float(cursor_x + glyph.w) / SIZE;
+    result.v2 = float(cursor_y + glyph.h) / SIZE;
+    texture->map_uv(result.u2, result.v2);
+    result.w = glyph.w;
+    result.h = glyph.h;
+
+    cursor_x += glyph.w + PADDING;
+    row_height = std::max(row_height, glyph.h);
+
+    return result;
+}
+
+GLFontData::GLFontData(int size, int height)
+    : NP::FontData(size)
+    , height(height)
+    , atlas(nullptr)
+{
+}
+
+GLFontData::~GLFontData()
+{
+    delete atlas;
 }
 
 GLTextureData::GLTextureData(unsigned char *pixels, int width, int height)
@@ -488,6 +671,20 @@ GLTextureData::~GLTextureData()
 {
 }
 
+GLMeshData::GLMeshData()
+    : NP::MeshData()
+    , vertices()
+    , transformed()
+    , pos(0.f, 0.f)
+    , angle(0.f)
+    , rgba(0)
+{
+}
+
+GLMeshData::~GLMeshData()
+{
+}
+
 GLFramebufferData::GLFramebufferData(int w, int h)
     : NP::FramebufferData(w, h)
     , framebuffer(Glaserl::framebuffer(w, h))
@@ -580,6 +777,7 @@ void
 GLRenderer::begin(NP::Framebuffer &rendertarget, Rect world_rect)
 {
     GLFramebufferData *data = static_cast<GLFramebufferData *>(rendertarget.get());
+    priv->flush();
     data->framebuffer->enable();
     priv->setupProjection(world_rect, Vec2(data->w, data->h), true);
 }
@@ -588,6 +786,7 @@ void
 GLRenderer::end(NP::Framebuffer &rendertarget)
 {
     GLFramebufferData *data = static_cast<GLFramebufferData *>(rendertarget.get());
+    priv->flush();
     data->framebuffer->disable();
     priv->setupProjection(Rect(Vec2(0, 0), priv->world_size), priv->framebuffer_size, false);
 }
@@ -599,6 +798,22 @@ GLRenderer::retrieve(NP::Framebuffer &rendertarget)
     return NP::Texture(new GLTextureData(data->framebuffer->texture));
 }
 
+bool
+GLRenderer::read(NP::Framebuffer &rendertarget, unsigned char *rgba)
+{
+    GLFramebufferData *data = static_cast<GLFramebufferData *>(rendertarget.get());
+
+    priv->flush();
+
+    // Offscreen projections are not flipped, so the first row read is the top
+    data->framebuffer->enable();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, data->w, data->h, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    data->framebuffer->disable();
+
+    return glGetError() == GL_NO_ERROR;
+}
+
 Rect
 GLRenderer::clip(Rect rect)
 {
@@ -610,6 +825,9 @@ GLRenderer::clip(Rect rect)
     projectXY(x1, y1);
     projectXY(x2, y2);
 
+    // Batched geometry must be drawn with the previous scissor rect
+    priv->flush();
+
     if (x1 > x2) {
         std::swap(x1, x2);
     }
@@ -755,10 +973,8 @@ GLRenderer::rectangle(const Rect &rect, int rgba, bool fill)
 }
 
 static float *
-make_segment(b2Vec2 aa, b2Vec2 a, b2Vec2 b, b2Vec2 bb)
+make_segment(b2Vec2 (&data)[10], b2Vec2 aa, b2Vec2 a, b2Vec2 b, b2Vec2 bb)
 {
-    static b2Vec2 data[10];
-
     b2Vec2 a_to_b = 0.5 * (b - a) + 0.5 * (a - aa);
     a_to_b.Normalize();
     b2Vec2 a_to_b_90(-a_to_b.y, a_to_b.x);
@@ -788,23 +1004,17 @@ make_segment(b2Vec2 aa, b2Vec2 a, b2Vec2 b, b2Vec2 bb)
     return &(data[0].x);
 }
 
-void
-GLRenderer::path(const Path &path, int rgba)
+static void
+tessellate(const Path &path, std::vector<float> &vertices)
 {
-    float r, g, b, a;
-    rgba_split(rgba, r, g, b, a);
-
-    if (path.numPoints() < 2) {
-        return;
-    }
-
     int segments = path.numPoints() - 1;
-    int points_len = (2 + 4) * 10 * segments;
-    float *points = new float[points_len];
+    vertices.resize(3 * 10 * segments);
+
     int offset = 0;
+    b2Vec2 segment_data[10];
     for (int i=0; i<segments; i++) {
         // Segment P1 -> P2
-        float *segment = make_segment(
+        float *segment = make_segment(segment_data,
               (i > 0) ? path[i-1] : path[i],
               path[i],
               path[i+1],
@@ -814,24 +1024,225 @@ GLRenderer::path(const Path &path, int rgba)
         int soffset = 0;
         for (int j=0; j<10; j++) {
             // Vertices
-            points[offset++] = segment[soffset++];
-            points[offset++] = segment[soffset++];
-
-            // Color
-            points[offset++] = r;
-            points[offset++] = g;
-            points[offset++] = b;
-            if ((j < 3 || j > 6)) {
-                // Transparent
-                points[offset++] = 0.f;
-            } else {
-                // Filled
-                points[offset++] = a;
-            }
+            vertices[offset++] = segment[soffset++];
+            vertices[offset++] = segment[soffset++];
+
+            // Transparent edges, filled center
+            vertices[offset++] = (j < 3 || j > 6) ? 0.f : 1.f;
+        }
+    }
+}
+
+static void
+transform(const GLMeshData &mesh, const b2Vec2 &pos, float angle, int rgba, std::vector<float> &out)
+{
+    float r, g, b, a;
+    rgba_split(rgba, r, g, b, a);
+
+    float c = cosf(angle);
+    float s = sinf(angle);
+
+    int n = mesh.vertices.size() / 3;
+    out.resize(n * (2 + 4));
+
+    const float *in = mesh.vertices.data();
+    float *o = out.data();
+    for (int i=0; i<n; i++, in+=3) {
+        *o++ = pos.x + c * in[0] - s * in[1];
+        *o++ = pos.y + s * in[0] + c * in[1];
+        *o++ = r;
+        *o++ = g;
+        *o++ = b;
+        *o++ = a * in[2];
+    }
+}
+
+void
+GLRenderer::path(const Path &path, int rgba)
+{
+    if (path.numPoints() < 2) {
+        return;
+    }
+
+    // Immediate mode, for paths that change every frame
+    GLMeshData &scratch = priv->path_scratch;
+    tessellate(path, scratch.vertices);
+    transform(scratch, b2Vec2(0.f, 0.f), 0.f, rgba, scratch.transformed);
+    priv->submitPath(scratch.transformed.data(), scratch.transformed.size() * sizeof(float));
+}
+
+void
+GLRenderer::lines(const float *x, const float *y, int count, const b2Vec2 &delta, int rgba)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    float r, g, b, a;
+    rgba_split(rgba, r, g, b, a);
+
+    // All lines are parallel, so they share the vertices of one segment
+    b2Vec2 segment_data[10];
+    b2Vec2 origin(0.f, 0.f);
+    const float *segment = make_segment(segment_data, origin, origin, delta, delta);
+
+    std::vector<float> &out = priv->path_scratch.transformed;
+    out.resize(count * 10 * (2 + 4));
+
+    float *o = out.data();
+    for (int i=0; i<count; i++) {
+        for (int j=0; j<10; j++) {
+            *o++ = x[i] + segment[2*j];
+            *o++ = y[i] + segment[2*j+1];
+            *o++ = r;
+            *o++ = g;
+            *o++ = b;
+            *o++ = (j < 3 || j > 6) ? 0.f : a;
+        }
+    }
+
+    priv->submitPath(out.data(), out.size() * sizeof(float));
+}
+
+NP::Mesh
+GLRenderer::mesh(const Path &path)
+{
+    GLMeshData *data = new GLMeshData();
+
+    if (path.numPoints() >= 2) {
+        tessellate(path, data->vertices);
+    }
+
+    return NP::Mesh(data);
+}
+
+void
+GLRenderer::path(const NP::Mesh &mesh, const b2Vec2 &pos, float angle, int rgba)
+{
+    GLMeshData *data = static_cast<GLMeshData *>(mesh.get());
+
+    if (data->vertices.empty()) {
+        return;
+    }
+
+    // Resting strokes (ground, decor, sleeping bodies) keep their vertices
+    if (data->transformed.empty() || !(data->pos == pos) ||
+            data->angle != angle || data->rgba != rgba) {
+        transform(*data, pos, angle, rgba, data->transformed);
+        data->pos = pos;
+        data->angle = angle;
+        data->rgba = rgba;
+    }
+
+    priv->submitPath(data->transformed.data(), data->transformed.size() * sizeof(float));
+}
+
+static uint32_t
+utf8_next(const unsigned char *&p)
+{
+    uint32_t codepoint = *p++;
+
+    int extra = 0;
+    if (codepoint >= 0xf0) {
+        codepoint &= 0x07;
+        extra = 3;
+    } else if (codepoint >= 0xe0) {
+        codepoint &= 0x0f;
+        extra = 2;
+    } else if (codepoint >= 0xc0) {
+        codepoint &= 0x1f;
+        extra = 1;
+    }
+
+    while (extra-- > 0 && (*p & 0xc0) == 0x80) {
+        codepoint = (codepoint << 6) | (*p++ & 0x3f);
+    }
+
+    return codepoint;
+}
+
+GLGlyphAtlas *
+GLRenderer::atlas(const NP::Font &font)
+{
+    GLFontData *data = static_cast<GLFontData *>(font.get());
+
+    if (!data->atlas) {
+        data->atlas = new GLGlyphAtlas();
+    }
+
+    return data->atlas;
+}
+
+const GLAtlasGlyph &
+GLRenderer::cached(const NP::Font &font, uint32_t codepoint)
+{
+    GLGlyphAtlas *atlas = this->atlas(font);
+
+    const GLAtlasGlyph *result = atlas->find(codepoint);
+    if (result) {
+        return *result;
+    }
+
+    GLGlyph rendered = { 0, 0, 0, 0, 0, {} };
+    glyph(font, codepoint, rendered);
+    return atlas->insert(codepoint, rendered);
+}
+
+void
+GLRenderer::metrics(const NP::Font &font, const char *text, int *width, int *height)
+{
+    GLFontData *data = static_cast<GLFontData *>(font.get());
+
+    int pen = 0;
+    int extent = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; ) {
+        uint32_t codepoint = utf8_next(p);
+        if (codepoint < 32) {
+            continue;
+        }
+
+        const GLAtlasGlyph &glyph = cached(font, codepoint);
+        extent = std::max(extent, pen + std::max(glyph.x + glyph.w, glyph.advance));
+        pen += glyph.advance;
+    }
+
+    *width = extent;
+    *height = data->height;
+}
+
+void
+GLRenderer::print(const NP::Font &font, const char *text, int x, int y, int rgb)
+{
+    float r, g, b, a;
+    rgba_split(rgb | 0xff000000, r, g, b, a);
+
+    Glaserl::Texture &texture = atlas(font)->texture;
+
+    int pen = x;
+    for (const unsigned char *p = (const unsigned char *)text; *p; ) {
+        uint32_t codepoint = utf8_next(p);
+        if (codepoint < 32) {
+            continue;
+        }
+
+        const GLAtlasGlyph &glyph = cached(font, codepoint);
+        if (glyph.w > 0) {
+            float x1 = pen + glyph.x, y1 = y + glyph.y;
+            float x2 = x1 + glyph.w, y2 = y1 + glyph.h;
+
+            // Degenerate first and last vertex join the quads into one strip
+            float vertices[] = {
+                x1, y1, glyph.u1, glyph.v1, r, g, b, a,
+                x1, y1, glyph.u1, glyph.v1, r, g, b, a,
+                x1, y2, glyph.u1, glyph.v2, r, g, b, a,
+                x2, y1, glyph.u2, glyph.v1, r, g, b, a,
+                x2, y2, glyph.u2, glyph.v2, r, g, b, a,
+                x2, y2, glyph.u2, glyph.v2, r, g, b, a,
+            };
+            priv->submitGlyphs(texture, vertices, sizeof(vertices));
         }
+        pen += glyph.advance;
     }
-    priv->submitPath(points, points_len * sizeof(float));
-    delete points;
 }
 
 void
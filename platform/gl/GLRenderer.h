@@ -19,6 +19,9 @@
 #include "Renderer.h"
 #include "glaserlxx.h"
 
+#include <vector>
+#include <cstdint>
+
 class GLTextureData : public NP::TextureData {
 public:
     GLTextureData(unsigned char *pixels, int width, int height);
@@ -36,6 +39,42 @@ public:
     Glaserl::Framebuffer framebuffer;
 };
 
+class GLMeshData : public NP::MeshData {
+public:
+    GLMeshData();
+    ~GLMeshData();
+
+    // x, y and alpha factor per vertex, relative to the path origin
+    std::vector<float> vertices;
+
+    // Last submitted vertex data, reused while the transform is unchanged
+    std::vector<float> transformed;
+    b2Vec2 pos;
+    float angle;
+    int rgba;
+};
+
+struct GLGlyph {
+    int w;
+    int h;
+    int x; // bitmap offset from the pen position,
+    int y; // relative to the top of the line
+    int advance;
+    std::vector<unsigned char> coverage; // w*h alpha values
+};
+
+struct GLAtlasGlyph;
+class GLGlyphAtlas;
+
+class GLFontData : public NP::FontData {
+public:
+    GLFontData(int size, int height);
+    ~GLFontData();
+
+    int height;
+    GLGlyphAtlas *atlas;
+};
+
 class GLRendererPriv;
 
 class GLRenderer : public NP::Renderer {
@@ -56,6 +95,7 @@ public:
     virtual void begin(NP::Framebuffer &rendertarget, Rect world_rect);
     virtual void end(NP::Framebuffer &rendertarget);
     virtual NP::Texture retrieve(NP::Framebuffer &rendertarget);
+    virtual bool read(NP::Framebuffer &rendertarget, unsigned char *rgba);
 
     virtual Rect clip(Rect rect);
 
@@ -66,11 +106,25 @@ public:
     virtual void saturation(const NP::Texture &texture, const Rect &src, const Rect &dst, float a);
     virtual void rectangle(const Rect &r, int rgba, bool fill);
     virtual void path(const Path &p, int rgba);
+    virtual void lines(const float *x, const float *y, int count, const b2Vec2 &delta, int rgba);
+
+    virtual NP::Mesh mesh(const Path &path);
+    virtual void path(const NP::Mesh &mesh, const b2Vec2 &pos, float angle, int rgba);
+
+    virtual void metrics(const NP::Font &font, const char *text, int *width, int *height);
+    virtual void print(const NP::Font &font, const char *text, int x, int y, int rgb);
 
     virtual void clear();
     virtual void flush();
 
+protected:
+    // Rasterize a single glyph, called once per (font, codepoint)
+    virtual void glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph) = 0;
+
 private:
+    GLGlyphAtlas *atlas(const NP::Font &font);
+    const GLAtlasGlyph &cached(const NP::Font &font, uint32_t codepoint);
+
     Vec2 _world_size;
     GLRendererPriv *priv;
 };
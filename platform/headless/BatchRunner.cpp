@@ -0,0 +1,191 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "BatchRunner.h"
+
+#include "Config.h"
+#include "Canvas.h"
+#include "Scene.h"
+#include "Profiler.h"
+
+#include "petals_log.h"
+
+#include "Box2D.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+
+BatchRunner::BatchRunner(int timeout)
+    : m_timeout(timeout)
+{
+}
+
+BatchResult
+BatchRunner::run(const std::string &filename)
+{
+    PROFILE_ZONE("BatchRunner::run");
+
+    BatchResult result(filename);
+
+    if (!OS->exists(filename)) {
+        LOG_WARNING("Level does not exist: %s", filename.c_str());
+        return result;
+    }
+
+    Scene scene;
+    try {
+        result.loaded = scene.load(Config::readFile(filename));
+    } catch (const char *e) {
+        LOG_WARNING("Cannot load %s: %s", filename.c_str(), e);
+    }
+
+    if (!result.loaded) {
+        return result;
+    }
+
+    ScriptLog *log = scene.getLog();
+    result.events = log->size();
+    int limit = (log->empty() ? 0 : log->back().tick) + m_timeout;
+
+    scene.start();
+
+    // Goals only count as hidden once their fade-out animation has been
+    // drawn, so "draw" every tick into the null renderer like the game does
+    Canvas canvas(WORLD_WIDTH, WORLD_HEIGHT);
+
+    auto start = std::chrono::steady_clock::now();
+    while (scene.getTicks() <= limit) {
+        scene.step();
+        scene.draw(canvas);
+        result.steps++;
+
+        if (scene.introCompleted() && scene.isCompleted()) {
+            result.completed = true;
+            result.completionTick = scene.getTicks();
+            break;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    result.checksum = checksum(scene.getWorld());
+
+    return result;
+}
+
+// Load a level to be played, its recorded events are kept in demo
+static bool
+load_live(Scene &scene, const std::string &filename, ScriptLog &demo)
+{
+    try {
+        if (!scene.load(Config::readFile(filename))) {
+            return false;
+        }
+    } catch (const char *e) {
+        LOG_WARNING("Cannot load %s: %s", filename.c_str(), e);
+        return false;
+    }
+
+    demo = *scene.getLog();
+    scene.getLog()->clear();
+    scene.start();
+    return true;
+}
+
+BatchResult
+BatchRunner::play(const std::string &filename, int rewindAt)
+{
+    PROFILE_ZONE("BatchRunner::play");
+
+    BatchResult result(filename);
+
+    Scene scene;
+    ScriptLog demo;
+    if (!OS->exists(filename) || !load_live(scene, filename, demo)) {
+        return result;
+    }
+
+    result.loaded = true;
+    result.events = demo.size();
+    int limit = (demo.empty() ? 0 : demo.back().tick) + m_timeout;
+
+    // The "player", and its position at each tick to continue after a rewind
+    ScriptPlayer input;
+    input.start(&demo);
+    std::vector<std::pair<int,int>> positions;
+
+    Canvas canvas(WORLD_WIDTH, WORLD_HEIGHT);
+
+    auto start = std::chrono::steady_clock::now();
+    while (scene.getTicks() <= limit) {
+        if (!result.rewound && scene.getTicks() == rewindAt) {
+            // The same as Game::onTick
+            ScriptLog events = *scene.getLog();
+            int target = std::max(0, rewindAt - REWIND_JUMP_LENGTH);
+            ScriptLog ignored;
+            load_live(scene, filename, ignored);
+            scene.playbackUntil(events, target);
+
+            input.seek(positions[scene.getTicks()].first, positions[scene.getTicks()].second);
+            result.rewound = true;
+        }
+
+        positions.resize(scene.getTicks() + 1);
+        positions[scene.getTicks()] = std::make_pair(input.ticks(), input.index());
+
+        scene.step();
+        scene.draw(canvas);
+        if (scene.introCompleted()) {
+            input.tick(&scene);
+        }
+        result.steps++;
+
+        if (scene.introCompleted() && scene.isCompleted()) {
+            result.completed = true;
+            result.completionTick = scene.getTicks();
+            break;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    result.checksum = checksum(scene.getWorld());
+
+    return result;
+}
+
+uint32_t
+BatchRunner::checksum(b2World *world)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (b2Body *body = world->GetBodyList(); body; body = body->GetNext()) {
+        float32 state[] = {
+            body->GetPosition().x, body->GetPosition().y, body->GetAngle(),
+            body->GetLinearVelocity().x, body->GetLinearVelocity().y,
+            body->GetAngularVelocity(),
+        };
+
+        uint8_t bytes[sizeof(state)];
+        memcpy(bytes, state, sizeof(state));
+        for (uint8_t byte: bytes) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+    }
+
+    return hash;
+}
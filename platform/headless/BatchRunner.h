@@ -0,0 +1,78 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_BATCHRUNNER_H
+#define NUMPTYPHYSICS_BATCHRUNNER_H
+
+#include <string>
+#include <cstdint>
+
+class b2World;
+
+struct BatchResult {
+    BatchResult(const std::string &filename)
+        : filename(filename)
+        , loaded(false)
+        , events(0)
+        , completed(false)
+        , completionTick(-1)
+        , steps(0)
+        , seconds(0.0)
+        , rewound(false)
+        , checksum(0)
+    {
+    }
+
+    double stepsPerSecond() const { return seconds > 0.0 ? steps / seconds : 0.0; }
+
+    // A level with a recorded solution that does not reach its goal
+    bool failed() const { return !loaded || (events > 0 && !completed); }
+
+    std::string filename;
+    bool loaded;
+    int events;
+    bool completed;
+    int completionTick;
+    int steps;
+    double seconds;
+    bool rewound;
+
+    // World state after the last step, see BatchRunner::checksum()
+    uint32_t checksum;
+};
+
+// Loads levels and replays their recorded event log as fast as possible
+class BatchRunner {
+public:
+    // timeout: number of ticks to keep simulating after the last event
+    BatchRunner(int timeout);
+
+    BatchResult run(const std::string &filename);
+
+    // Feed the recorded events as if a player made them, so that the scene
+    // records them, and rewind once at tick rewindAt (if >= 0) like the
+    // game does. Equal checksums with and without the rewind mean that the
+    // rewind is exact.
+    BatchResult play(const std::string &filename, int rewindAt);
+
+    // Hash of the position, angle and velocity bits of every body, equal
+    // only if two simulations ran exactly the same
+    static uint32_t checksum(b2World *world);
+
+private:
+    int m_timeout;
+};
+
+#endif /* NUMPTYPHYSICS_BATCHRUNNER_H */
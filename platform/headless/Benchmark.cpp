@@ -0,0 +1,600 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "Benchmark.h"
+#include "BatchRunner.h"
+
+#include "Config.h"
+#include "Scene.h"
+
+#include "petals_log.h"
+
+#include "Box2D.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+
+Benchmark::Benchmark(int ticks)
+    : m_ticks(ticks)
+{
+}
+
+BenchmarkResult
+Benchmark::run(const std::string &filename, bool replay)
+{
+    BenchmarkResult result(filename, replay);
+
+    if (!OS->exists(filename)) {
+        LOG_WARNING("Level does not exist: %s", filename.c_str());
+        return result;
+    }
+
+    long base = b2_byteCount;
+    long peak = base;
+
+    Scene scene;
+    try {
+        result.loaded = scene.load(Config::readFile(filename));
+    } catch (const char *e) {
+        LOG_WARNING("Cannot load %s: %s", filename.c_str(), e);
+    }
+
+    if (!result.loaded) {
+        return result;
+    }
+
+    if (!replay) {
+        scene.getLog()->clear();
+    }
+
+    scene.start();
+
+    // The intro only fades strokes in, the world isn't stepped yet
+    while (!scene.introCompleted()) {
+        scene.step();
+    }
+
+    b2World *world = scene.getWorld();
+    peak = std::max(peak, long(b2_byteCount));
+
+    long proxies = 0;
+    long pairs = 0;
+    long contacts = 0;
+    long islands = 0;
+    long toiQueries = 0;
+    long toiEvents = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<m_ticks; i++) {
+        scene.step();
+
+        proxies += world->GetProxyCount();
+        pairs += world->GetPairCount();
+        contacts += world->GetContactCount();
+        islands += world->GetIslandCount();
+        toiQueries += world->GetTOIQueryCount();
+        toiEvents += world->GetTOIEventCount();
+
+        // Sampled between steps, transient allocations inside Step() are missed
+        peak = std::max(peak, long(b2_byteCount));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    result.steps = m_ticks;
+    if (m_ticks > 0) {
+        result.nsPerStep = elapsed.count() * 1e9 / m_ticks;
+        result.proxies = double(proxies) / m_ticks;
+        result.pairs = double(pairs) / m_ticks;
+        result.contacts = double(contacts) / m_ticks;
+        result.islands = double(islands) / m_ticks;
+        result.toiQueries = double(toiQueries) / m_ticks;
+        result.toiEvents = double(toiEvents) / m_ticks;
+    }
+    result.bodies = world->GetBodyCount();
+    result.peakBytes = peak - base;
+
+    return result;
+}
+
+static std::string
+json_escape(const std::string &s)
+{
+    std::string result;
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+bool
+Benchmark::write(const std::string &filename, int ticks,
+                 const std::vector<BenchmarkResult> &results)
+{
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (!fp) {
+        LOG_WARNING("Cannot write benchmark results to %s", filename.c_str());
+        return false;
+    }
+
+    bool json = (filename.size() >= 5 && filename.substr(filename.size() - 5) == ".json");
+
+    if (json) {
+        fprintf(fp, "{\n  \"ticks\": %d,\n  \"results\": [", ticks);
+    } else {
+        fprintf(fp, "level,mode,steps,ns_per_step,bodies,proxies,pairs,contacts,islands,"
+                "toi_queries,toi_events,peak_bytes\n");
+    }
+
+    bool first = true;
+    for (auto &result: results) {
+        if (!result.loaded) {
+            continue;
+        }
+
+        if (json) {
+            fprintf(fp, "%s\n    {\"level\": \"%s\", \"mode\": \"%s\", \"steps\": %d, "
+                    "\"ns_per_step\": %.1f, \"bodies\": %d, \"proxies\": %.2f, \"pairs\": %.2f, "
+                    "\"contacts\": %.2f, \"islands\": %.2f, \"toi_queries\": %.2f, "
+                    "\"toi_events\": %.2f, \"peak_bytes\": %ld}",
+                    first ? "" : ",", json_escape(result.filename).c_str(),
+                    result.replay ? "replay" : "free", result.steps, result.nsPerStep,
+                    result.bodies, result.proxies, result.pairs, result.contacts,
+                    result.islands, result.toiQueries, result.toiEvents, result.peakBytes);
+        } else {
+            fprintf(fp, "%s,%s,%d,%.1f,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%ld\n",
+                    result.filename.c_str(), result.replay ? "replay" : "free",
+                    result.steps, result.nsPerStep, result.bodies, result.proxies,
+                    result.pairs, result.contacts, result.islands, result.toiQueries,
+                    result.toiEvents, result.peakBytes);
+        }
+        first = false;
+    }
+
+    if (json) {
+        fprintf(fp, "\n  ]\n}\n");
+    }
+
+    bool ok = (ferror(fp) == 0);
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+
+    return ok;
+}
+
+bool
+Benchmark::readBaseline(const std::string &filename, std::map<std::string, double> &nsPerStep)
+{
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        LOG_WARNING("Cannot read baseline %s", filename.c_str());
+        return false;
+    }
+
+    std::string line;
+    std::getline(in, line); // header
+
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            fields.push_back(field);
+        }
+
+        if (fields.size() < 4) {
+            continue;
+        }
+
+        nsPerStep[fields[0] + ":" + fields[1]] = atof(fields[3].c_str());
+    }
+
+    return true;
+}
+
+class BroadPhaseCounter : public b2PairCallback {
+public:
+    BroadPhaseCounter() : added(0) {}
+
+    virtual void *PairAdded(void *proxyUserData1, void *proxyUserData2)
+    {
+        added++;
+        return nullptr;
+    }
+
+    virtual void PairRemoved(void *proxyUserData1, void *proxyUserData2, void *pairUserData)
+    {
+    }
+
+    long added;
+};
+
+// xorshift32, so every build moves the same proxies the same way
+class BroadPhaseRandom {
+public:
+    BroadPhaseRandom() : m_state(2463534242u) {}
+
+    float next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return float(m_state & 0xffffff) / float(0x1000000);
+    }
+
+private:
+    uint32_t m_state;
+};
+
+static b2AABB
+segment_aabb(const b2Vec2 &center)
+{
+    // About the size of one stroke segment (10 x 3 pixels)
+    b2Vec2 extent(0.5f, 0.15f);
+
+    b2AABB aabb;
+    aabb.lowerBound = center - extent;
+    aabb.upperBound = center + extent;
+    return aabb;
+}
+
+BroadPhaseResult
+Benchmark::broadphase(int proxies, int frames)
+{
+    BroadPhaseResult result(proxies);
+
+    BroadPhaseCounter counter;
+    BroadPhaseRandom random;
+    b2BroadPhase *broadPhase = new b2BroadPhase(&counter);
+
+    // Rows of slightly overlapping segments, like strokes drawn across the level
+    int columns = std::max(1, int(std::sqrt(float(proxies))));
+    std::vector<b2Vec2> centers(proxies);
+    std::vector<int32> ids(proxies);
+    for (int i=0; i<proxies; i++) {
+        centers[i].Set(0.9f * (i % columns) + 0.2f * random.next(),
+                       0.6f * (i / columns) + 0.2f * random.next());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<proxies; i++) {
+        ids[i] = broadPhase->CreateProxy(segment_aabb(centers[i]), nullptr);
+    }
+    broadPhase->Commit();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.nsPerCreate = elapsed.count() * 1e9 / std::max(1, proxies);
+
+    long added = counter.added;
+    std::vector<b2Vec2> offsets(proxies, b2Vec2_zero);
+    long moves = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (int frame=0; frame<frames; frame++) {
+        for (int i=frame % 10; i<proxies; i+=10) {
+            // Wander around the original position, at most one metre away
+            b2Vec2 d(0.4f * (random.next() - 0.5f), 0.4f * (random.next() - 0.5f));
+            if ((offsets[i] + d).LengthSquared() > 1.0f) {
+                d = -d;
+            }
+
+            b2AABB aabb = segment_aabb(centers[i] + offsets[i]);
+            offsets[i] += d;
+            aabb.Combine(aabb, segment_aabb(centers[i] + offsets[i]));
+
+            broadPhase->MoveProxy(ids[i], aabb, d);
+            moves++;
+        }
+        broadPhase->Commit();
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+
+    if (frames > 0) {
+        result.nsPerFrame = elapsed.count() * 1e9 / frames;
+        result.pairsAdded = double(counter.added - added) / frames;
+    }
+    if (moves > 0) {
+        result.nsPerMove = elapsed.count() * 1e9 / moves;
+    }
+    result.pairs = broadPhase->m_pairManager.m_pairCount;
+    result.height = broadPhase->m_tree.GetHeight();
+
+    delete broadPhase;
+
+    return result;
+}
+
+SolverResult
+Benchmark::solver(int boxes, int steps, b2ContactSolverType type)
+{
+    SolverResult result(boxes);
+
+    // No sleeping, or the settled pyramids would stop being solved
+    b2World world(b2Vec2(0.0f, 10.0f), false);
+    world.SetContactSolver(type);
+
+    // Pyramids of ten rows, one metre boxes
+    const int rows = 10;
+    const int perPyramid = rows * (rows + 1) / 2;
+    int pyramids = std::max(1, (boxes + perPyramid - 1) / perPyramid);
+
+    b2BodyDef groundDef;
+    groundDef.position.Set(0.0f, 1.0f);
+    b2Body *ground = world.CreateBody(&groundDef);
+    b2PolygonDef groundShape;
+    groundShape.SetAsBox(pyramids * 6.0f + 1.0f, 1.0f, b2Vec2(pyramids * 6.0f, 0.0f), 0.0f);
+    ground->CreateShape(&groundShape);
+
+    b2PolygonDef box;
+    box.SetAsBox(0.5f, 0.5f);
+    box.density = 1.0f;
+    box.friction = 0.6f;
+
+    int created = 0;
+    for (int p=0; p<pyramids && created<boxes; p++) {
+        for (int row=0; row<rows && created<boxes; row++) {
+            for (int i=0; i<rows-row && created<boxes; i++) {
+                b2BodyDef def;
+                def.position.Set(p * 12.0f + 1.0f + row * 0.5f + i * 1.0f, -0.5f - row * 1.0f);
+                b2Body *body = world.CreateBody(&def);
+                body->CreateShape(&box);
+                body->SetMassFromShapes();
+                created++;
+            }
+        }
+    }
+
+    // Let the pyramids settle, so that every step has the same contacts
+    for (int i=0; i<ITERATION_RATE; i++) {
+        world.Step(ITERATION_TIMESTEPf, SOLVER_ITERATIONS);
+    }
+
+    long contacts = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<steps; i++) {
+        world.Step(ITERATION_TIMESTEPf, SOLVER_ITERATIONS);
+        contacts += world.GetContactCount();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (steps > 0) {
+        result.nsPerStep = elapsed.count() * 1e9 / steps;
+        result.contacts = double(contacts) / steps;
+    }
+    result.checksum = BatchRunner::checksum(&world);
+
+    return result;
+}
+
+static void
+create_ground(b2World &world, float32 width)
+{
+    // A floor at y = 0 with walls on both sides, gravity points down (+y)
+    b2BodyDef def;
+    b2Body *ground = world.CreateBody(&def);
+
+    b2PolygonDef shape;
+    shape.friction = 0.6f;
+    shape.SetAsBox(width + 1.0f, 0.5f, b2Vec2(0.0f, 0.5f), 0.0f);
+    ground->CreateShape(&shape);
+    shape.SetAsBox(0.5f, 20.0f, b2Vec2(-width - 0.5f, -20.0f), 0.0f);
+    ground->CreateShape(&shape);
+    shape.SetAsBox(0.5f, 20.0f, b2Vec2(width + 0.5f, -20.0f), 0.0f);
+    ground->CreateShape(&shape);
+}
+
+static void
+create_pile(b2World &world, int bodies)
+{
+    BroadPhaseRandom random;
+
+    // Bricks dropped at random angles into a box, piling up several layers high
+    int columns = std::max(2, int(std::sqrt(float(bodies))));
+    float32 width = columns * 0.5f;
+    create_ground(world, width);
+
+    b2PolygonDef brick;
+    brick.SetAsBox(0.4f, 0.2f);
+    brick.density = 1.0f;
+    brick.friction = 0.6f;
+
+    for (int i=0; i<bodies; i++) {
+        b2BodyDef def;
+        def.position.Set(-width + 0.5f + (i % columns) * 1.0f + 0.2f * random.next(),
+                         -1.0f - (i / columns) * 1.0f);
+        def.angle = 3.14159265f * random.next();
+        b2Body *body = world.CreateBody(&def);
+        body->CreateShape(&brick);
+        body->SetMassFromShapes();
+    }
+}
+
+static void
+create_ropes(b2World &world, int bodies)
+{
+    // Ropes of thin links hanging from the ceiling next to each other,
+    // long enough for their lower half to coil up on the floor and into
+    // the neighbouring ropes
+    const int links = 40;
+    const float32 linkLength = 0.5f;
+    int ropes = std::max(1, bodies / links);
+    float32 width = ropes * 0.6f + 2.0f;
+    create_ground(world, width);
+
+    b2Body *ceiling = world.GetGroundBody();
+
+    b2PolygonDef link;
+    link.SetAsBox(0.06f, 0.5f * linkLength);
+    link.density = 1.0f;
+    link.friction = 0.6f;
+
+    float32 top = -0.5f * links * linkLength;
+    for (int r=0; r<ropes; r++) {
+        b2Vec2 anchor(-0.5f * width + 1.0f + r * 0.6f, top);
+        b2Body *previous = ceiling;
+        for (int i=0; i<links; i++) {
+            b2BodyDef def;
+            def.position = anchor + b2Vec2(0.0f, (i + 0.5f) * linkLength);
+            b2Body *body = world.CreateBody(&def);
+            body->CreateShape(&link);
+            body->SetMassFromShapes();
+
+            // Swing neighbouring ropes towards each other
+            float32 swing = (r % 2) ? -2.0f : 2.0f;
+            body->SetLinearVelocity(b2Vec2(swing * i / links, 0.0f));
+
+            b2RevoluteJointDef joint;
+            joint.Initialize(previous, body, anchor + b2Vec2(0.0f, i * linkLength));
+            world.CreateJoint(&joint);
+            previous = body;
+        }
+    }
+}
+
+// None of the joints above collide their bodies
+static bool
+jointed(b2Body *a, b2Body *b)
+{
+    for (b2JointEdge *edge=a->GetJointList(); edge; edge=edge->next) {
+        if (edge->other == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+NarrowPhaseResult
+Benchmark::narrowphase(NarrowPhaseScene scene, int bodies, int repeats)
+{
+    NarrowPhaseResult result(scene, bodies);
+
+    b2World world(b2Vec2(0.0f, 10.0f), true);
+    if (scene == NARROW_PHASE_ROPE) {
+        create_ropes(world, bodies);
+    } else {
+        create_pile(world, bodies);
+    }
+
+    for (int i=0; i<ITERATION_RATE * 5; i++) {
+        world.Step(ITERATION_TIMESTEPf, SOLVER_ITERATIONS);
+    }
+
+    // The same candidate pairs as the broadphase would report, minus the
+    // ones the contact filter drops (static pairs and jointed links)
+    struct Box {
+        const b2PolygonShape *shape;
+        b2Body *body;
+        b2AABB aabb;
+    };
+
+    std::vector<Box> boxes;
+    for (b2Body *body=world.GetBodyList(); body; body=body->GetNext()) {
+        for (b2Shape *shape=body->GetShapeList(); shape; shape=shape->GetNext()) {
+            if (shape->GetType() != e_polygonShape) {
+                continue;
+            }
+
+            Box box;
+            box.shape = (const b2PolygonShape *)shape;
+            box.body = body;
+            if (!box.shape->IsBox()) {
+                continue;
+            }
+            shape->ComputeAABB(&box.aabb, body->GetXForm());
+            b2Vec2 extension(b2_aabbExtension, b2_aabbExtension);
+            box.aabb.lowerBound -= extension;
+            box.aabb.upperBound += extension;
+            boxes.push_back(box);
+        }
+    }
+
+    std::vector<std::pair<const Box *, const Box *>> pairs;
+    for (size_t i=0; i<boxes.size(); i++) {
+        for (size_t j=i+1; j<boxes.size(); j++) {
+            const Box &a = boxes[i];
+            const Box &b = boxes[j];
+            if (a.body == b.body || (a.body->IsStatic() && b.body->IsStatic()) ||
+                    jointed(a.body, b.body) || !b2TestOverlap(a.aabb, b.aabb)) {
+                continue;
+            }
+            pairs.push_back(std::make_pair(&a, &b));
+        }
+    }
+    result.pairs = pairs.size();
+
+    for (auto &pair: pairs) {
+        const b2XForm &xf1 = pair.first->body->GetXForm();
+        const b2XForm &xf2 = pair.second->body->GetXForm();
+
+        // Zeroed, so that the impulses left alone by both compare equal
+        b2Manifold generic = b2Manifold();
+        b2Manifold boxed = b2Manifold();
+        b2CollidePolygons(&generic, pair.first->shape, xf1, pair.second->shape, xf2);
+        b2CollideBoxes(&boxed, pair.first->shape, xf1, pair.second->shape, xf2);
+
+        if (generic.pointCount > 0) {
+            result.touching++;
+        }
+        if (generic.pointCount != boxed.pointCount ||
+                (generic.pointCount > 0 && memcmp(&generic, &boxed, sizeof(generic)) != 0)) {
+            result.mismatches++;
+        }
+    }
+
+    if (pairs.empty() || repeats <= 0) {
+        return result;
+    }
+
+    // Summed up so that neither loop can be optimized away
+    long points = 0;
+    b2Manifold manifold;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r=0; r<repeats; r++) {
+        for (auto &pair: pairs) {
+            b2CollidePolygons(&manifold, pair.first->shape, pair.first->body->GetXForm(),
+                              pair.second->shape, pair.second->body->GetXForm());
+            points += manifold.pointCount;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.nsGeneric = elapsed.count() * 1e9 / (double(repeats) * pairs.size());
+
+    start = std::chrono::steady_clock::now();
+    for (int r=0; r<repeats; r++) {
+        for (auto &pair: pairs) {
+            b2CollideBoxes(&manifold, pair.first->shape, pair.first->body->GetXForm(),
+                           pair.second->shape, pair.second->body->GetXForm());
+            points -= manifold.pointCount;
+        }
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    result.nsBoxes = elapsed.count() * 1e9 / (double(repeats) * pairs.size());
+
+    if (points != 0) {
+        LOG_WARNING("Box and polygon collision found different contact points");
+    }
+
+    return result;
+}
@@ -0,0 +1,182 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_BENCHMARK_H
+#define NUMPTYPHYSICS_BENCHMARK_H
+
+#include "Box2D.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+struct BenchmarkResult {
+    BenchmarkResult(const std::string &filename, bool replay)
+        : filename(filename)
+        , replay(replay)
+        , loaded(false)
+        , steps(0)
+        , nsPerStep(0.0)
+        , bodies(0)
+        , proxies(0.0)
+        , pairs(0.0)
+        , contacts(0.0)
+        , islands(0.0)
+        , toiQueries(0.0)
+        , toiEvents(0.0)
+        , peakBytes(0)
+    {
+    }
+
+    // Baseline lookup key, e.g. "data/L99_Sample.npsvg:replay"
+    std::string key() const { return filename + (replay ? ":replay" : ":free"); }
+
+    std::string filename;
+    bool replay;
+    bool loaded;
+    int steps;
+    double nsPerStep;
+    int bodies;
+
+    // Averages per step
+    double proxies;
+    double pairs;
+    double contacts;
+    double islands;
+
+    // Time of impact computations, and the TOI sub-steps they caused
+    double toiQueries;
+    double toiEvents;
+
+    // High-water mark of the Box2D heap while loading and stepping
+    long peakBytes;
+};
+
+struct BroadPhaseResult {
+    BroadPhaseResult(int proxies)
+        : proxies(proxies)
+        , nsPerCreate(0.0)
+        , nsPerFrame(0.0)
+        , nsPerMove(0.0)
+        , pairs(0)
+        , pairsAdded(0)
+        , height(0)
+    {
+    }
+
+    int proxies;
+
+    // Inserting all proxies, including the first Commit()
+    double nsPerCreate;
+
+    // MoveProxy() for every moving proxy plus one Commit()
+    double nsPerFrame;
+    double nsPerMove;
+
+    // Pairs alive after the last frame, and PairAdded() calls per frame
+    int pairs;
+    double pairsAdded;
+    int height;
+};
+
+struct SolverResult {
+    SolverResult(int boxes)
+        : boxes(boxes)
+        , nsPerStep(0.0)
+        , contacts(0.0)
+        , checksum(0)
+    {
+    }
+
+    int boxes;
+    double nsPerStep;
+    double contacts;
+
+    // BatchRunner::checksum() after the last step
+    uint32_t checksum;
+};
+
+enum NarrowPhaseScene {
+    NARROW_PHASE_PILE,
+    NARROW_PHASE_ROPE,
+};
+
+struct NarrowPhaseResult {
+    NarrowPhaseResult(NarrowPhaseScene scene, int bodies)
+        : scene(scene)
+        , bodies(bodies)
+        , pairs(0)
+        , touching(0)
+        , nsGeneric(0.0)
+        , nsBoxes(0.0)
+        , mismatches(0)
+    {
+    }
+
+    NarrowPhaseScene scene;
+    int bodies;
+
+    // Box pairs whose fattened AABBs overlap, i.e. the contacts Box2D
+    // would evaluate, and how many of them touch
+    int pairs;
+    int touching;
+
+    // Per pair, b2CollidePolygons() and b2CollideBoxes()
+    double nsGeneric;
+    double nsBoxes;
+
+    // Pairs for which the two manifolds are not bit for bit the same
+    int mismatches;
+};
+
+/**
+ * Steps each level for a fixed number of ticks, with its recorded
+ * event log ("replay") and without it ("free"). Runs are strictly
+ * sequential, both for stable timings and because the Box2D allocation
+ * counter used for peakBytes is global.
+ **/
+class Benchmark {
+public:
+    Benchmark(int ticks);
+
+    BenchmarkResult run(const std::string &filename, bool replay);
+
+    // Format is picked by extension: ".json" writes JSON, anything else CSV
+    static bool write(const std::string &filename, int ticks,
+                      const std::vector<BenchmarkResult> &results);
+
+    // Reads ns/step per BenchmarkResult::key() from an earlier CSV output
+    static bool readBaseline(const std::string &filename,
+                             std::map<std::string, double> &nsPerStep);
+
+    // Pair update cost of a bare b2BroadPhase filled with PROXIES stroke
+    // segment sized boxes, of which a tenth move in every frame
+    static BroadPhaseResult broadphase(int proxies, int frames);
+
+    // Pyramids of BOXES boxes in total that never fall asleep, stepped with
+    // the given contact solver. Collision costs the same for every solver,
+    // so differences in ns/step are the velocity solver.
+    static SolverResult solver(int boxes, int steps, b2ContactSolverType type);
+
+    // Settles a scene of BODIES boxes (or rope links), then collides every
+    // box pair REPEATS times with the generic polygon and the box routine
+    static NarrowPhaseResult narrowphase(NarrowPhaseScene scene, int bodies, int repeats);
+
+private:
+    int m_ticks;
+};
+
+#endif /* NUMPTYPHYSICS_BENCHMARK_H */
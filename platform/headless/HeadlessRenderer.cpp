@@ -0,0 +1,178 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "HeadlessRenderer.h"
+
+#include <cstring>
+
+
+HeadlessRenderer::HeadlessRenderer(Vec2 world_size)
+    : m_world_size(world_size)
+    , m_clip(Rect(Vec2(0, 0), world_size))
+{
+}
+
+HeadlessRenderer::~HeadlessRenderer()
+{
+}
+
+Vec2
+HeadlessRenderer::framebuffer_size()
+{
+    return m_world_size;
+}
+
+Vec2
+HeadlessRenderer::world_size()
+{
+    return m_world_size;
+}
+
+NP::Texture
+HeadlessRenderer::decode(const char *filename)
+{
+    // Nothing is decoded, so pretend every image covers the whole world
+    return NP::Texture(new NP::TextureData(m_world_size.x, m_world_size.y));
+}
+
+NP::Texture
+HeadlessRenderer::load(unsigned char *pixels, int w, int h)
+{
+    return NP::Texture(new NP::TextureData(w, h));
+}
+
+NP::Framebuffer
+HeadlessRenderer::framebuffer(Vec2 size)
+{
+    return NP::Framebuffer(new NP::FramebufferData(size.x, size.y));
+}
+
+void
+HeadlessRenderer::begin(NP::Framebuffer &rendertarget, Rect world_rect)
+{
+}
+
+void
+HeadlessRenderer::end(NP::Framebuffer &rendertarget)
+{
+}
+
+NP::Texture
+HeadlessRenderer::retrieve(NP::Framebuffer &rendertarget)
+{
+    return NP::Texture(new NP::TextureData(rendertarget->w, rendertarget->h));
+}
+
+bool
+HeadlessRenderer::read(NP::Framebuffer &rendertarget, unsigned char *rgba)
+{
+    // Nothing was drawn
+    return false;
+}
+
+Rect
+HeadlessRenderer::clip(Rect rect)
+{
+    std::swap(rect, m_clip);
+    return rect;
+}
+
+void
+HeadlessRenderer::image(const NP::Texture &texture, int x, int y, int w, int h)
+{
+}
+
+void
+HeadlessRenderer::subimage(const NP::Texture &texture, const Rect &src, const Rect &dst)
+{
+}
+
+void
+HeadlessRenderer::blur(const NP::Texture &texture, const Rect &src, const Rect &dst, float rx, float ry)
+{
+}
+
+void
+HeadlessRenderer::rewind(const NP::Texture &texture, const Rect &src, const Rect &dst, float t, float a)
+{
+}
+
+void
+HeadlessRenderer::saturation(const NP::Texture &texture, const Rect &src, const Rect &dst, float a)
+{
+}
+
+void
+HeadlessRenderer::rectangle(const Rect &rect, int rgba, bool fill)
+{
+}
+
+void
+HeadlessRenderer::path(const Path &path, int rgba)
+{
+}
+
+void
+HeadlessRenderer::lines(const float *x, const float *y, int count, const b2Vec2 &delta, int rgba)
+{
+}
+
+NP::Mesh
+HeadlessRenderer::mesh(const Path &path)
+{
+    return NP::Mesh(new NP::MeshData());
+}
+
+void
+HeadlessRenderer::path(const NP::Mesh &mesh, const b2Vec2 &pos, float angle, int rgba)
+{
+}
+
+NP::Font
+HeadlessRenderer::load(const char *filename, int size)
+{
+    return NP::Font(new NP::FontData(size));
+}
+
+void
+HeadlessRenderer::metrics(const NP::Font &font, const char *text, int *width, int *height)
+{
+    // Rough estimate, good enough for laying out widgets nobody will see
+    *width = strlen(text) * font->size / 2;
+    *height = font->size;
+}
+
+NP::Texture
+HeadlessRenderer::text(const NP::Font &font, const char *text, int rgb)
+{
+    int w, h;
+    metrics(font, text, &w, &h);
+    return NP::Texture(new NP::TextureData(w, h));
+}
+
+void
+HeadlessRenderer::clear()
+{
+}
+
+void
+HeadlessRenderer::flush()
+{
+}
+
+void
+HeadlessRenderer::swap()
+{
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_HEADLESSRENDERER_H
+#define NUMPTYPHYSICS_HEADLESSRENDERER_H
+
+#include "Renderer.h"
+
+// Renderer that accepts all drawing calls and discards them, so that
+// scenes can be stepped and "drawn" without a display or GL context
+class HeadlessRenderer : public NP::Renderer {
+public:
+    HeadlessRenderer(Vec2 world_size);
+    ~HeadlessRenderer();
+
+    virtual Vec2 framebuffer_size();
+    virtual Vec2 world_size();
+
+    virtual NP::Texture load(unsigned char *pixels, int w, int h);
+
+    virtual NP::Framebuffer framebuffer(Vec2 size);
+    virtual void begin(NP::Framebuffer &rendertarget, Rect world_rect);
+    virtual void end(NP::Framebuffer &rendertarget);
+    virtual NP::Texture retrieve(NP::Framebuffer &rendertarget);
+    virtual bool read(NP::Framebuffer &rendertarget, unsigned char *rgba);
+
+    virtual Rect clip(Rect rect);
+
+    virtual void image(const NP::Texture &texture, int x, int y, int w, int h);
+    virtual void subimage(const NP::Texture &texture, const Rect &src, const Rect &dst);
+    virtual void blur(const NP::Texture &texture, const Rect &src, const Rect &dst, float rx, float ry);
+    virtual void rewind(const NP::Texture &texture, const Rect &src, const Rect &dst, float t, float a);
+    virtual void saturation(const NP::Texture &texture, const Rect &src, const Rect &dst, float a);
+    virtual void rectangle(const Rect &rect, int rgba, bool fill);
+    virtual void path(const Path &path, int rgba);
+    virtual void lines(const float *x, const float *y, int count, const b2Vec2 &delta, int rgba);
+
+    virtual NP::Mesh mesh(const Path &path);
+    virtual void path(const NP::Mesh &mesh, const b2Vec2 &pos, float angle, int rgba);
+
+    virtual NP::Font load(const char *filename, int size);
+
+    virtual void metrics(const NP::Font &font, const char *text, int *width, int *height);
+    virtual NP::Texture text(const NP::Font &font, const char *text, int rgb);
+
+    virtual void clear();
+    virtual void flush();
+    virtual void swap();
+
+protected:
+    virtual NP::Texture decode(const char *filename);
+
+private:
+    Vec2 m_world_size;
+    Rect m_clip;
+};
+
+#endif /* NUMPTYPHYSICS_HEADLESSRENDERER_H */
@@ -0,0 +1,599 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "Os.h"
+#include "Config.h"
+#include "Levels.h"
+
+#include "HeadlessRenderer.h"
+#include "BatchRunner.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "Scene.h"
+
+#include "thp_format.h"
+#include "thp_jobpool.h"
+#include "petals_log.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unistd.h>
+#include <sys/resource.h>
+
+
+class OsHeadless : public Os {
+public:
+    OsHeadless()
+        : Os()
+        , m_renderer(nullptr)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~OsHeadless()
+    {
+        delete m_renderer;
+    }
+
+    virtual void init()
+    {
+    }
+
+    virtual void window(Vec2 world_size)
+    {
+        if (!m_renderer) {
+            m_renderer = new HeadlessRenderer(world_size);
+        }
+    }
+
+    virtual NP::Renderer *renderer()
+    {
+        return m_renderer;
+    }
+
+    virtual bool nextEvent(ToolkitEvent &ev)
+    {
+        return false;
+    }
+
+    virtual long ticks()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    }
+
+    virtual void delay(int ms)
+    {
+        usleep(ms * 1000);
+    }
+
+    virtual bool openBrowser(const char *url)
+    {
+        return false;
+    }
+
+    virtual std::string userDataDir()
+    {
+        const char *xdg = getenv("XDG_DATA_HOME");
+        if (xdg && *xdg) {
+            return thp::format("%s/%s", xdg, APP);
+        }
+
+        const char *home = getenv("HOME");
+        return thp::format("%s/.local/share/%s", home ? home : ".", APP);
+    }
+
+private:
+    HeadlessRenderer *m_renderer;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+
+static void
+usage(const char *progname)
+{
+    printf("Usage: %s [--timeout TICKS] [--jobs N] [--physics-threads N] [--contact-solver NAME] [--profile-out FILE] LEVEL|DIR...\n"
+           "       %s --bench TICKS [--physics-threads N] [--contact-solver NAME] [--bench-out FILE] [--baseline FILE] [--threshold PCT] LEVEL|DIR...\n"
+           "       %s --bench-broadphase PROXIES\n"
+           "       %s --bench-solver BOXES\n"
+           "       %s --bench-narrowphase BODIES\n"
+           "       %s --check-solver [--timeout TICKS] [--jobs N] LEVEL|DIR...\n"
+           "       %s --check-rewind [--rewind-at TICK] [--timeout TICKS] [--jobs N] LEVEL|DIR...\n"
+           "\n"
+           "Replays the recorded events of each level without a display and\n"
+           "reports whether (and at which tick) the level was completed.\n"
+           "\n"
+           "  --timeout TICKS     Ticks to simulate after the last event (default: %d)\n"
+           "  --jobs N            Number of worker threads (default: one per CPU core)\n"
+           "  --physics-threads N Threads solving the islands of each level (default: %d)\n"
+           "  --contact-solver NAME  sequential (default), batched or batched-scalar\n"
+           "  --profile-out FILE  Write a Chrome trace-event profile to FILE\n"
+           "\n"
+           "With --bench, every level is instead stepped for TICKS ticks with and\n"
+           "without its recorded events, one level at a time.\n"
+           "\n"
+           "  --bench-out FILE    Write results as CSV (or JSON if FILE ends in .json)\n"
+           "  --baseline FILE     Compare ns/step against the CSV of an earlier run\n"
+           "  --threshold PCT     Fail if the geometric mean slowdown exceeds PCT (default: %.0f)\n"
+           "\n"
+           "With --bench-broadphase, no levels are loaded. The pair update cost of\n"
+           "the Box2D broadphase is measured with 1000 up to PROXIES moving boxes.\n"
+           "\n"
+           "With --bench-solver, no levels are loaded. Pyramids of 55 up to BOXES\n"
+           "boxes are stepped with each contact solver.\n"
+           "\n"
+           "With --bench-narrowphase, no levels are loaded. A pile of BODIES boxes\n"
+           "and ropes of BODIES links are collided with the generic polygon and\n"
+           "the box routine, which must find the same contacts.\n"
+           "\n"
+           "With --check-solver, every level is run with each contact solver.\n"
+           "Fails if the batched solver with and without SIMD do not end in\n"
+           "exactly the same state, or if a recorded solution that works with\n"
+           "the sequential solver fails with the batched one.\n"
+           "\n"
+           "With --check-rewind, the recorded events of every level are played\n"
+           "as if live, once straight and once with a rewind at tick TICK, as the\n"
+           "game does it. Fails if the two runs do not end in exactly the same\n"
+           "state.\n"
+           "\n"
+           "  --rewind-at TICK    Tick of the rewind (default: %d)\n",
+           progname, progname, progname, progname, progname, progname, progname, ITERATION_RATE * 30,
+           PHYSICS_THREADS, BENCHMARK_THRESHOLD, ITERATION_RATE * 5);
+}
+
+static const struct {
+    const char *name;
+    b2ContactSolverType type;
+} CONTACT_SOLVERS[] = {
+    {"sequential", e_sequentialSolver},
+    {"batched-scalar", e_batchedScalarSolver},
+    {"batched", e_batchedSolver},
+};
+
+static bool
+parse_contact_solver(const char *name, b2ContactSolverType &type)
+{
+    for (auto &solver: CONTACT_SOLVERS) {
+        if (strcmp(name, solver.name) == 0) {
+            type = solver.type;
+            return true;
+        }
+    }
+
+    LOG_WARNING("Unknown contact solver: %s", name);
+    return false;
+}
+
+static int
+benchmark(Levels &levels, int ticks, const std::string &out,
+          const std::string &baselineFile, double threshold)
+{
+    std::map<std::string, double> baseline;
+    if (!baselineFile.empty() && !Benchmark::readBaseline(baselineFile, baseline)) {
+        return 1;
+    }
+
+    Benchmark bench(ticks);
+    std::vector<BenchmarkResult> results;
+    for (int i=0; i<levels.numLevels(); i++) {
+        for (bool replay: {true, false}) {
+            results.push_back(bench.run(levels.levelName(i, false), replay));
+        }
+    }
+
+    int failures = 0;
+    int compared = 0;
+    double logRatios = 0.0;
+    printf("%-6s %10s %6s %8s %8s %8s %8s %8s %8s %9s  %s\n", "mode", "ns/step", "bodies",
+           "proxies", "pairs", "islands", "toi", "toi ev", "peak KiB", "baseline", "level");
+    for (auto &result: results) {
+        if (!result.loaded) {
+            printf("%-6s %10s  %s\n", "ERROR", "-", result.filename.c_str());
+            failures++;
+            continue;
+        }
+
+        std::string change = "-";
+        auto it = baseline.find(result.key());
+        if (it != baseline.end() && it->second > 0.0 && result.nsPerStep > 0.0) {
+            double ratio = result.nsPerStep / it->second;
+            logRatios += log(ratio);
+            compared++;
+            change = thp::format("%+.1f%%", (ratio - 1.0) * 100.0);
+        }
+
+        printf("%-6s %10.0f %6d %8.1f %8.1f %8.1f %8.2f %8.2f %8ld %9s  %s\n",
+               result.replay ? "replay" : "free", result.nsPerStep, result.bodies,
+               result.proxies, result.pairs, result.islands, result.toiQueries,
+               result.toiEvents, result.peakBytes / 1024,
+               change.c_str(), result.filename.c_str());
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%d runs of %d ticks, %d failed to load, peak RSS %ld KiB\n",
+           int(results.size()), ticks, failures, long(usage.ru_maxrss));
+
+    if (!out.empty() && !Benchmark::write(out, ticks, results)) {
+        return 1;
+    }
+
+    if (compared > 0) {
+        // Geometric mean, so a few tiny (noisy) levels don't dominate
+        double change = (exp(logRatios / compared) - 1.0) * 100.0;
+        printf("%+.1f%% ns/step vs. baseline over %d runs (threshold %.1f%%)\n",
+               change, compared, threshold);
+        if (change > threshold) {
+            LOG_WARNING("Performance regression: %+.1f%% ns/step", change);
+            return 1;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
+
+static int
+benchmark_broadphase(int maxProxies)
+{
+    const int frames = 100;
+
+    printf("%8s %10s %10s %10s %9s %9s %6s\n", "proxies", "ns/create", "ns/frame",
+           "ns/move", "pairs", "added/fr", "height");
+
+    for (int proxies=1000; proxies<=maxProxies; proxies*=2) {
+        BroadPhaseResult result = Benchmark::broadphase(proxies, frames);
+        printf("%8d %10.0f %10.0f %10.0f %9d %9.1f %6d\n", result.proxies,
+               result.nsPerCreate, result.nsPerFrame, result.nsPerMove,
+               result.pairs, result.pairsAdded, result.height);
+    }
+
+    return 0;
+}
+
+static int
+benchmark_solver(int maxBoxes)
+{
+    const int steps = ITERATION_RATE * 5;
+
+    printf("%6s %-15s %10s %9s %8s %10s\n", "boxes", "solver", "ns/step", "contacts",
+           "speedup", "checksum");
+
+    int failures = 0;
+    for (int boxes=55; boxes<=maxBoxes; boxes*=2) {
+        std::map<b2ContactSolverType, SolverResult> results;
+        for (auto &solver: CONTACT_SOLVERS) {
+            SolverResult result = Benchmark::solver(boxes, steps, solver.type);
+            results.insert(std::make_pair(solver.type, result));
+
+            double sequential = results.at(e_sequentialSolver).nsPerStep;
+            printf("%6d %-15s %10.0f %9.1f %7.2fx %08x\n", boxes, solver.name,
+                   result.nsPerStep, result.contacts,
+                   result.nsPerStep > 0.0 ? sequential / result.nsPerStep : 0.0,
+                   result.checksum);
+        }
+
+        if (results.at(e_batchedSolver).checksum != results.at(e_batchedScalarSolver).checksum) {
+            LOG_WARNING("Batched solver differs with and without SIMD (%d boxes)", boxes);
+            failures++;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
+
+static int
+benchmark_narrowphase(int bodies)
+{
+    const int repeats = 200;
+
+    static const struct {
+        const char *name;
+        NarrowPhaseScene scene;
+    } SCENES[] = {
+        {"pile", NARROW_PHASE_PILE},
+        {"rope", NARROW_PHASE_ROPE},
+    };
+
+    printf("%-6s %7s %7s %9s %11s %9s %8s %10s\n", "scene", "bodies", "pairs", "touching",
+           "ns/polygon", "ns/box", "speedup", "mismatches");
+
+    int failures = 0;
+    for (auto &scene: SCENES) {
+        NarrowPhaseResult result = Benchmark::narrowphase(scene.scene, bodies, repeats);
+        printf("%-6s %7d %7d %9d %11.1f %9.1f %7.2fx %10d\n", scene.name, result.bodies,
+               result.pairs, result.touching, result.nsGeneric, result.nsBoxes,
+               result.nsBoxes > 0.0 ? result.nsGeneric / result.nsBoxes : 0.0,
+               result.mismatches);
+
+        if (result.mismatches > 0) {
+            LOG_WARNING("Box collision differs from polygon collision (%s)", scene.name);
+            failures++;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
+
+static int
+check_solver(Levels &levels, int timeout, int jobs)
+{
+    BatchRunner runner(timeout);
+
+    std::map<b2ContactSolverType, std::vector<BatchResult>> results;
+    for (auto &solver: CONTACT_SOLVERS) {
+        std::vector<BatchResult> &solverResults = results[solver.type];
+        for (int i=0; i<levels.numLevels(); i++) {
+            solverResults.push_back(BatchResult(levels.levelName(i, false)));
+        }
+
+        // Scenes pick up the solver when they create their world
+        Scene::setContactSolver(solver.type);
+
+        thp::JobPool pool(jobs);
+        for (auto &result: solverResults) {
+            pool.submit([&runner, &result] () {
+                result = runner.run(result.filename);
+            });
+        }
+        pool.wait();
+    }
+    Scene::setContactSolver(CONTACT_SOLVER);
+
+    // Levels without a recorded solution still run for the timeout, so
+    // they are compared too
+    int failures = 0;
+    printf("%-8s %10s %10s %10s  %s\n", "result", "sequential", "scalar", "batched", "level");
+    for (int i=0; i<levels.numLevels(); i++) {
+        const BatchResult &sequential = results[e_sequentialSolver][i];
+        const BatchResult &scalar = results[e_batchedScalarSolver][i];
+        const BatchResult &batched = results[e_batchedSolver][i];
+
+        const char *status = "-";
+        if (!sequential.loaded) {
+            status = "ERROR";
+        } else if (batched.checksum != scalar.checksum ||
+                   batched.completionTick != scalar.completionTick) {
+            status = "DIFFER";
+        } else if (batched.failed() && !sequential.failed()) {
+            status = "FAIL";
+        } else if (sequential.events > 0) {
+            status = "PASS";
+        }
+
+        printf("%-8s %10d %10d %10d  %s\n", status, sequential.completionTick,
+               scalar.completionTick, batched.completionTick, sequential.filename.c_str());
+
+        if (strcmp(status, "-") != 0 && strcmp(status, "PASS") != 0) {
+            failures++;
+        }
+    }
+
+    printf("%d levels, %d failed\n", levels.numLevels(), failures);
+
+    return failures ? 1 : 0;
+}
+
+static int
+check_rewind(Levels &levels, int timeout, int jobs, int rewindAt)
+{
+    BatchRunner runner(timeout);
+
+    std::vector<BatchResult> straight, rewound;
+    for (int i=0; i<levels.numLevels(); i++) {
+        straight.push_back(BatchResult(levels.levelName(i, false)));
+        rewound.push_back(straight.back());
+    }
+
+    {
+        thp::JobPool pool(jobs);
+        for (int i=0; i<levels.numLevels(); i++) {
+            pool.submit([&runner, &straight, i] () {
+                straight[i] = runner.play(straight[i].filename, -1);
+            });
+            pool.submit([&runner, &rewound, i, rewindAt] () {
+                rewound[i] = runner.play(rewound[i].filename, rewindAt);
+            });
+        }
+        pool.wait();
+    }
+
+    int failures = 0;
+    printf("%-8s %8s %8s  %s\n", "result", "straight", "rewound", "level");
+    for (int i=0; i<levels.numLevels(); i++) {
+        const char *status = "-";
+        if (!straight[i].loaded) {
+            status = "ERROR";
+        } else if (straight[i].checksum != rewound[i].checksum ||
+                   straight[i].completionTick != rewound[i].completionTick) {
+            status = "DIFFER";
+        } else if (rewound[i].rewound) {
+            status = "PASS";
+        }
+
+        printf("%-8s %8d %8d  %s\n", status, straight[i].completionTick,
+               rewound[i].completionTick, straight[i].filename.c_str());
+
+        if (strcmp(status, "-") != 0 && strcmp(status, "PASS") != 0) {
+            failures++;
+        }
+    }
+
+    printf("%d levels, %d failed\n", levels.numLevels(), failures);
+
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::shared_ptr<Os> os(new OsHeadless());
+
+    int timeout = ITERATION_RATE * 30;
+    int jobs = 0;
+    std::string profileOut;
+    int benchTicks = 0;
+    int benchProxies = 0;
+    int benchBoxes = 0;
+    int benchBodies = 0;
+    bool checkSolver = false;
+    bool checkRewind = false;
+    int rewindAt = ITERATION_RATE * 5;
+    std::string benchOut;
+    std::string baseline;
+    double threshold = BENCHMARK_THRESHOLD;
+    std::vector<std::string> paths;
+
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--version") == 0) {
+            printf("%s %s\n", APP, VERSION);
+            return 0;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else if (i < argc-1 && strcmp(argv[i], "--timeout") == 0) {
+            timeout = atoi(argv[++i]);
+        } else if (i < argc-1 && (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0)) {
+            jobs = atoi(argv[++i]);
+        } else if (i < argc-1 && strcmp(argv[i], "--physics-threads") == 0) {
+            Scene::setPhysicsThreads(atoi(argv[++i]));
+        } else if (i < argc-1 && strcmp(argv[i], "--profile-out") == 0) {
+            profileOut = argv[++i];
+            NP::Profiler::enable(true);
+        } else if (i < argc-1 && strcmp(argv[i], "--bench") == 0) {
+            benchTicks = atoi(argv[++i]);
+        } else if (i < argc-1 && strcmp(argv[i], "--bench-broadphase") == 0) {
+            benchProxies = atoi(argv[++i]);
+        } else if (i < argc-1 && strcmp(argv[i], "--bench-solver") == 0) {
+            benchBoxes = atoi(argv[++i]);
+        } else if (i < argc-1 && strcmp(argv[i], "--bench-narrowphase") == 0) {
+            benchBodies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--check-solver") == 0) {
+            checkSolver = true;
+        } else if (strcmp(argv[i], "--check-rewind") == 0) {
+            checkRewind = true;
+        } else if (i < argc-1 && strcmp(argv[i], "--rewind-at") == 0) {
+            rewindAt = atoi(argv[++i]);
+        } else if (i < argc-1 && strcmp(argv[i], "--contact-solver") == 0) {
+            b2ContactSolverType type;
+            if (!parse_contact_solver(argv[++i], type)) {
+                return 1;
+            }
+            Scene::setContactSolver(type);
+        } else if (i < argc-1 && strcmp(argv[i], "--bench-out") == 0) {
+            benchOut = argv[++i];
+        } else if (i < argc-1 && strcmp(argv[i], "--baseline") == 0) {
+            baseline = argv[++i];
+        } else if (i < argc-1 && strcmp(argv[i], "--threshold") == 0) {
+            threshold = atof(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (benchProxies > 0) {
+        return benchmark_broadphase(benchProxies);
+    }
+
+    if (benchBoxes > 0) {
+        return benchmark_solver(benchBoxes);
+    }
+
+    if (benchBodies > 0) {
+        return benchmark_narrowphase(benchBodies);
+    }
+
+    if (paths.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    OS->init(argc, argv);
+    OS->init();
+    OS->window(Vec2(WORLD_WIDTH, WORLD_HEIGHT));
+
+    Levels levels(paths);
+
+    if (checkSolver) {
+        return check_solver(levels, timeout, jobs);
+    }
+
+    if (checkRewind) {
+        return check_rewind(levels, timeout, jobs, rewindAt);
+    }
+
+    if (benchTicks > 0) {
+        int result = benchmark(levels, benchTicks, benchOut, baseline, threshold);
+        if (!profileOut.empty()) {
+            NP::Profiler::write(profileOut);
+        }
+        return result;
+    }
+
+    BatchRunner runner(timeout);
+
+    // Every job simulates its level in its own Scene (and b2World), and
+    // results are reported in level order, no matter which worker ran them
+    std::vector<BatchResult> results;
+    for (int i=0; i<levels.numLevels(); i++) {
+        results.push_back(BatchResult(levels.levelName(i, false)));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        thp::JobPool pool(jobs);
+        for (auto &result: results) {
+            pool.submit([&runner, &result] () {
+                result = runner.run(result.filename);
+            });
+        }
+        pool.wait();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    int failures = 0;
+    long steps = 0;
+    printf("%-8s %8s %8s %10s  %s\n", "result", "tick", "steps", "steps/s", "level");
+    for (auto &result: results) {
+        const char *status = "-";
+        if (!result.loaded) {
+            status = "ERROR";
+        } else if (result.events > 0) {
+            status = result.completed ? "PASS" : "FAIL";
+        } else if (result.completed) {
+            status = "done";
+        }
+
+        printf("%-8s %8d %8d %10.0f  %s\n", status, result.completionTick,
+               result.steps, result.stepsPerSecond(), result.filename.c_str());
+
+        steps += result.steps;
+        if (result.failed()) {
+            failures++;
+        }
+    }
+
+    printf("%d levels, %d failed, %ld steps in %.2fs (%.0f steps/s)\n",
+           levels.numLevels(), failures, steps, elapsed.count(),
+           elapsed.count() > 0.0 ? steps / elapsed.count() : 0.0);
+
+    if (!profileOut.empty()) {
+        NP::Profiler::write(profileOut);
+    }
+
+    return failures ? 1 : 0;
+}
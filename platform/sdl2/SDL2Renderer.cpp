@@ -22,17 +22,17 @@
 #include <SDL_ttf.h>
 
 
-class SDLFontData : public NP::FontData {
+class SDLFontData : public GLFontData {
 public:
-    SDLFontData(const char *filename, int size);
+    SDLFontData(TTF_Font *font, int size);
     ~SDLFontData();
 
     TTF_Font *m_font;
 };
 
-SDLFontData::SDLFontData(const char *filename, int size)
-    : NP::FontData(size)
-    , m_font(TTF_OpenFont(filename, size))
+SDLFontData::SDLFontData(TTF_Font *font, int size)
+    : GLFontData(size, TTF_FontHeight(font))
+    , m_font(font)
 {
 }
 
@@ -47,7 +47,6 @@ SDL2Renderer::SDL2Renderer(Vec2 world_size)
     , m_window(nullptr)
     , m_pixelformat(nullptr)
     , m_gl_context()
-    , m_texture_cache()
 {
     //Vec2 framebuffer_size(900, 480);
     //Vec2 framebuffer_size(480, 800);
@@ -76,48 +75,61 @@ SDL2Renderer::~SDL2Renderer()
 }
 
 NP::Texture
-SDL2Renderer::load(const char *filename, bool cache)
+SDL2Renderer::decode(const char *filename)
 {
-    std::string fn(filename);
-
-    if (cache) {
-        // Cache lookup
-        for (auto &item: m_texture_cache) {
-            if (item.first == fn) {
-                return item.second;
-            }
-        }
-    }
-
     std::string f = Config::findFile(filename);
 
     SDL_Surface *img = IMG_Load(f.c_str());
     SDL_Surface *tmp = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_ABGR8888, 0);
     SDL_FreeSurface(img);
 
-    NP::Texture result = GLRenderer::load((unsigned char *)tmp->pixels, img->w, img->h);
+    NP::Texture result = GLRenderer::load((unsigned char *)tmp->pixels, tmp->w, tmp->h);
     SDL_FreeSurface(tmp);
 
-    if (cache) {
-        // Store loaded image in cache
-        m_texture_cache[fn] = result;
-    }
-
     return result;
 }
 
 NP::Font
 SDL2Renderer::load(const char *filename, int size)
 {
-    return NP::Font(new SDLFontData(filename, size));
+    return NP::Font(new SDLFontData(TTF_OpenFont(filename, size), size));
 }
 
 void
-SDL2Renderer::metrics(const NP::Font &font, const char *text, int *width, int *height)
+SDL2Renderer::glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph)
 {
     SDLFontData *data = static_cast<SDLFontData *>(font.get());
 
-    TTF_SizeUTF8(data->m_font, text, width, height);
+    int minx, maxx, miny, maxy, advance;
+    if (codepoint > 0xffff || TTF_GlyphMetrics(data->m_font, codepoint,
+                &minx, &maxx, &miny, &maxy, &advance) != 0) {
+        // Not in the Basic Multilingual Plane or not in the font
+        return;
+    }
+
+    glyph.advance = advance;
+
+    SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+    SDL_Surface *surface = TTF_RenderGlyph_Blended(data->m_font, codepoint, white);
+    if (!surface) {
+        return;
+    }
+
+    // The surface spans the whole line height, with the glyph at the pen position
+    SDL_Surface *tmp = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0);
+    SDL_FreeSurface(surface);
+
+    glyph.w = tmp->w;
+    glyph.h = tmp->h;
+    glyph.coverage.resize(tmp->w * tmp->h);
+    for (int y=0; y<tmp->h; y++) {
+        Uint8 *row = static_cast<Uint8 *>(tmp->pixels) + y * tmp->pitch;
+        for (int x=0; x<tmp->w; x++) {
+            glyph.coverage[y * tmp->w + x] = row[x * 4 + 3];
+        }
+    }
+
+    SDL_FreeSurface(tmp);
 }
 
 NP::Texture
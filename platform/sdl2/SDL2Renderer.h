@@ -29,20 +29,20 @@ public:
     SDL2Renderer(Vec2 world_size);
     ~SDL2Renderer();
 
-    virtual NP::Texture load(const char *filename, bool cache);
-
     virtual NP::Font load(const char *filename, int size);
 
-    virtual void metrics(const NP::Font &font, const char *text, int *width, int *height);
     virtual NP::Texture text(const NP::Font &font, const char *text, int rgb);
 
     virtual void swap();
 
+protected:
+    virtual NP::Texture decode(const char *filename);
+    virtual void glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph);
+
 private:
     SDL_Window *m_window;
     SDL_PixelFormat *m_pixelformat;
     SDL_GLContext m_gl_context;
-    std::map<std::string, NP::Texture> m_texture_cache;
 };
 
 #endif /* NUMPTYPHYSICS_SDL2RENDERER_H */
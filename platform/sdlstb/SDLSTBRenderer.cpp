@@ -21,29 +21,33 @@
 #include "stb_loader.h"
 
 
-class EmscriptenFontData : public NP::FontData {
+class EmscriptenFontData : public GLFontData {
 public:
-    EmscriptenFontData(const char *filename, int size);
+    EmscriptenFontData(Blob *blob, int size);
     ~EmscriptenFontData();
 
-    std::string filename;
+    // Read once, stb_truetype renders straight from this buffer
+    Blob *blob;
+    StbLoader_Font font;
 };
 
-EmscriptenFontData::EmscriptenFontData(const char *filename, int size)
-    : NP::FontData(size)
-    , filename(filename)
+EmscriptenFontData::EmscriptenFontData(Blob *blob, int size)
+    : GLFontData(size, 0)
+    , blob(blob)
+    , font(blob->data, blob->len, size)
 {
+    height = font.height();
 }
 
 EmscriptenFontData::~EmscriptenFontData()
 {
+    delete blob;
 }
 
 
 SDLSTBRenderer::SDLSTBRenderer(Vec2 world_size, Vec2 framebuffer_size)
     : GLRenderer(world_size)
     , m_surface(nullptr)
-    , m_texture_cache()
 {
     m_surface = SDL_SetVideoMode(framebuffer_size.x, framebuffer_size.y, 0, SDL_OPENGL | SDL_RESIZABLE);
 
@@ -58,51 +62,36 @@ SDLSTBRenderer::~SDLSTBRenderer()
 }
 
 NP::Texture
-SDLSTBRenderer::load(const char *filename, bool cache)
+SDLSTBRenderer::decode(const char *filename)
 {
-    std::string fn(filename);
-
-    if (cache) {
-        // Cache lookup
-        for (auto &item: m_texture_cache) {
-            if (item.first == fn) {
-                return item.second;
-            }
-        }
-    }
-
     Blob *blob = Config::readBlob(filename);
     StbLoader_RGBA *rgba = StbLoader::decode_image(blob->data, blob->len);
     delete blob;
     NP::Texture result = GLRenderer::load((unsigned char *)rgba->data, rgba->w, rgba->h);
     delete rgba;
 
-    if (cache) {
-        // Store loaded image in cache
-        m_texture_cache[fn] = result;
-    }
-
     return result;
 }
 
 NP::Font
 SDLSTBRenderer::load(const char *filename, int size)
 {
-    return NP::Font(new EmscriptenFontData(filename, size));
+    return NP::Font(new EmscriptenFontData(Config::readBlob(filename), size));
 }
 
 void
-SDLSTBRenderer::metrics(const NP::Font &font, const char *text, int *width, int *height)
+SDLSTBRenderer::glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph)
 {
     EmscriptenFontData *data = static_cast<EmscriptenFontData *>(font.get());
 
-    Blob *blob = Config::readBlob(data->filename);
-    StbLoader_RGBA *rgba = StbLoader::render_font(blob->data, blob->len,
-            StbLoader_Color(0.f, 0.f, 0.f, 1.f), data->size, text);
-    *width = rgba->w;
-    *height = rgba->h;
-    delete rgba;
-    delete blob;
+    unsigned char *bitmap = data->font.glyph(codepoint, &glyph.w, &glyph.h,
+            &glyph.x, &glyph.y, &glyph.advance);
+    if (bitmap) {
+        glyph.coverage.assign(bitmap, bitmap + glyph.w * glyph.h);
+        free(bitmap);
+    } else {
+        glyph.w = glyph.h = 0;
+    }
 }
 
 NP::Texture
@@ -118,12 +107,10 @@ SDLSTBRenderer::text(const NP::Font &font, const char *text, int rgb)
     float g = 1.f * (Uint8)((rgb >> 8) & 0xff) / 255.f;
     float b = 1.f * (Uint8)((rgb) & 0xff) / 255.f;
 
-    Blob *blob = Config::readBlob(data->filename);
-    StbLoader_RGBA *rgba = StbLoader::render_font(blob->data, blob->len,
+    StbLoader_RGBA *rgba = StbLoader::render_font(data->blob->data, data->blob->len,
             StbLoader_Color(r, g, b, 1.f), data->size, text);
     NP::Texture result = GLRenderer::load((unsigned char *)rgba->data, rgba->w, rgba->h);
     delete rgba;
-    delete blob;
     return result;
 }
 
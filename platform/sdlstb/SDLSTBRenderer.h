@@ -29,18 +29,18 @@ public:
     SDLSTBRenderer(Vec2 world_size, Vec2 framebuffer_size);
     ~SDLSTBRenderer();
 
-    virtual NP::Texture load(const char *filename, bool cache);
-
     virtual NP::Font load(const char *filename, int size);
 
-    virtual void metrics(const NP::Font &font, const char *text, int *width, int *height);
     virtual NP::Texture text(const NP::Font &font, const char *text, int rgb);
 
     virtual void swap();
 
+protected:
+    virtual NP::Texture decode(const char *filename);
+    virtual void glyph(const NP::Font &font, uint32_t codepoint, GLGlyph &glyph);
+
 private:
     SDL_Surface *m_surface;
-    std::map<std::string, NP::Texture> m_texture_cache;
 };
 
 #endif /* NUMPTYPHYSICS_SDLSTBRENDERER_H */
@@ -24,12 +24,15 @@
 #include "Font.h"
 #include "Dialogs.h"
 #include "Event.h"
+#include "Profiler.h"
+#include "JetStream.h"
 
 #include "thp_timestep.h"
 #include "thp_format.h"
 #include "petals_log.h"
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <unistd.h>
@@ -42,6 +45,8 @@ class App : private Container, public MainLoop
   bool m_quit;
   Window *m_window;
   thp::Timestep m_timestep;
+  std::string m_profileOut;
+  bool m_profileOverlay;
 public:
   App(int argc, char** argv)
     : m_width(WORLD_WIDTH)
@@ -49,6 +54,8 @@ public:
     , m_quit(false)
     , m_window(NULL)
     , m_timestep(ITERATION_RATE)
+    , m_profileOut()
+    , m_profileOverlay(false)
   {
       OS->ensurePath(OS->userDataDir());
       OS->init();
@@ -58,6 +65,11 @@ public:
           if (i < argc-1 && strcmp(argv[i], "--lang") == 0) {
               LOG_DEBUG("Trying to load translation for '%s'", argv[i+1]);
               Tr::load(thp::format("i18n/%s", argv[i+1]));
+          } else if (i < argc-1 && strcmp(argv[i], "--profile-out") == 0) {
+              m_profileOut = argv[i+1];
+              NP::Profiler::enable(true);
+          } else if (i < argc-1 && strcmp(argv[i], "--particle-density") == 0) {
+              JetStream::setParticleDensity(strtof(argv[i+1], nullptr));
           }
       }
 
@@ -72,6 +84,10 @@ public:
 
   ~App()
   {
+    if (!m_profileOut.empty()) {
+        NP::Profiler::write(m_profileOut);
+    }
+
     delete m_window;
   }
 
@@ -85,6 +101,9 @@ private:
       m_window->clip(world);
       m_window->clear();
       draw(*m_window, world);
+      if (m_profileOverlay) {
+          NP::Profiler::drawOverlay(*m_window);
+      }
       m_window->update();
   }
 
@@ -103,6 +122,10 @@ private:
                   case '3':
                       LOG_DEBUG("UI: %s", toString().c_str());
                       return true;
+                  case '4':
+                      m_profileOverlay = !m_profileOverlay;
+                      NP::Profiler::enable(m_profileOverlay || !m_profileOut.empty());
+                      return true;
                   default:
                       break;
               }
@@ -134,6 +157,7 @@ private:
   virtual bool step()
   {
       m_timestep.update(OS->ticks(), [this] () {
+          PROFILE_ZONE("App::tick");
           onTick(OS->ticks());
 
           ToolkitEvent ev;
@@ -144,6 +168,7 @@ private:
       });
 
       render();
+      NP::Profiler::frame();
 
       return !m_quit;
   }
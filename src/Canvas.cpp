@@ -20,6 +20,7 @@
 #include "Canvas.h"
 #include "Path.h"
 #include "Renderer.h"
+#include "Profiler.h"
 
 
 static NP::Renderer *RENDERER() { return OS->renderer(); }
@@ -98,6 +99,24 @@ void Canvas::drawPath( const Path& path, int color, int a )
     RENDERER->path(path, color | ((a & 0xff) << 24));
 }
 
+void Canvas::drawLines( const float *x, const float *y, int count, const b2Vec2& delta, int color, int a )
+{
+    EVAL_LOCAL(RENDERER);
+    RENDERER->lines(x, y, count, delta, color | ((a & 0xff) << 24));
+}
+
+NP::Mesh Canvas::makeMesh( const Path& path )
+{
+    EVAL_LOCAL(RENDERER);
+    return RENDERER->mesh(path);
+}
+
+void Canvas::drawMesh( const NP::Mesh& mesh, const b2Vec2& pos, float angle, int color, int a )
+{
+    EVAL_LOCAL(RENDERER);
+    RENDERER->path(mesh, pos, angle, color | ((a & 0xff) << 24));
+}
+
 void Canvas::drawRect( int x, int y, int w, int h, int c, bool fill, int a )
 {
     drawRect(Rect(x, y, x+w, y+h), c, fill, a);
@@ -109,6 +128,12 @@ void Canvas::drawRect( const Rect& r, int c, bool fill, int a )
     RENDERER->rectangle(r, c | (a << 24), fill);
 }
 
+void Canvas::drawText(const NP::Font &font, const char *text, int x, int y, int c)
+{
+    EVAL_LOCAL(RENDERER);
+    RENDERER->print(font, text, x, y, c);
+}
+
 Rect
 Canvas::clip(const Rect &r)
 {
@@ -139,6 +164,7 @@ Window::~Window()
 
 void Window::update()
 {
+    PROFILE_ZONE("Window::update");
     EVAL_LOCAL(RENDERER);
     RENDERER->flush();
     RENDERER->swap();
@@ -199,6 +225,13 @@ RenderTarget::contents()
     return RENDERER->retrieve(m_framebuffer);
 }
 
+bool
+RenderTarget::read(unsigned char *rgba)
+{
+    EVAL_LOCAL(RENDERER);
+    return RENDERER->read(m_framebuffer, rgba);
+}
+
 
 Image::Image(NP::Texture texture)
     : m_texture(texture)
@@ -214,6 +247,13 @@ Image::Image(std::string filename, bool cache)
 {
 }
 
+Image::Image(const NP::TextureHandle &handle)
+    : m_texture(RENDERER()->load(handle))
+    , m_width(m_texture->w)
+    , m_height(m_texture->h)
+{
+}
+
 Image::Image(NP::Font font, const char *text, int rgb)
     : m_texture(RENDERER()->text(font, text, rgb))
     , m_width(m_texture->w)
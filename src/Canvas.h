@@ -41,8 +41,12 @@ public:
   void drawRewind(Image &image, const Rect &src, const Rect &dst, float time, float alpha);
   void drawSaturation(Image &image, const Rect &src, const Rect &dst, float alpha);
   void drawPath( const Path& path, int color, int a=255 );
+  void drawLines( const float *x, const float *y, int count, const b2Vec2& delta, int color, int a=255 );
+  NP::Mesh makeMesh( const Path& path );
+  void drawMesh( const NP::Mesh& mesh, const b2Vec2& pos, float angle, int color, int a=255 );
   void drawRect( int x, int y, int w, int h, int c, bool fill=true, int a=255 );
   void drawRect( const Rect& r, int c, bool fill=true, int a=255 );
+  void drawText(const NP::Font &font, const char *text, int x, int y, int c);
   Rect clip(const Rect &r);
 protected:
   int m_width;
@@ -59,6 +63,7 @@ public:
     void end();
 
     NP::Texture contents();
+    bool read(unsigned char *rgba);
 
 private:
     NP::Framebuffer m_framebuffer;
@@ -91,6 +96,7 @@ class Image
 public:
     Image(NP::Texture texture);
     Image(std::string filename, bool cache=false);
+    Image(const NP::TextureHandle &handle);
     Image(NP::Font font, const char *text, int rgb);
     ~Image();
 
@@ -29,12 +29,20 @@ constexpr const int WORLD_HEIGHT = 480;
 constexpr const float PIXELS_PER_METREf = 10.f;
 constexpr const float GRAVITY_ACCELf = 9.8f /* m/(s^2) */;
 constexpr const float GRAVITY_FUDGEf = 5.0f;
-constexpr const float CLOSED_SHAPE_THREHOLDf = 0.4f;
+constexpr const float PHYSICS_BOUNDSf = 1000.0f /* metres from the origin, bodies beyond are frozen */;
+constexpr const float CLOSED_SHAPE_THREHOLDf = 0.4f /* metres between the ends */;
 constexpr const float SIMPLIFY_THRESHOLDf = 1.0f /* pixels */;
 constexpr const int MULTI_VERTEX_LIMIT = 64;
+constexpr const int STROKE_POINT_LIMIT = 4 * MULTI_VERTEX_LIMIT /* raw points while drawing */;
+constexpr const float STROKE_HALF_THICKNESSf = 0.1f /* metres */;
+constexpr const float STROKE_MERGE_TOLERANCEf = 3.0f /* pixels, 0 = one shape per segment */;
+constexpr const float JETSTREAM_PARTICLE_SPACINGf = 10.0f /* pixels, at density 1 */;
+constexpr const float JETSTREAM_PARTICLE_DENSITYf = 1.0f /* level of detail, 0 = no particles */;
 
 constexpr const int ITERATION_RATE = 60 /* fps */;
 constexpr const int SOLVER_ITERATIONS = 8;
+constexpr const int PHYSICS_THREADS = 1 /* island solver threads, 1 = serial */;
+constexpr const b2ContactSolverType CONTACT_SOLVER = e_sequentialSolver;
 
 constexpr const int MIN_RENDER_RATE = 10 /* fps */;
 constexpr const int MAX_RENDER_RATE = ITERATION_RATE /* fps */;
@@ -44,10 +52,20 @@ constexpr const int HIDE_STEPS = AVG_RENDER_RATE * 4;
 constexpr const float JOINT_TOLERANCE = 4.0f /* pixels */;
 constexpr const float SELECT_TOLERANCE = 5.0f /* pixels */;
 constexpr const float CLICK_TOLERANCE = 4.0f /* pixels */;
+constexpr const int STROKE_INDEX_CELL_SHIFT = 6 /* 64 pixel grid cells */;
 
 constexpr const float ITERATION_TIMESTEPf = 1.0f / float(ITERATION_RATE);
 
 constexpr const float ICON_SCALE_FACTOR = 6.0f;
+constexpr const int THUMBNAIL_WORKERS = 2;
+
+constexpr const size_t TEXTURE_CACHE_BUDGET = 32 * 1024 * 1024 /* bytes */;
+
+constexpr const int PROFILER_RING_SIZE = 64 * 1024 /* samples per thread */;
+constexpr const int PROFILER_OVERLAY_INTERVAL = 500 /* ms */;
+constexpr const int PROFILER_OVERLAY_LINES = 12;
+
+constexpr const double BENCHMARK_THRESHOLD = 5.0 /* percent */;
 
 constexpr const int BUTTON_WIDTH = 140;
 constexpr const int BUTTON_HEIGHT = 60;
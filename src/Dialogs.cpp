@@ -23,6 +23,7 @@
 #include "Scene.h"
 #include "Colour.h"
 #include "I18n.h"
+#include "Thumbnails.h"
 
 #include "petals_log.h"
 #include "thp_format.h"
@@ -88,19 +89,45 @@ public:
 
 class LevelSelector : public MenuPage
 {
-  static const int THUMB_COUNT = 32;
+  static constexpr int HEADER_HEIGHT = 10 + 64 + 10;
+  static constexpr int THUMB_WIDTH = WORLD_WIDTH / ICON_SCALE_FACTOR;
+  static constexpr int THUMB_HEIGHT = WORLD_HEIGHT / ICON_SCALE_FACTOR + 30;
+  static constexpr int ROW_HEIGHT = THUMB_HEIGHT + 10;
+  static constexpr int COLUMNS = (WORLD_WIDTH + 10) / (THUMB_WIDTH + 10);
+  static constexpr int COLUMN_GAP = (WORLD_WIDTH - COLUMNS * THUMB_WIDTH) / (COLUMNS + 1);
+
   Levels* m_levels;
   int m_collection;
   int m_dispbase;
   int m_dispcount;
-  IconButton* m_thumbs[THUMB_COUNT];
   ScrollArea* m_scroll;
+
+  // Buttons are only created for the visible rows and get recycled
+  // while scrolling; m_slotIndex is the collection index each shows
+  std::vector<IconButton*> m_slots;
+  std::vector<int> m_slotIndex;
+
+  std::vector<NP::Texture> m_textures;
+  std::vector<bool> m_requested;
+  ThumbnailLoader m_loader;
+
+  static ThumbnailCache &thumbnails()
+  {
+    static ThumbnailCache cache(Config::joinPath(OS->userDataDir(), "Thumbnails"));
+    return cache;
+  }
 public:
   LevelSelector(GameControl* game, int initialLevel)
     : m_levels(game->m_levels),
       m_collection(0),
       m_dispbase(0),
-      m_dispcount(0)
+      m_dispcount(0),
+      m_scroll(nullptr),
+      m_slots(),
+      m_slotIndex(),
+      m_textures(),
+      m_requested(),
+      m_loader(thumbnails(), THUMBNAIL_WORKERS)
   {
     m_scroll = new ScrollArea();
     m_scroll->fitToParent(true);
@@ -120,12 +147,18 @@ public:
     m_collection = c;
     m_dispbase = 0;
     m_dispcount = m_levels->collectionSize(c);
-    m_scroll->virtualSize(Vec2(WORLD_WIDTH,150+(WORLD_HEIGHT/ICON_SCALE_FACTOR+40)*((m_dispcount+2)/3)));
+    int rows = (m_dispcount + COLUMNS - 1) / COLUMNS;
+    m_scroll->virtualSize(Vec2(WORLD_WIDTH,HEADER_HEIGHT+ROW_HEIGHT*rows+110));
+
+    m_loader.cancel();
+    m_textures.assign(m_dispcount, nullptr);
+    m_requested.assign(m_dispcount, false);
 
     m_scroll->empty();
-    Box *vbox = new VBox();
-    vbox->add( new Spacer(),  10, 0 );
+    m_slots.clear();
+    m_slotIndex.clear();
     Box *hbox = new HBox();
+    hbox->fitToParent(false);
     Widget *w = new Button(Tr::copy("<<"),Event::PREVIOUS);
     w->border(false);
     hbox->add( w, BUTTON_WIDTH, 0 );
@@ -138,51 +171,77 @@ public:
     w->border(false);    
     hbox->add( new Spacer(), 10, 0 );
     hbox->add( w, BUTTON_WIDTH, 0 );
-    vbox->add( hbox, 64, 0 );
-    vbox->add( new Spacer(),  10, 0 );
-
-    hbox = new HBox();
-    hbox->add( new Spacer(),  0, 1 );
-    int accumw = 0;
-    for (int i=0; i<m_dispcount; i++) {
-      accumw += WORLD_WIDTH / ICON_SCALE_FACTOR + 10;
-      if (accumw >= WORLD_WIDTH) {
-	vbox->add(hbox, WORLD_HEIGHT/ICON_SCALE_FACTOR+30, 4);
-	vbox->add( new Spacer(),  10, 0 );
-	hbox = new HBox();
-	hbox->add( new Spacer(),  0, 1 );
-	accumw = WORLD_WIDTH / ICON_SCALE_FACTOR;
+    m_scroll->add( hbox, Rect(Vec2(0, 10), Vec2(WORLD_WIDTH, 10+64)) );
+  }
+  Vec2 cell(int i)
+  {
+    return Vec2(COLUMN_GAP + (i % COLUMNS) * (THUMB_WIDTH + COLUMN_GAP),
+                HEADER_HEIGHT + (i / COLUMNS) * ROW_HEIGHT);
+  }
+  void show(int slot, int i)
+  {
+    int level = m_levels->collectionLevel(m_collection,i);
+    IconButton *thumb = m_slots[slot];
+    thumb->text( Tr::copy(m_levels->levelName(level)) );
+    thumb->event( Event(Event::PLAY, level) ); //SELECT
+    thumb->image( m_textures[i] ? new Image(m_textures[i]) : nullptr );
+    thumb->moveTo( m_scroll->position().tl - m_scroll->viewport().tl + cell(i) );
+    thumb->show();
+    m_slotIndex[slot] = i;
+
+    if (!m_requested[i]) {
+      m_requested[i] = true;
+      m_loader.request(i, m_levels->levelName(level, false));
+    }
+  }
+  void layoutSlots()
+  {
+    Rect view = m_scroll->viewport();
+    int first = std::max(0, (view.tl.y - HEADER_HEIGHT) / ROW_HEIGHT) * COLUMNS;
+    int last = std::min(m_dispcount, std::max(0, (view.br.y - HEADER_HEIGHT) / ROW_HEIGHT + 1) * COLUMNS);
+
+    for (int s=0; s<m_slots.size(); s++) {
+      if (m_slotIndex[s] != -1 && (m_slotIndex[s] < first || m_slotIndex[s] >= last)) {
+        m_slots[s]->hide();
+        m_slotIndex[s] = -1;
       }
-      m_thumbs[i] = new IconButton(Tr::copy("--"),"",Event(Event::PLAY, //SELECT,
-						 m_levels->collectionLevel(c,i)));
-      m_thumbs[i]->font(Font::blurbFont());
-      m_thumbs[i]->setBg(NP::Colour::SELECTED_BG);
-      m_thumbs[i]->border(false);
-      hbox->add( m_thumbs[i],  WORLD_WIDTH / ICON_SCALE_FACTOR, 0 );
-      hbox->add( new Spacer(), 0, 1 );
     }
-    vbox->add(hbox, WORLD_HEIGHT/ICON_SCALE_FACTOR+30, 4);
-    vbox->add( new Spacer(), 110, 10 );
-    m_scroll->add(vbox,0,0);
-
-    for (int i=0; i<THUMB_COUNT && i+m_dispbase<m_dispcount; i++) {
-      Scene scene( true );
-      int level = m_levels->collectionLevel(c,i);
-      if (scene.load(m_levels->load(level))) {
-          auto size = Vec2(WORLD_WIDTH, WORLD_HEIGHT);
-          RenderTarget temp(size, Rect(Vec2(0, 0), size));
-
-          temp.begin();
-          scene.draw(temp, true);
-          temp.end();
-
-          m_thumbs[i]->text( Tr::copy(m_levels->levelName(level)) );
-          Image *image = new Image(temp.contents());
-          image->scale(1. / ICON_SCALE_FACTOR);
-          m_thumbs[i]->image(image);
+
+    for (int i=first; i<last; i++) {
+      if (std::find(m_slotIndex.begin(), m_slotIndex.end(), i) != m_slotIndex.end()) {
+        continue;
+      }
+
+      auto it = std::find(m_slotIndex.begin(), m_slotIndex.end(), -1);
+      if (it == m_slotIndex.end()) {
+        IconButton *thumb = new IconButton(Tr::copy(""),"",Event::NOP);
+        thumb->font(Font::blurbFont());
+        thumb->setBg(NP::Colour::SELECTED_BG);
+        thumb->border(false);
+        thumb->sizeTo(Vec2(THUMB_WIDTH, THUMB_HEIGHT));
+        m_scroll->add(thumb, 0, 0);
+        m_slots.push_back(thumb);
+        m_slotIndex.push_back(-1);
+        it = m_slotIndex.end() - 1;
       }
+
+      show(it - m_slotIndex.begin(), i);
     }
   }
+  void onTick(int tick)
+  {
+    MenuPage::onTick(tick);
+    layoutSlots();
+
+    m_loader.poll([this] (int i, NP::Texture texture) {
+      m_textures[i] = texture;
+
+      auto it = std::find(m_slotIndex.begin(), m_slotIndex.end(), i);
+      if (texture && it != m_slotIndex.end()) {
+        m_slots[it - m_slotIndex.begin()]->image(new Image(texture));
+      }
+    });
+  }
   bool onEvent(Event& ev)
   {
     switch (ev.code) {
@@ -193,7 +252,7 @@ public:
       setCollection(m_collection+1);
       return true;
 //     case Event::SELECT:
-//       for (int i=0; i<THUMB_COUNT && i+m_dispbase<m_dispcount; i++) {
+//       for (int i=0; i+m_dispbase<m_dispcount; i++) {
 // 	m_thumbs[i]->transparent(true);
 //       }
 //       m_thumbs[m_dispbase+ev.x]->transparent(false);
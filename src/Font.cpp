@@ -38,8 +38,7 @@ Vec2 Font::metrics( const std::string& text ) const
 void Font::drawLeft( Canvas* canvas, Vec2 pt,
 		     const std::string& text, int colour ) const
 {
-    Image temp(m_font, text.c_str(), colour);
-    canvas->drawImage(temp, pt.x, pt.y);
+    canvas->drawText(m_font, text.c_str(), pt.x, pt.y, colour);
 }
 
 void Font::drawRight( Canvas* canvas, Vec2 pt,
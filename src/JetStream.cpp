@@ -1,18 +1,42 @@
 #include "JetStream.h"
+#include "Profiler.h"
 
 #include "thp_format.h"
 #include "petals_log.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static float g_particleDensity = JETSTREAM_PARTICLE_DENSITYf;
+
 JetStream::JetStream(const Rect &rect, const b2Vec2 &force)
     : active(false)
     , origin(rect.tl)
     , rect(rect)
     , force(force)
-    , particles()
+    , xs()
+    , ys()
 {
-    for (int i=0; i<sqrtf(rect.w() * rect.h())/10; i++) {
-        particles.push_back(b2Vec2(rect.tl.x, rect.tl.y) +
-                            b2Vec2(rand() % rect.width(), rand() % rect.height()));
+    spawn();
+}
+
+void
+JetStream::setParticleDensity(float density)
+{
+    g_particleDensity = std::max(0.f, density);
+}
+
+void
+JetStream::spawn()
+{
+    int count = ceilf(g_particleDensity * sqrtf(rect.w() * rect.h()) / JETSTREAM_PARTICLE_SPACINGf);
+
+    xs.resize(count);
+    ys.resize(count);
+    for (int i=0; i<count; i++) {
+        xs[i] = rect.tl.x + rand() % rect.width();
+        ys[i] = rect.tl.y + rand() % rect.height();
     }
 }
 
@@ -20,13 +44,33 @@ void
 JetStream::draw(Canvas &canvas)
 {
     canvas.drawRect(rect, 0x000044, true, 20);
+    canvas.drawLines(xs.data(), ys.data(), xs.size(), force, 0x000000, 128);
+}
+
+// Move by less than one period and wrap into [lo, hi], four at a time
+static void
+advance(float *v, int count, float step, float lo, float hi, float period)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128 vstep = _mm_set1_ps(step);
+    __m128 vlo = _mm_set1_ps(lo);
+    __m128 vhi = _mm_set1_ps(hi);
+    __m128 vperiod = _mm_set1_ps(period);
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_add_ps(_mm_loadu_ps(v + i), vstep);
+        x = _mm_add_ps(x, _mm_and_ps(_mm_cmplt_ps(x, vlo), vperiod));
+        x = _mm_sub_ps(x, _mm_and_ps(_mm_cmpgt_ps(x, vhi), vperiod));
+        _mm_storeu_ps(v + i, x);
+    }
+#endif
 
-    for (auto &particle: particles) {
-        Vec2 pos(particle.x, particle.y);
-        Path p;
-        p.push_back(pos);
-        p.push_back(pos + Vec2(force.x, force.y));
-        canvas.drawPath(p, 0x000000, 128);
+    for (; i<count; i++) {
+        float x = v[i] + step;
+        x += (x < lo) ? period : 0.f;
+        x -= (x > hi) ? period : 0.f;
+        v[i] = x;
     }
 }
 
@@ -37,39 +81,55 @@ JetStream::tick()
         return;
     }
 
-    for (auto &particle: particles) {
-        particle += force;
-        if (!rect.contains(particle)) {
-            while (particle.x < rect.tl.x) {
-                particle.x += rect.width();
-            }
-            while (particle.x > rect.br.x) {
-                particle.x -= rect.width();
-            }
-            while (particle.y < rect.tl.y) {
-                particle.y += rect.height();
-            }
-            while (particle.y > rect.br.y) {
-                particle.y -= rect.height();
-            }
-        }
-    }
+    float w = rect.width();
+    float h = rect.height();
+    advance(xs.data(), xs.size(), fmodf(force.x, w), rect.tl.x, rect.br.x, w);
+    advance(ys.data(), ys.size(), fmodf(force.y, h), rect.tl.y, rect.br.y, h);
 }
 
 void
-JetStream::update(std::vector<Stroke *> &strokes)
+JetStream::apply(b2World &world, const b2TimeStep &step, std::vector<b2Shape *> &shapes)
 {
     if (!active) {
         return;
     }
 
-    for (auto &stroke: strokes) {
-        if (rect.intersects(stroke->screenBbox())) {
-            auto body = stroke->body();
-            if (body) {
-                body->ApplyImpulse(force, body->GetWorldCenter());
-            }
+    b2AABB aabb;
+    aabb.lowerBound = (1.0f/PIXELS_PER_METREf) * b2Vec2(rect.tl.x, rect.tl.y);
+    aabb.upperBound = (1.0f/PIXELS_PER_METREf) * b2Vec2(rect.br.x, rect.br.y);
+
+    // A full buffer might have missed some shapes
+    int count;
+    while ((count = world.Query(aabb, shapes.data(), shapes.size())) == int(shapes.size())) {
+        shapes.resize(2 * shapes.size());
+    }
+
+    for (int i=0; i<count; i++) {
+        b2Shape *shape = shapes[i];
+        b2Body *body = shape->GetBody();
+        if (body->IsStatic() || body->IsFrozen() || body->GetMass() <= 0.0f) {
+            continue;
         }
+
+        // Broadphase boxes are fattened, test the tight box
+        b2AABB box;
+        shape->ComputeAABB(&box, body->GetXForm());
+        b2Vec2 lower = b2Max(box.lowerBound, aabb.lowerBound);
+        b2Vec2 upper = b2Min(box.upperBound, aabb.upperBound);
+        if (lower.x >= upper.x || lower.y >= upper.y) {
+            continue;
+        }
+
+        b2Vec2 size = box.upperBound - box.lowerBound;
+        b2Vec2 overlap = upper - lower;
+
+        b2MassData mass;
+        shape->ComputeMass(&mass);
+
+        // A body that is all inside gets the whole force, as an impulse per tick
+        float32 share = (mass.mass / body->GetMass()) *
+                        (overlap.x * overlap.y) / (size.x * size.y);
+        body->ApplyForce((share * step.inv_dt) * force, 0.5f * (lower + upper));
     }
 }
 
@@ -91,10 +151,22 @@ void
 JetStream::resize(const Vec2 &mouse)
 {
     rect = Rect::order(origin, mouse);
+    spawn();
+}
+
+JetStreamField::JetStreamField(const std::vector<JetStream *> &streams)
+    : b2Controller()
+    , m_streams(streams)
+    , m_shapes(64)
+{
+}
+
+void
+JetStreamField::Step(b2World *world, const b2TimeStep &step)
+{
+    PROFILE_ZONE("JetStreamField::Step");
 
-    particles.clear();
-    for (int i=0; i<sqrtf(rect.w() * rect.h())/10; i++) {
-        particles.push_back(b2Vec2(rect.tl.x, rect.tl.y) +
-                            b2Vec2(rand() % rect.width(), rand() % rect.height()));
+    for (auto &stream: m_streams) {
+        stream->apply(*world, step, m_shapes);
     }
 }
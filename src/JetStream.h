@@ -13,18 +13,44 @@ public:
 
     void draw(Canvas &canvas);
     void tick();
-    void update(std::vector<Stroke *> &strokes);
+    void apply(b2World &world, const b2TimeStep &step, std::vector<b2Shape *> &shapes);
     std::string asString();
 
     void activate();
     void resize(const Vec2 &mouse);
 
+    // Particles per JETSTREAM_PARTICLE_SPACINGf, for streams created or
+    // resized from now on
+    static void setParticleDensity(float density);
+
 private:
+    void spawn();
+
     bool active;
     Vec2 origin;
     Rect rect;
     b2Vec2 force;
-    std::vector<b2Vec2> particles;
+    // Particle positions, one array per axis
+    std::vector<float> xs;
+    std::vector<float> ys;
+};
+
+/**
+ * Applies the force of the active jet streams from inside the world step.
+ * Each stream queries the broadphase for the shapes under its rect and
+ * pushes every shape by its share of the body's mass, scaled by how much
+ * of the shape's bounding box lies in the stream, so the cost is in the
+ * number of overlaps rather than the number of strokes.
+ **/
+class JetStreamField : public b2Controller {
+public:
+    JetStreamField(const std::vector<JetStream *> &streams);
+
+    virtual void Step(b2World *world, const b2TimeStep &step);
+
+private:
+    const std::vector<JetStream *> &m_streams;
+    std::vector<b2Shape *> m_shapes;
 };
 
 #endif /* NUMPTYPHYSICS_JETSTREAM_H */
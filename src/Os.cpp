@@ -199,6 +199,15 @@ bool Os::exists(const std::string& file)
     return stat(file.c_str(),&st) == 0;
 }
 
+long Os::mtime(const std::string& file)
+{
+    struct stat st;
+    if (stat(file.c_str(),&st) != 0) {
+        return -1;
+    }
+    return st.st_mtime;
+}
+
 static Os *
 g_os = nullptr;
 
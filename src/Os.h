@@ -57,6 +57,7 @@ class Os
   virtual void decorateGame( WidgetParent* game ) {}
   bool ensurePath(const std::string& path);
   bool exists(const std::string& file);
+  long mtime(const std::string& file);
   static Os* get();
   static const char pathSep;
 };
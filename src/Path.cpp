@@ -15,6 +15,7 @@
  */
 
 #include <cstring>
+#include <algorithm>
 #include <iostream>
 
 #include "Path.h"
@@ -256,6 +257,31 @@ Path& Path::rotate(const b2Mat22& rot)
   return *this;
 }
 
+Path& Path::setTransformed(const Path& local, const b2Mat22& rot, const Vec2& xlate)
+{
+  float32 j1 = rot.col1.x;
+  float32 k1 = rot.col1.y;
+  float32 j2 = rot.col2.x;
+  float32 k2 = rot.col2.y;
+
+  resize(local.size());
+  for (int i=0;i<size();i++) {
+    const Vec2& p = local[i];
+    (*this)[i] = Vec2( j1 * p.x + j2 * p.y,
+		       k1 * p.x + k2 * p.y ) + xlate;
+  }
+  return *this;
+}
+
+Path& Path::setTransformed(const Path& local, const Vec2& xlate)
+{
+  resize(local.size());
+  for (int i=0;i<size();i++) {
+    (*this)[i] = local[i] + xlate;
+  }
+  return *this;
+}
+
 Path& Path::scale(float32 factor)
 {
   for (int i=0;i<size();i++) {
@@ -265,34 +291,65 @@ Path& Path::scale(float32 factor)
   return *this;
 }
 
-void Path::simplify( float32 threshold )
+void Path::simplify( float32 threshold, int budget )
 {
-  bool keepflags[size()];
-  memset( &keepflags[0], 0, sizeof(keepflags) );
+  if ( empty() ) {
+    return;
+  }
 
-  keepflags[0] = keepflags[size()-1] = true;
-  simplifySub( 0, size()-1, threshold, &keepflags[0] );
+  // Douglas-Peucker, splitting the span with the furthest point first
+  // (so a budget keeps the points that matter most) from a heap instead
+  // of recursing, so long paths can't overflow the stack
+  struct Span {
+    float32 dist;
+    int first, last, furthest;
+  };
+  auto before = [] ( const Span& a, const Span& b ) {
+    return a.dist < b.dist || ( a.dist == b.dist && a.first > b.first );
+  };
+
+  std::vector<Span> heap;
+  auto split = [&] ( int first, int last ) {
+    float32 furthestDist = threshold;
+    int furthestIndex = 0;
+    Segment s( at(first), at(last) );
+    for ( int i=first+1; i<last; i++ ) {
+      float32 d = s.distanceTo( at(i) );
+      if ( d > furthestDist ) {
+	furthestDist = d;
+	furthestIndex = i;
+      }
+    }
+    if ( furthestIndex != 0 ) {
+      heap.push_back( Span{ furthestDist, first, last, furthestIndex } );
+      std::push_heap( heap.begin(), heap.end(), before );
+    }
+  };
+
+  std::vector<bool> keepflags( size(), false );
+  keepflags.front() = keepflags.back() = true;
+  int kept = size() > 1 ? 2 : 1;
+
+  split( 0, size()-1 );
+  while ( !heap.empty() && ( budget <= 0 || kept < budget ) ) {
+    std::pop_heap( heap.begin(), heap.end(), before );
+    Span span = heap.back();
+    heap.pop_back();
+
+    keepflags[span.furthest] = true;
+    kept++;
+    split( span.first, span.furthest );
+    split( span.furthest, span.last );
+  }
 
+  // also drops duplicate points (shouldn't be any)
   int k=0;
   for ( int i=0; i<size(); i++ ) {
-    if ( keepflags[i] ) {
+    if ( keepflags[i] && ( k == 0 || at(i) != at(k-1) ) ) {
       at(k++) = at(i);
     }
   }
   resize(k);
-
-  // remove duplicate points (shouldn't be any)
-  std::vector<Vec2> result;
-  Vec2 old = at(0);
-  result.push_back(old);
-  for (int i=1; i<size(); i++) {
-      Vec2 cur = at(i);
-      if (old != cur) {
-          result.push_back(cur);
-      }
-      old = cur;
-  }
-  std::swap(*this, result);
 }
 
 void
@@ -340,27 +397,6 @@ Path::segmentize(float length)
     std::swap(*this, result);
 }
 
-void Path::simplifySub( int first, int last, float32 threshold, bool* keepflags )
-{
-  float32 furthestDist = threshold;
-  int furthestIndex = 0;
-  if ( last - first > 1 ) {
-    Segment s( at(first), at(last) );
-    for ( int i=first+1; i<last; i++ ) {
-      float32 d = s.distanceTo( at(i) );
-      if ( d > furthestDist ) {
-	furthestDist = d;
-	furthestIndex = i;
-      }
-    }
-    if ( furthestIndex != 0 ) {
-      keepflags[furthestIndex] = true;
-      simplifySub( first, furthestIndex, threshold, keepflags );
-      simplifySub( furthestIndex, last, threshold, keepflags );
-    }
-  }
-}
-
 Rect Path::bbox() const
 {
     if (size() == 0) {
@@ -49,6 +49,11 @@ public:
   Path& rotate(const b2Mat22& rot);
   Path& scale(float32 factor);
 
+  // Replace the points with the rotated and translated points of local,
+  // reusing the storage (same rounding as rotate() then translate())
+  Path& setTransformed(const Path& local, const b2Mat22& rot, const Vec2& xlate);
+  Path& setTransformed(const Path& local, const Vec2& xlate);
+
   inline Vec2& origin() { return at(0); }
 
   inline Path& operator&(const Vec2& other) 
@@ -100,14 +105,13 @@ public:
   inline Vec2& last() { return at(size()-1); }
   inline Vec2& endpt(unsigned char end) { return end?last():first(); }
 
-  void simplify( float32 threshold );
+  // Drops points within threshold of the simplified path; a budget
+  // caps the number of points, whatever the threshold
+  void simplify( float32 threshold, int budget=0 );
   void segmentize(float length);
   Rect bbox() const;
 
   void withSegments(std::function<void(const Vec2 &a, const Vec2 &b)> fn);
-
- private:
-  void simplifySub( int first, int last, float32 threshold, bool* keepflags );  
 };
 
 #endif //PATH_H
@@ -0,0 +1,255 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "Profiler.h"
+#include "Config.h"
+#include "Canvas.h"
+#include "Font.h"
+
+#include "thp_format.h"
+#include "petals_log.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+
+namespace NP {
+
+struct ProfileRing {
+    ProfileRing(int tid)
+        : tid(tid)
+        , mutex()
+        , samples(PROFILER_RING_SIZE)
+        , written(0)
+    {
+    }
+
+    template <typename F>
+    void each(F callback)
+    {
+        size_t count = std::min(written, samples.size());
+        for (size_t i=written-count; i<written; i++) {
+            callback(samples[i % samples.size()]);
+        }
+    }
+
+    int tid;
+
+    // Only contended while the ring is being read for the overlay or export
+    std::mutex mutex;
+    std::vector<ProfileSample> samples;
+    size_t written;
+};
+
+struct ProfileState {
+    ProfileState()
+        : mutex()
+        , rings()
+        , start(std::chrono::steady_clock::now())
+        , frames(0)
+        , window_start(0)
+        , frame_ms(0.0)
+        , zones()
+    {
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+    std::chrono::steady_clock::time_point start;
+
+    // Overlay averages over the last PROFILER_OVERLAY_INTERVAL
+    int frames;
+    int64_t window_start;
+    double frame_ms;
+    std::vector<std::pair<std::string, double>> zones;
+};
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+static thread_local ProfileRing *
+g_ring = nullptr;
+
+static ProfileState &
+state()
+{
+    static ProfileState s;
+    return s;
+}
+
+void
+Profiler::enable(bool enabled)
+{
+    // Make sure the time base exists before the first zone opens
+    state();
+    s_enabled.store(enabled);
+}
+
+int64_t
+Profiler::now()
+{
+    auto elapsed = std::chrono::steady_clock::now() - state().start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void
+Profiler::record(const char *name, int64_t begin, int64_t end)
+{
+    ProfileRing *ring = g_ring;
+
+    if (!ring) {
+        ProfileState &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.rings.emplace_back(new ProfileRing(s.rings.size() + 1));
+        ring = g_ring = s.rings.back().get();
+    }
+
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    ProfileSample &sample = ring->samples[ring->written++ % ring->samples.size()];
+    sample.name = name;
+    sample.begin = begin;
+    sample.end = end;
+}
+
+void
+Profiler::frame()
+{
+    if (!enabled()) {
+        return;
+    }
+
+    ProfileState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.frames++;
+}
+
+static void
+refresh(ProfileState &s, int64_t now)
+{
+    std::map<std::string, int64_t> totals;
+    for (auto &ring: s.rings) {
+        std::lock_guard<std::mutex> lock(ring->mutex);
+        ring->each([&] (const ProfileSample &sample) {
+            if (sample.begin >= s.window_start) {
+                totals[sample.name] += sample.end - sample.begin;
+            }
+        });
+    }
+
+    int frames = std::max(1, s.frames);
+
+    s.zones.clear();
+    for (auto &kv: totals) {
+        s.zones.emplace_back(kv.first, kv.second / 1000.0 / frames);
+    }
+
+    std::sort(s.zones.begin(), s.zones.end(), [] (const std::pair<std::string, double> &a,
+                                                  const std::pair<std::string, double> &b) {
+        return a.second > b.second;
+    });
+
+    if (s.zones.size() > size_t(PROFILER_OVERLAY_LINES)) {
+        s.zones.resize(PROFILER_OVERLAY_LINES);
+    }
+
+    s.frame_ms = (now - s.window_start) / 1000.0 / frames;
+    s.frames = 0;
+    s.window_start = now;
+}
+
+void
+Profiler::drawOverlay(Canvas &canvas)
+{
+    if (!enabled()) {
+        return;
+    }
+
+    ProfileState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    int64_t t = now();
+    if (t - s.window_start >= PROFILER_OVERLAY_INTERVAL * 1000) {
+        refresh(s, t);
+    }
+
+    const ::Font *font = ::Font::blurbFont();
+    const int line = font->height();
+    const int width = 320;
+    const int bar = 120;
+    const double budget = 1000.0 / ITERATION_RATE;
+
+    int x = 8;
+    int y = 8;
+    canvas.drawRect(Rect(x, y, x + width, y + line * (s.zones.size() + 1) + 8), 0x000000, true, 160);
+
+    x += 4;
+    y += 4;
+    font->drawLeft(&canvas, Vec2(x, y), thp::format("frame %.2f ms (%.0f fps)", s.frame_ms,
+                   s.frame_ms > 0.0 ? 1000.0 / s.frame_ms : 0.0), 0xffffff);
+
+    for (auto &zone: s.zones) {
+        y += line;
+
+        // Bars are scaled to the time budget of one tick
+        int w = std::min(bar, int(bar * zone.second / budget));
+        canvas.drawRect(x, y + 2, w, line - 4, zone.second > budget ? 0xc04040 : 0x4080c0, true, 200);
+        font->drawLeft(&canvas, Vec2(x + bar + 8, y), thp::format("%6.2f %s", zone.second,
+                       zone.first.c_str()), 0xffffff);
+    }
+}
+
+bool
+Profiler::write(const std::string &filename)
+{
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (!fp) {
+        LOG_WARNING("Cannot write profile to %s", filename.c_str());
+        return false;
+    }
+
+    ProfileState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    size_t count = 0;
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (auto &ring: s.rings) {
+        std::lock_guard<std::mutex> ring_lock(ring->mutex);
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"thread %d\"}}", count ? ",\n" : "", ring->tid, ring->tid);
+        count++;
+
+        ring->each([&] (const ProfileSample &sample) {
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"np\",\"ph\":\"X\",\"ts\":%lld,"
+                    "\"dur\":%lld,\"pid\":1,\"tid\":%d}", sample.name, (long long)sample.begin,
+                    (long long)(sample.end - sample.begin), ring->tid);
+            count++;
+        });
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = (ferror(fp) == 0);
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+
+    LOG_INFO("Wrote %d trace events to %s", int(count), filename.c_str());
+    return ok;
+}
+
+}; /* namespace NP */
@@ -0,0 +1,92 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_PROFILER_H
+#define NUMPTYPHYSICS_PROFILER_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+class Canvas;
+
+namespace NP {
+
+struct ProfileSample {
+    // Zone names must be string literals (only the pointer is stored)
+    const char *name;
+
+    // Microseconds since the profiler was first used
+    int64_t begin;
+    int64_t end;
+};
+
+/**
+ * Scoped-timer instrumentation. Every thread records finished zones
+ * into its own ring buffer (the oldest samples are overwritten), so
+ * recording never blocks on other threads. While disabled, a zone
+ * costs a single relaxed atomic load.
+ **/
+class Profiler {
+public:
+    static void enable(bool enabled);
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static int64_t now();
+    static void record(const char *name, int64_t begin, int64_t end);
+
+    // Marks the end of a rendered frame (for per-frame overlay averages)
+    static void frame();
+
+    // Per-zone milliseconds per frame, refreshed every PROFILER_OVERLAY_INTERVAL
+    static void drawOverlay(Canvas &canvas);
+
+    // Dumps all buffered samples as Chrome trace-event JSON (chrome://tracing)
+    static bool write(const std::string &filename);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+class ProfileZone {
+public:
+    ProfileZone(const char *name)
+        : m_name(name)
+        , m_begin(Profiler::enabled() ? Profiler::now() : -1)
+    {
+    }
+
+    ~ProfileZone()
+    {
+        if (m_begin >= 0) {
+            Profiler::record(m_name, m_begin, Profiler::now());
+        }
+    }
+
+private:
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+    const char *m_name;
+    int64_t m_begin;
+};
+
+}; /* namespace NP */
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) NP::ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+#endif /* NUMPTYPHYSICS_PROFILER_H */
@@ -0,0 +1,142 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "Renderer.h"
+#include "Config.h"
+
+#include "petals_log.h"
+
+namespace NP {
+
+TextureCache::TextureCache(size_t budget)
+    : m_entries()
+    , m_mutex()
+    , m_budget(budget)
+    , m_clock(0)
+    , m_stats()
+{
+}
+
+Texture
+TextureCache::lookup(const TextureHandle &handle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(handle.hash);
+    if (it == m_entries.end() || it->second.filename != handle.filename) {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    m_stats.hits++;
+    it->second.used = ++m_clock;
+    return it->second.texture;
+}
+
+void
+TextureCache::insert(const TextureHandle &handle, Texture texture)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry &entry = m_entries[handle.hash];
+    if (entry.texture) {
+        // Hash collision, the newer image wins
+        m_stats.bytes -= entry.bytes;
+        m_stats.textures--;
+    }
+
+    entry.filename = handle.filename;
+    entry.texture = texture;
+    entry.bytes = size_t(texture->w) * size_t(texture->h) * 4;
+    entry.used = ++m_clock;
+
+    m_stats.bytes += entry.bytes;
+    m_stats.textures++;
+
+    trim();
+}
+
+void
+TextureCache::trim()
+{
+    while (m_stats.bytes > m_budget) {
+        auto victim = m_entries.end();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            // Textures still referenced outside the cache can't be freed
+            if (it->second.texture.use_count() == 1 &&
+                    (victim == m_entries.end() || it->second.used < victim->second.used)) {
+                victim = it;
+            }
+        }
+
+        if (victim == m_entries.end()) {
+            break;
+        }
+
+        LOG_DEBUG("Evicting texture %s (%d KiB)", victim->second.filename.c_str(),
+                  int(victim->second.bytes / 1024));
+        m_stats.bytes -= victim->second.bytes;
+        m_stats.textures--;
+        m_stats.evictions++;
+        m_entries.erase(victim);
+    }
+}
+
+TextureCache::Stats
+TextureCache::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_stats;
+}
+
+
+Renderer::Renderer()
+    : m_textures(TEXTURE_CACHE_BUDGET)
+{
+}
+
+Texture
+Renderer::load(const char *filename, bool cache)
+{
+    if (!cache) {
+        return decode(filename);
+    }
+
+    return load(TextureHandle(filename));
+}
+
+Texture
+Renderer::load(const TextureHandle &handle)
+{
+    Texture result = m_textures.lookup(handle);
+
+    if (!result) {
+        result = decode(handle.filename);
+        m_textures.insert(handle, result);
+    }
+
+    return result;
+}
+
+void
+Renderer::print(const Font &font, const char *text, int x, int y, int rgb)
+{
+    // Fallback for renderers without a glyph cache: rasterize the whole string
+    Texture texture = this->text(font, text, rgb);
+    image(texture, x, y, texture->w, texture->h);
+}
+
+}; /* namespace NP */
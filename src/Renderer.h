@@ -17,6 +17,10 @@
 #define NUMPTYPHYSICS_RENDERER_H
 
 #include <memory>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
 
 #include "Common.h"
 #include "Path.h"
@@ -34,6 +38,67 @@ public:
 
 typedef std::shared_ptr<TextureData> Texture;
 
+/**
+ * Name of a cacheable image, hashed once (at compile time for literals)
+ * so that per-frame lookups don't have to compare strings.
+ **/
+class TextureHandle {
+public:
+    explicit constexpr TextureHandle(const char *filename)
+        : filename(filename)
+        , hash(fnv1a(filename))
+    {
+    }
+
+    const char *filename;
+    uint32_t hash;
+
+private:
+    static constexpr uint32_t fnv1a(const char *s, uint32_t h=2166136261u)
+    {
+        return *s ? fnv1a(s + 1, (h ^ uint8_t(*s)) * 16777619u) : h;
+    }
+};
+
+/**
+ * Decoded images by name hash. Textures are refcounted by their users;
+ * once the resident size exceeds the budget, the least recently used
+ * textures that are only referenced by the cache get evicted.
+ **/
+class TextureCache {
+public:
+    struct Stats {
+        int hits;
+        int misses;
+        int evictions;
+        int textures;
+        size_t bytes;
+    };
+
+    TextureCache(size_t budget);
+
+    Texture lookup(const TextureHandle &handle);
+    void insert(const TextureHandle &handle, Texture texture);
+
+    Stats stats();
+
+private:
+    struct Entry {
+        std::string filename;
+        Texture texture;
+        size_t bytes;
+        unsigned long used;
+    };
+
+    void trim();
+
+    std::unordered_map<uint32_t, Entry> m_entries;
+    std::mutex m_mutex;
+    size_t m_budget;
+    unsigned long m_clock;
+    Stats m_stats;
+};
+
 class FontData {
 public:
     FontData(int size) : size(size) {}
@@ -55,8 +120,18 @@ public:
 
 typedef std::shared_ptr<FramebufferData> Framebuffer;
 
+// A path tessellated once, drawn with a different transform each frame
+class MeshData {
+public:
+    MeshData() {}
+    virtual ~MeshData() {}
+};
+
+typedef std::shared_ptr<MeshData> Mesh;
+
 class Renderer {
 public:
+    Renderer();
     virtual ~Renderer() {}
 
     virtual Vec2 framebuffer_size() = 0;
@@ -65,12 +140,18 @@ public:
     Rect framebuffer_rect() { return Rect(Vec2(0, 0), framebuffer_size()); }
     Rect world_rect() { return Rect(Vec2(0, 0), world_size()); }
 
-    virtual Texture load(const char *filename, bool cache) = 0;
+    Texture load(const char *filename, bool cache);
+    Texture load(const TextureHandle &handle);
+    TextureCache &textures() { return m_textures; }
+
+    virtual Texture load(unsigned char *pixels, int w, int h) = 0;
 
     virtual Framebuffer framebuffer(Vec2 size) = 0;
     virtual void begin(Framebuffer &rendertarget, Rect world_rect) = 0;
     virtual void end(Framebuffer &rendertarget) = 0;
     virtual Texture retrieve(Framebuffer &rendertarget) = 0;
+    // Copy out the contents as w*h RGBA pixels, top row first
+    virtual bool read(Framebuffer &rendertarget, unsigned char *rgba) = 0;
 
     virtual Rect clip(Rect rect) = 0;
 
@@ -81,15 +162,28 @@ public:
     virtual void saturation(const Texture &texture, const Rect &src, const Rect &dst, float a) = 0;
     virtual void rectangle(const Rect &rect, int rgba, bool fill) = 0;
     virtual void path(const Path &path, int rgba) = 0;
+    // Parallel lines from (x[i], y[i]) to (x[i], y[i]) + delta, in one batch
+    virtual void lines(const float *x, const float *y, int count, const b2Vec2 &delta, int rgba) = 0;
+
+    virtual Mesh mesh(const Path &path) = 0;
+    virtual void path(const Mesh &mesh, const b2Vec2 &pos, float angle, int rgba) = 0;
 
     virtual Font load(const char *filename, int size) = 0;
 
     virtual void metrics(const Font &font, const char *text, int *width, int *height) = 0;
     virtual Texture text(const Font &font, const char *text, int rgb) = 0;
+    virtual void print(const Font &font, const char *text, int x, int y, int rgb);
 
     virtual void clear() = 0;
     virtual void flush() = 0;
     virtual void swap() = 0;
+
+protected:
+    // Read and decode an image file into a texture (uncached)
+    virtual Texture decode(const char *filename) = 0;
+
+private:
+    TextureCache m_textures;
 };
 
 };
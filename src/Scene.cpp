@@ -19,18 +19,23 @@
 #include "Accelerometer.h"
 #include "Colour.h"
 #include "Stroke.h"
+#include "Profiler.h"
 
 #include "tinyxml2.h"
 #include "thp_format.h"
 #include "thp_iterutils.h"
+#include "thp_jobpool.h"
 #include "petals_log.h"
 
 #include <vector>
 #include <list>
 #include <algorithm>
 #include <cstdlib>
+#include <cmath>
 
 
+static constexpr NP::TextureHandle PAPER_TEXTURE("paper.png");
+
 static constexpr const char *JOINT_IND_PATH =
     "282,39 280,38 282,38 285,39 300,39 301,60 303,66 302,64 "
     "301,63 300,48 297,41 296,42 294,43 293,45 291,46 289,48 "
@@ -52,12 +57,113 @@ struct JointInd {
     Path path;
 };
 
-static JointInd jointInd;
+static const JointInd &
+jointInd()
+{
+    // Initialized on first use (thread-safe), shared read-only afterwards
+    static const JointInd ind;
+    return ind;
+}
+
+
+static int g_physicsThreads = PHYSICS_THREADS;
+static b2ContactSolverType g_contactSolver = CONTACT_SOLVER;
+
+// Runs the island solve tasks of a b2World on a pool, and one on the
+// stepping thread itself, which would otherwise sit idle
+class SolverPool : public b2TaskExecutor {
+public:
+    SolverPool(int threads)
+        : m_threads(threads)
+        , m_pool(threads - 1)
+    {
+    }
+
+    int threads() { return m_threads; }
+
+    virtual void Run(b2Task *task, int32 count)
+    {
+        for (int i=1; i<count; i++) {
+            m_pool.submit([task, i] () { task->Execute(i); });
+        }
+        task->Execute(0);
+        m_pool.wait();
+    }
+
+private:
+    int m_threads;
+    thp::JobPool m_pool;
+};
+
+// Only contacts between a token and a goal reach the listener, all other
+// contacts skip it without a single call. Reached goals are collected
+// and hidden by the scene after the step.
+class GoalDetector : public b2ContactFilter, public b2ContactListener {
+public:
+    std::vector<Stroke *> reached;
+
+    virtual bool ShouldReport(b2Shape *shape1, b2Shape *shape2)
+    {
+        return goal(shape1, shape2) != NULL;
+    }
+
+    virtual void Add(const b2ContactPoint *point)
+    {
+        b2Shape *goal = this->goal(point->shape1, point->shape2);
+        if (!goal) {
+            return;
+        }
 
+        Stroke *stroke = (Stroke *)goal->GetBody()->GetUserData();
+        if (!stroke->hasAttribute(ATTRIB_DELETED)) {
+            stroke->setAttribute(ATTRIB_DELETED);
+            reached.push_back(stroke);
+        }
+    }
+
+private:
+    // The goal shape if a token touches a goal, the categories may also
+    // have the ground bit
+    static b2Shape *goal(b2Shape *shape1, b2Shape *shape2)
+    {
+        if (shape2->GetFilterData().categoryBits & CATEGORY_TOKEN) {
+            b2Swap(shape1, shape2);
+        }
+        if ((shape1->GetFilterData().categoryBits & CATEGORY_TOKEN) &&
+                (shape2->GetFilterData().categoryBits & CATEGORY_GOAL)) {
+            return shape2;
+        }
+        return NULL;
+    }
+};
+
+// Marks the strokes the solver moved in a step, they are binned again
+// when the index is queried next. Sleeping strokes cost nothing.
+class MoveTracker : public b2MoveListener {
+public:
+    MoveTracker(StrokeIndex &index)
+        : m_index(index)
+    {
+    }
+
+    virtual void Moved(b2Body *body)
+    {
+        Stroke *stroke = (Stroke *)body->GetUserData();
+        if (stroke) {
+            m_index.moved(stroke);
+        }
+    }
+
+private:
+    StrokeIndex &m_index;
+};
 
 Scene::Scene( bool noWorld )
   : m_world( NULL ),
-    m_protect( 0 ),
+    m_solverPool( NULL ),
+    m_goalDetector( new GoalDetector() ),
+    m_paper( NULL ),
+    m_moveTracker( new MoveTracker(m_index) ),
     m_gravity(0.0f, 0.0f),
     m_dynamicGravity(false),
     m_accelerometer(Os::get()->getAccelerometer()),
@@ -65,9 +171,10 @@ Scene::Scene( bool noWorld )
   , m_ticks(0)
   , m_color_rects()
   , m_interactions()
-  , m_createStroke(nullptr)
+  , m_jetStreamField(m_jetStreams)
+  , m_createStroke()
   , m_createJetStream(nullptr)
-  , m_moveStroke(nullptr)
+  , m_moveStroke()
   , m_moveOffset()
   , m_paused(false)
 {
@@ -83,6 +190,22 @@ Scene::~Scene()
   if ( m_world ) {
     delete m_world;
   }
+  delete m_solverPool;
+  delete m_goalDetector;
+  delete m_moveTracker;
+  delete m_paper;
+}
+
+void
+Scene::setPhysicsThreads(int threads)
+{
+    g_physicsThreads = std::max(1, threads);
+}
+
+void
+Scene::setContactSolver(b2ContactSolverType solver)
+{
+    g_contactSolver = solver;
 }
 
 bool
@@ -103,7 +226,7 @@ Scene::onSceneEvent(const SceneEvent &ev)
             return interact(ev.pos);
 
         case SceneEvent::BEGIN_CREATE_STROKE_AT:
-            if (!m_createStroke) {
+            if (!m_strokes.get(m_createStroke)) {
                 int colour = ev.userdata1;
                 int attrib = ev.userdata2;
                 m_createStroke = newStroke(Path() & ev.pos, colour, attrib);
@@ -111,53 +234,53 @@ Scene::onSceneEvent(const SceneEvent &ev)
             }
             break;
         case SceneEvent::EXTEND_CREATE_STROKE_AT:
-            if (m_createStroke) {
+            if (m_strokes.get(m_createStroke)) {
                 extendStroke(m_createStroke, ev.pos);
                 return true;
             }
             break;
         case SceneEvent::ACTIVATE_CREATE_STROKE:
-            if (m_createStroke) {
+            if (m_strokes.get(m_createStroke)) {
                 if (activateStroke(m_createStroke)) {
-                    m_createStroke = nullptr;
+                    m_createStroke = StrokeHandle();
                     return true;
                 } else {
                     deleteStroke(m_createStroke);
-                    m_createStroke = nullptr;
+                    m_createStroke = StrokeHandle();
                     return false;
                 }
             }
             break;
 
         case SceneEvent::ROPEIFY_CREATE_STROKE:
-            if (m_createStroke) {
-                for (auto &stroke: m_createStroke->ropeify(*this)) {
+            if (Stroke *s = m_strokes.get(m_createStroke)) {
+                for (auto &stroke: s->ropeify(*this)) {
                     activateStroke(stroke);
                 }
                 deleteStroke(m_createStroke);
-                m_createStroke = nullptr;
+                m_createStroke = StrokeHandle();
                 return true;
             }
             break;
 
         case SceneEvent::BEGIN_MOVE_STROKE_AT:
-            if (!m_moveStroke) {
+            if (!m_strokes.get(m_moveStroke)) {
                 m_moveStroke = strokeAtPoint(ev.pos, SELECT_TOLERANCE);
-                if (m_moveStroke) {
-                    m_moveOffset = ev.pos - m_moveStroke->origin();
+                if (Stroke *s = m_strokes.get(m_moveStroke)) {
+                    m_moveOffset = ev.pos - s->origin();
                 }
                 return true;
             }
             break;
         case SceneEvent::CONTINUE_MOVE_STROKE_AT:
-            if (m_moveStroke) {
+            if (m_strokes.get(m_moveStroke)) {
                 moveStroke(m_moveStroke, ev.pos - m_moveOffset);
                 return true;
             }
             break;
         case SceneEvent::FINISH_MOVE_STROKE:
-            if (m_moveStroke) {
-                m_moveStroke = nullptr;
+            if (m_strokes.get(m_moveStroke)) {
+                m_moveStroke = StrokeHandle();
                 return true;
             }
             break;
@@ -167,11 +290,11 @@ Scene::onSceneEvent(const SceneEvent &ev)
             break;
         case SceneEvent::DELETE_LAST_STROKE:
             // FIXME: Make sure undo also works correctly for ropes (delete whole rope at once)
-            if (m_createStroke) {
+            if (m_strokes.get(m_createStroke)) {
                 deleteStroke(m_createStroke);
-                m_createStroke = nullptr;
+                m_createStroke = StrokeHandle();
                 return false;
-            } else if (!m_strokes.size()) {
+            } else if (m_strokes.empty()) {
                 return false;
             }
             return deleteStroke(m_strokes.back());
@@ -220,18 +343,34 @@ Scene::onSceneEvent(const SceneEvent &ev)
 void Scene::resetWorld()
 {
   const b2Vec2 gravity(0.0f, GRAVITY_ACCELf*PIXELS_PER_METREf/GRAVITY_FUDGEf);
+  if ( m_world ) {
+    m_world->RemoveController( &m_jetStreamField );
+  }
   delete m_world;
 
-  b2AABB worldAABB;
-  worldAABB.lowerBound.Set(-1000.0f, -1000.0f);
-  worldAABB.upperBound.Set(1000.0f, 1000.0f);
-    
   bool doSleep = true;
-  m_world = new b2World(worldAABB, gravity, doSleep);
-  m_world->SetContactListener( this );
+  m_world = new b2World(gravity, doSleep);
+
+  b2AABB bounds;
+  bounds.lowerBound.Set(-PHYSICS_BOUNDSf, -PHYSICS_BOUNDSf);
+  bounds.upperBound.Set(PHYSICS_BOUNDSf, PHYSICS_BOUNDSf);
+  m_world->SetWorldAABB( bounds );
+
+  m_world->SetContactFilter( m_goalDetector );
+  m_world->SetContactListener( m_goalDetector );
+  m_world->SetMoveListener( m_moveTracker );
+  m_world->AddController( &m_jetStreamField );
+  m_world->SetContactSolver(g_contactSolver);
+
+  if (g_physicsThreads > 1) {
+    if (!m_solverPool) {
+      m_solverPool = new SolverPool(g_physicsThreads);
+    }
+    m_world->SetTaskExecutor(m_solverPool, m_solverPool->threads());
+  }
 }
 
-Stroke* Scene::newStroke( const Path& p, int colour, int attribs ) {
+StrokeHandle Scene::newStroke( const Path& p, int colour, int attribs ) {
   Stroke *s = new Stroke(p);
   s->setAttribute( (Attribute)attribs );
 
@@ -240,53 +379,89 @@ Stroke* Scene::newStroke( const Path& p, int colour, int attribs ) {
   case 1: s->setAttribute( ATTRIB_GOAL ); break;
   default: s->setColour( NP::Colour::values[colour] ); break;
   }
-  m_strokes.push_back( s );
-  return s;
+  return addStroke( s );
+}
+
+StrokeHandle Scene::addStroke( Stroke *s )
+{
+  StrokeHandle h = m_strokes.insert( s );
+  m_index.add( s );
+
+  if ( s->hasAttribute( ATTRIB_GOAL ) ) {
+    m_goals.push_back( s );
+  }
+  if ( s->hasAttribute( ATTRIB_TOKEN ) ) {
+    m_tokens.push_back( s );
+  }
+  if ( s->hasAttribute( ATTRIB_INTERACTIVE ) ) {
+    m_interactive.push_back( s );
+    m_interactiveBboxes.clear();
+  }
+  return h;
 }
 
-bool Scene::deleteStroke( Stroke *s ) {
-  if ( s ) {
-    int i = indexOf(m_strokes, s);
-    if ( i >= m_protect ) {
-	s->reset(m_world);
-	m_strokes.erase(std::find(m_strokes.begin(), m_strokes.end(), s));
-	m_deletedStrokes.push_back(s);
-	return true;
+void Scene::removeStroke( StrokeHandle h )
+{
+  Stroke *s = m_strokes.get( h );
+  m_strokes.erase( h );
+  m_index.remove( s );
+
+  for (auto list: {&m_goals, &m_tokens, &m_interactive}) {
+    auto it = std::find(list->begin(), list->end(), s);
+    if (it != list->end()) {
+      list->erase(it);
     }
   }
+  m_interactiveBboxes.clear();
+}
+
+bool Scene::deleteStroke( StrokeHandle h ) {
+  Stroke *s = m_strokes.get( h );
+  if ( s && !m_strokes.isProtected( h ) ) {
+    s->reset(m_world);
+    removeStroke( h );
+    m_deletedStrokes.push_back(s);
+    return true;
+  }
   return false;
 }
 
 
-void Scene::extendStroke( Stroke* s, const Vec2& pt )
+void Scene::extendStroke( StrokeHandle h, const Vec2& pt )
 {
-  if ( s ) {
-    int i = indexOf(m_strokes, s);
-    if ( i >= m_protect ) {
-      s->addPoint( pt );
-    }
+  Stroke *s = m_strokes.get( h );
+  if ( s && !m_strokes.isProtected( h ) ) {
+    s->addPoint( pt );
+    m_index.moved( s );
   }
 }
 
-void Scene::moveStroke( Stroke* s, const Vec2& origin )
+void Scene::moveStroke( StrokeHandle h, const Vec2& origin )
 {
-  if ( s ) {
-    int i = indexOf(m_strokes, s);
-    if ( i >= m_protect ) {
-      s->origin( origin );
-    }
+  Stroke *s = m_strokes.get( h );
+  if ( s && !m_strokes.isProtected( h ) ) {
+    s->origin( origin );
+    m_index.moved( s );
   }
 }
 
-bool Scene::activateStroke( Stroke *s )
+bool Scene::activateStroke( StrokeHandle h )
 {
-  return activate(s);
+  // Only strokes drawn during the game are filled, the level is
+  // complete by then (see Stroke::createBodies)
+  Stroke *s = m_strokes.get( h );
+  return s && activate(s, true);
 }
 
 std::list<Vec2> Scene::getJointCandidates(Stroke *s)
 {
+    // Both ends of a joint lie within the tolerance of both strokes
+    Rect area = s->worldBbox();
+    int r = int(std::ceil(JOINT_TOLERANCE));
+    m_index.query(Rect(area.tl - Vec2(r, r), area.br + Vec2(r, r)), m_candidates);
+
     std::vector<Joint> joints;
-    for (auto &stroke: m_strokes) {
+    for (auto &stroke: m_candidates) {
         if (s == stroke) {
             continue;
         }
@@ -301,10 +476,11 @@ std::list<Vec2> Scene::getJointCandidates(Stroke *s)
     return result;
 }
 
-bool Scene::activate( Stroke *s )
+bool Scene::activate( Stroke *s, bool fill )
 {
   if ( s->numPoints() > 1 ) {
-    s->createBodies( *m_world );
+    s->createBodies( *m_world, fill );
+    m_index.moved( s );
     createJoints( s );
     return true;
   }
@@ -313,11 +489,12 @@ bool Scene::activate( Stroke *s )
 
 void Scene::activateAll()
 {
-  for ( int i=0; i < m_strokes.size(); i++ ) {
-    m_strokes[i]->createBodies( *m_world );
+  for (auto &s: m_strokes) {
+    s->createBodies( *m_world );
+    m_index.moved( s );
   }
-  for ( int i=0; i < m_strokes.size(); i++ ) {
-    createJoints( m_strokes[i] );
+  for (auto &s: m_strokes) {
+    createJoints( s );
   }
 }
 
@@ -326,11 +503,15 @@ void Scene::createJoints( Stroke *s )
   if ( s->body()==NULL ) {
     return;
   }
+  Rect area = s->worldBbox();
+  int r = int(std::ceil(JOINT_TOLERANCE));
+  m_index.query(Rect(area.tl - Vec2(r, r), area.br + Vec2(r, r)), m_candidates);
+
   std::vector<Joint> joints;
-  for ( int j=m_strokes.size()-1; j>=0; j-- ) {      
-    if ( s != m_strokes[j] && m_strokes[j]->body() ) {
-      s->determineJoints( m_strokes[j], joints );
-      m_strokes[j]->determineJoints( s, joints );
+  for ( int j=m_candidates.size()-1; j>=0; j-- ) {
+    if ( s != m_candidates[j] && m_candidates[j]->body() ) {
+      s->determineJoints( m_candidates[j], joints );
+      m_candidates[j]->determineJoints( s, joints );
       for ( int i=0; i<joints.size(); i++ ) {
 	joints[i].joiner->join( m_world, joints[i].joinee, joints[i].end );
       }
@@ -347,6 +528,8 @@ Scene::introCompleted()
 
 void Scene::step()
 {
+    PROFILE_ZONE("Scene::step");
+
     m_step++;
 
     if (!introCompleted()) {
@@ -360,7 +543,6 @@ void Scene::step()
     if (introCompleted() && !m_paused) {
         for (auto &stream: m_jetStreams) {
             stream->tick();
-            stream->update(m_strokes);
         }
 
         if (m_accelerometer && m_dynamicGravity) {
@@ -376,53 +558,51 @@ void Scene::step()
             }
         }
 
-        m_world->Step(ITERATION_TIMESTEPf, SOLVER_ITERATIONS);
-
-        // clean up delete strokes
-        for (auto &stroke: m_strokes) {
-            if (stroke->hasAttribute(ATTRIB_DELETED)) {
-                stroke->clearAttribute(ATTRIB_DELETED);
-                stroke->hide();
-            }
+        {
+            PROFILE_ZONE("b2World::Step");
+            m_world->Step(ITERATION_TIMESTEPf, SOLVER_ITERATIONS);
         }
 
-        // check for token respawn
-        for (auto &stroke: m_strokes) {
-            // TODO: also respawn goal if it's not shrinking yet
-            if (stroke->hasAttribute(ATTRIB_TOKEN) && !BOUNDS_RECT.intersects(stroke->worldBbox())) {
-                stroke->reset(m_world);
-                activate(stroke);
-            }
+        // hide the goals that were reached
+        for (auto &stroke: m_goalDetector->reached) {
+            stroke->clearAttribute(ATTRIB_DELETED);
+            stroke->hide();
         }
+        m_goalDetector->reached.clear();
+
+        respawnTokens();
     }
 
     // Update bounding boxes for interactive elements
-    m_color_rects = calcColorRects();
+    updateColorRects();
 }
 
-// b2ContactListener callback when a new contact is detected
-void Scene::Add(const b2ContactPoint* point) 
-{     
-  // check for completion
-  //if (c->GetManifoldCount() > 0) {
-  Stroke* s1 = (Stroke*)point->shape1->GetBody()->GetUserData();
-  Stroke* s2 = (Stroke*)point->shape2->GetBody()->GetUserData();
-  if ( s1 && s2 ) {
-    if ( s2->hasAttribute(ATTRIB_TOKEN) ) {
-	b2Swap( s1, s2 );
-    }
-    if ( s1->hasAttribute(ATTRIB_TOKEN) 
-	   && s2->hasAttribute(ATTRIB_GOAL) ) {
-	s2->setAttribute(ATTRIB_DELETED);
+void Scene::respawnTokens()
+{
+    for (auto &stroke: m_tokens) {
+        // TODO: also respawn goal if it's not shrinking yet
+        b2Body *body = stroke->body();
+        if (body) {
+            // Well inside the bounds, going by the body alone
+            b2Vec2 c = PIXELS_PER_METREf * body->GetPosition();
+            float32 r = stroke->radius() + 1.0f;
+            if (c.x - r > BOUNDS_RECT.tl.x && c.x + r < BOUNDS_RECT.br.x &&
+                    c.y - r > BOUNDS_RECT.tl.y && c.y + r < BOUNDS_RECT.br.y) {
+                continue;
+            }
+        }
+
+        if (!BOUNDS_RECT.intersects(stroke->worldBbox())) {
+            stroke->reset(m_world);
+            activate(stroke);
+        }
     }
-  }
 }
 
 bool Scene::isCompleted()
 {
-  for ( int i=0; i < m_strokes.size(); i++ ) {
-    if ( m_strokes[i]->hasAttribute( ATTRIB_GOAL )
-	   && !m_strokes[i]->hidden() ) {
+  for (auto &s: m_goals) {
+    if ( !s->hidden() ) {
 	return false;
     }
   }
@@ -431,8 +611,13 @@ bool Scene::isCompleted()
 
 void Scene::draw(Canvas &canvas, bool everything)
 {
-    Image paper("paper.png", true);
-    canvas.drawImage(paper);
+    PROFILE_ZONE("Scene::draw");
+
+    // Resolved once, not looked up in the texture cache every frame
+    if (!m_paper) {
+        m_paper = new Image(PAPER_TEXTURE);
+    }
+    canvas.drawImage(*m_paper);
 
     int i = 0;
     const int fade_duration = 50;
@@ -454,11 +639,11 @@ void Scene::draw(Canvas &canvas, bool everything)
         canvas.drawRect(kv.second, kv.first, true, 128);
     }
 
-    if (m_createStroke) {
+    if (Stroke *s = m_strokes.get(m_createStroke)) {
         b2Mat22 rot(0.01 * OS->ticks());
 
-        for (auto &candidate: getJointCandidates(m_createStroke)) {
-            Path joint = jointInd.path;
+        for (auto &candidate: getJointCandidates(s)) {
+            Path joint = jointInd().path;
             joint.translate(-joint.bbox().centroid());
             joint.rotate(rot);
             joint.translate(candidate + joint.bbox().centroid());
@@ -496,42 +681,51 @@ bool Scene::interact(const Vec2 &pos)
     return false;
 }
 
-std::map<int,Rect> Scene::calcColorRects()
+void Scene::updateColorRects()
 {
-    std::map<int,Rect> result;
+    PROFILE_ZONE("Scene::updateColorRects");
 
-    std::map<int,std::list<Stroke *>> strokesMap;
-    for (auto &stroke: m_strokes) {
-        if (!stroke->hasAttribute(ATTRIB_INTERACTIVE)) {
-            continue;
-        }
-
-        strokesMap[NP::Colour::toIndex(stroke->colour())].push_back(stroke);
+    if (m_interactive.empty()) {
+        m_color_rects.clear();
+        return;
     }
 
-    for (auto &kv: strokesMap) {
-        int color = kv.first;
-        auto &strokes = kv.second;
-        Rect r = strokes.front()->worldBbox();
-
-        for (auto &s: strokes) {
-            r.expand(s->worldBbox());
+    // Interactive strokes rarely move, only rebuild if one of them has
+    bool changed = m_interactiveBboxes.size() != m_interactive.size();
+    m_interactiveBboxes.resize(m_interactive.size());
+    for (int i=0; i<m_interactive.size(); i++) {
+        Rect r = m_interactive[i]->worldBbox();
+        if (r.tl != m_interactiveBboxes[i].tl || r.br != m_interactiveBboxes[i].br) {
+            m_interactiveBboxes[i] = r;
+            changed = true;
         }
+    }
 
-        result[color] = r;
+    if (!changed) {
+        return;
     }
 
-    return result;
+    m_color_rects.clear();
+    for (int i=0; i<m_interactive.size(); i++) {
+        int color = NP::Colour::toIndex(m_interactive[i]->colour());
+        auto it = m_color_rects.find(color);
+        if (it == m_color_rects.end()) {
+            m_color_rects[color] = m_interactiveBboxes[i];
+        } else {
+            it->second.expand(m_interactiveBboxes[i]);
+        }
+    }
 }
 
-Stroke* Scene::strokeAtPoint( const Vec2 pt, float32 max )
+StrokeHandle Scene::strokeAtPoint( const Vec2 pt, float32 max )
 {
-  Stroke* best = NULL;
-  for ( int i=0; i<m_strokes.size(); i++ ) {
-    float32 d = m_strokes[i]->distanceTo( pt );
+  StrokeHandle best;
+  m_index.query( pt, max, m_candidates );
+  for ( int i=0; i<m_candidates.size(); i++ ) {
+    float32 d = m_candidates[i]->distanceTo( pt );
     if ( d < max ) {
 	max = d;
-	best = m_strokes[i];
+	best = m_candidates[i]->handle();
     }
   }
   return best;
@@ -543,8 +737,16 @@ void Scene::clear()
       s->reset(m_world);
   }
 
-  clearWithDelete(m_strokes);
+  m_index.clear();
+  m_candidates.clear();
+  m_strokes.clear(true);
   clearWithDelete(m_deletedStrokes);
+  m_goals.clear();
+  m_tokens.clear();
+  m_interactive.clear();
+  m_interactiveBboxes.clear();
+  m_color_rects.clear();
+  m_goalDetector->reached.clear();
   if ( m_world ) {
     //step is required to actually destroy bodies and joints
     m_world->Step( ITERATION_TIMESTEPf, SOLVER_ITERATIONS );
@@ -556,11 +758,12 @@ void Scene::clear()
 bool Scene::replay()
 {
     // Remove all unprotected strokes
-    while (m_strokes.size() > m_protect) {
-        auto s = m_strokes.back();
+    while (!m_strokes.empty() && !m_strokes.isProtected(m_strokes.back())) {
+        StrokeHandle h = m_strokes.back();
+        Stroke *s = m_strokes.get(h);
         s->reset(m_world);
+        removeStroke(h);
         delete s;
-        m_strokes.pop_back();
     }
 
     // TODO: Remove all unprotected jet streams
@@ -701,7 +904,7 @@ public:
             }
 
             if (flags && rgb.size() > 0 && data) {
-                scene->m_strokes.push_back(new Stroke(flags->Value(),
+                scene->addStroke(new Stroke(flags->Value(),
                                                       rgb,
                                                       data->Value()));
             } else {
@@ -752,7 +955,7 @@ bool Scene::load(const std::string &level)
                     m_author = value;
                     break;
                 case 'S':
-                    m_strokes.push_back(new Stroke(line));
+                    addStroke(new Stroke(line));
                     break;
                 case 'I':
                     m_interactions.parse(value);
@@ -798,7 +1001,14 @@ bool Scene::start()
 
 void Scene::protect( int n )
 {
-  m_protect = (n==-1 ? m_strokes.size() : n );
+  if ( n == -1 ) {
+    n = m_strokes.size();
+  }
+
+  int i = 0;
+  for (auto it = m_strokes.begin(); it != m_strokes.end(); ++it) {
+    m_strokes.setProtected(it.handle(), i++ < n);
+  }
 }
 
 bool Scene::save( const std::string& file, bool saveLog )
@@ -815,8 +1025,11 @@ bool Scene::save( const std::string& file, bool saveLog )
     }
 
     o << m_interactions.serialize();
-    for ( int i=0; i<m_strokes.size() && (!saveLog || i<m_protect); i++ ) {
-	o << m_strokes[i]->asString() << std::endl;
+    for (auto it = m_strokes.begin(); it != m_strokes.end(); ++it) {
+        if (saveLog && !m_strokes.isProtected(it.handle())) {
+            break;
+        }
+	o << (*it)->asString() << std::endl;
     }
 
     if (saveLog) {
@@ -883,12 +1096,12 @@ Scene::playbackUntil(ScriptLog &log, int ticks)
     // cut the events somewhere in the middle (later on, we might
     // have sync barriers for scene events and avoid it this way)
 
-    if (m_createStroke) {
+    if (m_strokes.get(m_createStroke)) {
         // Incomplete stroke due to replay - remove it
         onSceneEvent(SceneEvent(SceneEvent::DELETE_LAST_STROKE));
     }
 
-    if (m_moveStroke) {
+    if (m_strokes.get(m_moveStroke)) {
         // In-progress move due to replay - finish it
         onSceneEvent(SceneEvent(SceneEvent::FINISH_MOVE_STROKE));
     }
@@ -24,6 +24,8 @@
 #include "Interactions.h"
 #include "JetStream.h"
 #include "SceneEvent.h"
+#include "StrokeIndex.h"
+#include "StrokeMap.h"
 
 #include <string>
 #include <fstream>
@@ -35,9 +37,12 @@
 class Stroke;
 class b2World;
 class Accelerometer;
+class SolverPool;
+class GoalDetector;
+class MoveTracker;
 
 
-class Scene : private b2ContactListener
+class Scene
 {
 public:
 
@@ -46,11 +51,11 @@ public:
 
   bool onSceneEvent(const SceneEvent &ev);
 
-  Stroke* newStroke( const Path& p, int colour, int attributes );
-  bool deleteStroke( Stroke *s );
-  void extendStroke( Stroke* s, const Vec2& pt );
-  void moveStroke( Stroke* s, const Vec2& origin );
-  bool activateStroke( Stroke *s );
+  StrokeHandle newStroke( const Path& p, int colour, int attributes );
+  bool deleteStroke( StrokeHandle h );
+  void extendStroke( StrokeHandle h, const Vec2& pt );
+  void moveStroke( StrokeHandle h, const Vec2& origin );
+  bool activateStroke( StrokeHandle h );
   std::list<Vec2> getJointCandidates(Stroke *s);
 
   JetStream *newJetStream(const Vec2 &pos);
@@ -59,7 +64,7 @@ public:
     return m_strokes.size();
   }
 
-  std::vector<Stroke*>& strokes() {
+  StrokeMap& strokes() {
     return m_strokes;
   }
 
@@ -70,7 +75,7 @@ public:
   bool introCompleted();
   bool isCompleted();
   void draw(Canvas &canvas, bool everything=false);
-  Stroke* strokeAtPoint( const Vec2 pt, float32 max );
+  StrokeHandle strokeAtPoint( const Vec2 pt, float32 max );
   void clear();
   bool replay();
 
@@ -83,29 +88,46 @@ public:
   bool save( const std::string& file, bool saveLog=false );
 
   ScriptLog* getLog() { return &m_log; }
+  b2World* getWorld() { return m_world; }
   int getTicks() { return m_ticks; }
 
   void playbackUntil(ScriptLog &log, int ticks);
+
+  // Threads used to solve the islands of worlds created from now on.
+  // The simulation is the same for any number of threads.
+  static void setPhysicsThreads(int threads);
+
+  // Contact solver of worlds created from now on
+  static void setContactSolver(b2ContactSolverType solver);
 private:
   bool addJetStream(const char *x, const char *y, const char *width, const char *height, const char *force);
   void resetWorld();
-  bool activate( Stroke *s );
+  bool activate( Stroke *s, bool fill=false );
   void activateAll();
   void createJoints( Stroke *s );
-  std::map<int,Rect> calcColorRects();
-
-  // b2ContactListener callback when a new contact is detected
-  virtual void Add(const b2ContactPoint* point) ;
-
+  StrokeHandle addStroke( Stroke *s );
+  void removeStroke( StrokeHandle h );
+  void respawnTokens();
+  void updateColorRects();
 
   b2World        *m_world;
-  std::vector<Stroke*>  m_strokes;
+  SolverPool     *m_solverPool;
+  GoalDetector   *m_goalDetector;
+  Image          *m_paper;
+  StrokeMap             m_strokes;
   std::vector<Stroke*>  m_deletedStrokes;
+  StrokeIndex           m_index;
+  std::vector<Stroke*>  m_candidates;
+  MoveTracker          *m_moveTracker;
+  // Strokes with per-tick duties, in scene order
+  std::vector<Stroke*>  m_goals;
+  std::vector<Stroke*>  m_tokens;
+  std::vector<Stroke*>  m_interactive;
+  std::vector<Rect>     m_interactiveBboxes;
   std::string     m_title, m_author, m_bg;
   ScriptLog       m_log;
   ScriptRecorder  m_recorder;
   ScriptPlayer    m_player;
-  int             m_protect;
   b2Vec2          m_gravity;
   b2Vec2          m_currentGravity;
   bool            m_dynamicGravity;
@@ -115,11 +137,12 @@ private:
   std::map<int,Rect> m_color_rects;
   NP::Interactions    m_interactions;
   std::vector<JetStream *> m_jetStreams;
+  JetStreamField    m_jetStreamField;
 
   // Create and move stuff
-  Stroke  	   *m_createStroke;
+  StrokeHandle      m_createStroke;
   JetStream        *m_createJetStream;
-  Stroke           *m_moveStroke;
+  StrokeHandle      m_moveStroke;
   Vec2              m_moveOffset;
   bool              m_paused;
 
@@ -101,6 +101,13 @@ ScriptHandler::stop()
     m_index = 0;
 }
 
+void
+ScriptHandler::seek(int ticks, int index)
+{
+    m_ticks = ticks;
+    m_index = index;
+}
+
 void
 ScriptHandler::tick(Scene *scene)
 {
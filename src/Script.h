@@ -49,8 +49,10 @@ public:
     virtual void start(ScriptLog *log);
     virtual void stop();
     virtual void tick(Scene *scene);
+    void seek(int ticks, int index);
 
     bool running() { return m_running; }
+    int ticks() { return m_ticks; }
     int index() { return m_index; }
 
 protected:
@@ -0,0 +1,465 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "ShapeBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+ShapeBuilder::ShapeBuilder(float32 halfThickness, float32 tolerance)
+    : m_halfThickness(halfThickness)
+    , m_tolerance(tolerance)
+{
+}
+
+void
+ShapeBuilder::bar(const b2Vec2 &p1, const b2Vec2 &p2, b2Vec2 *corners) const
+{
+    // Same vertices (and order) as b2PolygonDef::SetAsBox() would produce
+    b2Vec2 bar = p2 - p1;
+    float32 hx = bar.Length() / 2.0f;
+    float32 hy = m_halfThickness;
+
+    b2XForm xf;
+    xf.position = 0.5f * bar + p1;
+    xf.R.Set(b2Atan2(bar.y, bar.x));
+
+    corners[0] = b2Mul(xf, b2Vec2(-hx, -hy));
+    corners[1] = b2Mul(xf, b2Vec2(hx, -hy));
+    corners[2] = b2Mul(xf, b2Vec2(hx, hy));
+    corners[3] = b2Mul(xf, b2Vec2(-hx, hy));
+}
+
+static bool
+lexicographic(const b2Vec2 &a, const b2Vec2 &b)
+{
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+static std::vector<b2Vec2>
+convex_hull(std::vector<b2Vec2> points)
+{
+    // Andrew's monotone chain, counter-clockwise, without collinear points
+    std::sort(points.begin(), points.end(), lexicographic);
+
+    std::vector<b2Vec2> hull(2 * points.size());
+    int k = 0;
+    for (size_t i=0; i<points.size(); i++) {
+        while (k >= 2 && b2Cross(hull[k-1] - hull[k-2], points[i] - hull[k-2]) <= 0.0f) {
+            k--;
+        }
+        hull[k++] = points[i];
+    }
+    for (int i=int(points.size())-2, lower=k+1; i>=0; i--) {
+        while (k >= lower && b2Cross(hull[k-1] - hull[k-2], points[i] - hull[k-2]) <= 0.0f) {
+            k--;
+        }
+        hull[k++] = points[i];
+    }
+
+    hull.resize(std::max(0, k - 1));
+    return hull;
+}
+
+static bool
+flat_vertex(const b2Vec2 &prev, const b2Vec2 &v, const b2Vec2 &next)
+{
+    // b2PolygonShape wants edges of some length and corners that turn by
+    // more than b2_angularSlop
+    static const float32 minTurn = sinf(2.0f * b2_angularSlop);
+
+    b2Vec2 e1 = v - prev;
+    b2Vec2 e2 = next - v;
+    float32 l1 = e1.Length();
+    float32 l2 = e2.Length();
+
+    return l1 < b2_linearSlop || l2 < b2_linearSlop || b2Cross(e1, e2) < minTurn * l1 * l2;
+}
+
+static bool
+reduce_hull(std::vector<b2Vec2> &hull, float32 maxCut)
+{
+    // Dropping a vertex of a convex polygon keeps it convex, and only cuts
+    // off the triangle spanned by the vertex and its two neighbours
+    while (hull.size() > 3) {
+        size_t best = 0;
+        float32 bestCut = B2_FLT_MAX;
+        bool flat = false;
+
+        for (size_t i=0; i<hull.size(); i++) {
+            const b2Vec2 &prev = hull[(i + hull.size() - 1) % hull.size()];
+            const b2Vec2 &next = hull[(i + 1) % hull.size()];
+
+            if (flat_vertex(prev, hull[i], next)) {
+                best = i;
+                flat = true;
+                break;
+            }
+
+            b2Vec2 base = next - prev;
+            float32 cut = b2Cross(base, hull[i] - prev) / base.Length();
+            if (cut < bestCut) {
+                best = i;
+                bestCut = cut;
+            }
+        }
+
+        if (!flat) {
+            if (hull.size() <= size_t(b2_maxPolygonVertices)) {
+                return true;
+            }
+
+            if (bestCut > maxCut) {
+                return false;
+            }
+        }
+
+        hull.erase(hull.begin() + best);
+    }
+
+    return hull.size() == 3;
+}
+
+static bool
+valid_polygon(const std::vector<b2Vec2> &hull)
+{
+    if (hull.size() < 3 || hull.size() > size_t(b2_maxPolygonVertices)) {
+        return false;
+    }
+
+    b2Vec2 centroid(0.0f, 0.0f);
+    float32 area = 0.0f;
+    for (size_t i=0; i<hull.size(); i++) {
+        const b2Vec2 &p1 = hull[i];
+        const b2Vec2 &p2 = hull[(i + 1) % hull.size()];
+        float32 a = 0.5f * b2Cross(p1 - hull[0], p2 - hull[0]);
+        area += a;
+        centroid += (a / 3.0f) * (hull[0] + p1 + p2);
+    }
+
+    if (area <= B2_FLT_EPSILON) {
+        return false;
+    }
+    centroid *= 1.0f / area;
+
+    // The core polygon is shifted inward by b2_toiSlop, it must not
+    // pass the centroid (b2PolygonShape asserts on that)
+    for (size_t i=0; i<hull.size(); i++) {
+        b2Vec2 edge = hull[(i + 1) % hull.size()] - hull[i];
+        b2Vec2 normal = b2Cross(edge, 1.0f);
+        normal.Normalize();
+        if (b2Dot(normal, hull[i] - centroid) <= 2.0f * b2_toiSlop) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+ShapeBuilder::merge(const std::vector<b2Vec2> &points, int first, int last, ShapePolygon &polygon) const
+{
+    b2Vec2 chord = points[last] - points[first];
+    float32 length = chord.Length();
+    if (length < b2_linearSlop) {
+        return false;
+    }
+
+    // Filling in the inside of a bend adds at most this much material
+    for (int i=first+1; i<last; i++) {
+        if (b2Abs(b2Cross(chord, points[i] - points[first])) > m_tolerance * length) {
+            return false;
+        }
+    }
+
+    std::vector<b2Vec2> corners(4 * (last - first));
+    for (int i=first; i<last; i++) {
+        bar(points[i], points[i+1], &corners[4 * (i - first)]);
+    }
+
+    // Corners on the outside of a bend may be cut back a little, as long
+    // as the path itself stays inside the polygon
+    std::vector<b2Vec2> hull = convex_hull(corners);
+    if (!reduce_hull(hull, b2Min(m_tolerance, m_halfThickness)) || !valid_polygon(hull)) {
+        return false;
+    }
+
+    polygon.count = hull.size();
+    std::copy(hull.begin(), hull.end(), polygon.vertices);
+    return true;
+}
+
+void
+ShapeBuilder::build(const std::vector<b2Vec2> &points, std::vector<ShapePolygon> &polygons) const
+{
+    int n = points.size();
+
+    int first = 0;
+    while (first < n - 1) {
+        ShapePolygon polygon;
+        polygon.count = 4;
+        bar(points[first], points[first+1], polygon.vertices);
+
+        // Grow the run one segment at a time, until the hull breaks a limit
+        int last = first + 1;
+        if (m_tolerance > 0.0f) {
+            for (int next=first+2; next<n; next++) {
+                ShapePolygon merged;
+                if (!merge(points, first, next, merged)) {
+                    break;
+                }
+                polygon = merged;
+                last = next;
+            }
+        }
+
+        polygons.push_back(polygon);
+        first = last;
+    }
+}
+
+static float32
+polygon_area(const std::vector<b2Vec2> &polygon)
+{
+    float32 area = 0.0f;
+    for (size_t i=0; i<polygon.size(); i++) {
+        area += 0.5f * b2Cross(polygon[i], polygon[(i + 1) % polygon.size()]);
+    }
+    return area;
+}
+
+static bool
+segments_cross(const b2Vec2 &a1, const b2Vec2 &a2, const b2Vec2 &b1, const b2Vec2 &b2)
+{
+    float32 d1 = b2Cross(a2 - a1, b1 - a1);
+    float32 d2 = b2Cross(a2 - a1, b2 - a1);
+    float32 d3 = b2Cross(b2 - b1, a1 - b1);
+    float32 d4 = b2Cross(b2 - b1, a2 - b1);
+    return d1 * d2 <= 0.0f && d3 * d4 <= 0.0f;
+}
+
+static bool
+in_triangle(const b2Vec2 &p, const b2Vec2 &a, const b2Vec2 &b, const b2Vec2 &c)
+{
+    return b2Cross(b - a, p - a) >= 0.0f && b2Cross(c - b, p - b) >= 0.0f &&
+           b2Cross(a - c, p - c) >= 0.0f;
+}
+
+static bool
+ear_clip(const std::vector<b2Vec2> &loop, std::vector<std::vector<int>> &pieces)
+{
+    std::vector<int> ring;
+    for (size_t i=0; i<loop.size(); i++) {
+        ring.push_back(i);
+    }
+
+    while (ring.size() > 3) {
+        bool clipped = false;
+        for (size_t i=0; i<ring.size() && !clipped; i++) {
+            int a = ring[(i + ring.size() - 1) % ring.size()];
+            int b = ring[i];
+            int c = ring[(i + 1) % ring.size()];
+
+            // Reflex (or straight) corners are no ears
+            if (b2Cross(loop[b] - loop[a], loop[c] - loop[b]) <= 0.0f) {
+                continue;
+            }
+
+            bool empty = true;
+            for (int j: ring) {
+                if (j != a && j != b && j != c && in_triangle(loop[j], loop[a], loop[b], loop[c])) {
+                    empty = false;
+                    break;
+                }
+            }
+
+            if (empty) {
+                pieces.push_back({a, b, c});
+                ring.erase(ring.begin() + i);
+                clipped = true;
+            }
+        }
+
+        if (!clipped) {
+            return false;
+        }
+    }
+
+    pieces.push_back(ring);
+    return true;
+}
+
+static bool
+convex_union(const std::vector<b2Vec2> &loop, const std::vector<int> &a,
+             const std::vector<int> &b, std::vector<int> &result)
+{
+    // Find the diagonal u->v of a that b has as v->u
+    for (size_t i=0; i<a.size(); i++) {
+        int u = a[i];
+        int v = a[(i + 1) % a.size()];
+
+        for (size_t j=0; j<b.size(); j++) {
+            if (b[j] != v || b[(j + 1) % b.size()] != u) {
+                continue;
+            }
+
+            // Walk a from v around to u, then b from u around to v
+            result.clear();
+            for (size_t k=0; k<a.size(); k++) {
+                result.push_back(a[(i + 1 + k) % a.size()]);
+            }
+            for (size_t k=2; k<b.size(); k++) {
+                result.push_back(b[(j + k) % b.size()]);
+            }
+
+            // Straight corners at u and v don't count against the vertex limit
+            for (size_t k=0; k<result.size() && result.size() > 3; ) {
+                const b2Vec2 &p0 = loop[result[(k + result.size() - 1) % result.size()]];
+                const b2Vec2 &p1 = loop[result[k]];
+                const b2Vec2 &p2 = loop[result[(k + 1) % result.size()]];
+                float32 cross = b2Cross(p1 - p0, p2 - p1);
+
+                if (cross < 0.0f && cross > -B2_FLT_EPSILON * (p1 - p0).Length() * (p2 - p1).Length()) {
+                    result.erase(result.begin() + k);
+                } else if (cross < 0.0f) {
+                    return false;
+                } else {
+                    k++;
+                }
+            }
+
+            return result.size() <= size_t(b2_maxPolygonVertices);
+        }
+    }
+
+    return false;
+}
+
+bool
+ShapeBuilder::fill(const std::vector<b2Vec2> &points, std::vector<ShapePolygon> &polygons) const
+{
+    // The ends of a hand-drawn loop usually overshoot each other a bit,
+    // cut both tails off where they cross
+    std::vector<b2Vec2> path(points);
+    int n = path.size();
+    int tail = n / 4;
+    for (int i=0; i<=tail; i++) {
+        for (int j=n-2; j>=n-2-tail && j>i+1; j--) {
+            const b2Vec2 &a1 = path[i];
+            const b2Vec2 &a2 = path[i+1];
+            const b2Vec2 &b1 = path[j];
+            const b2Vec2 &b2 = path[j+1];
+            float32 denominator = b2Cross(a2 - a1, b2 - b1);
+            if (denominator == 0.0f || !segments_cross(a1, a2, b1, b2)) {
+                continue;
+            }
+
+            b2Vec2 crossing = a1 + (b2Cross(b1 - a1, b2 - b1) / denominator) * (a2 - a1);
+            std::vector<b2Vec2> trimmed(1, crossing);
+            trimmed.insert(trimmed.end(), path.begin() + i + 1, path.begin() + j + 1);
+            path.swap(trimmed);
+            i = tail;
+            break;
+        }
+    }
+
+    // Drop repeated points, including the end meeting the start
+    std::vector<b2Vec2> loop;
+    for (auto &p: path) {
+        if (loop.empty() || (p - loop.back()).Length() >= b2_linearSlop) {
+            loop.push_back(p);
+        }
+    }
+    while (loop.size() > 3 && (loop.back() - loop.front()).Length() < b2_linearSlop) {
+        loop.pop_back();
+    }
+
+    if (loop.size() < 3) {
+        return false;
+    }
+
+    float32 area = polygon_area(loop);
+    if (area < 0.0f) {
+        std::reverse(loop.begin(), loop.end());
+        area = -area;
+    }
+
+    if (area <= B2_FLT_EPSILON) {
+        return false;
+    }
+
+    // A figure-of-eight or a curl has no inside to fill
+    n = loop.size();
+    for (int i=0; i<n; i++) {
+        for (int j=i+2; j<n; j++) {
+            if ((j + 1) % n == i) {
+                continue;
+            }
+            if (segments_cross(loop[i], loop[i+1], loop[j], loop[(j + 1) % n])) {
+                return false;
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> pieces;
+    if (!ear_clip(loop, pieces)) {
+        return false;
+    }
+
+    // Hertel-Mehlhorn: drop diagonals as long as the pieces stay convex
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i=0; i<pieces.size() && !merged; i++) {
+            for (size_t j=i+1; j<pieces.size() && !merged; j++) {
+                std::vector<int> piece;
+                if (convex_union(loop, pieces[i], pieces[j], piece)) {
+                    pieces[i] = piece;
+                    pieces.erase(pieces.begin() + j);
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    // Slivers left over from clipping nearly straight runs are too thin for
+    // Box2D; they may be skipped as long as almost nothing goes missing
+    std::vector<ShapePolygon> result;
+    float32 skipped = 0.0f;
+    for (auto &piece: pieces) {
+        std::vector<b2Vec2> polygon;
+        for (int index: piece) {
+            polygon.push_back(loop[index]);
+        }
+
+        if (!reduce_hull(polygon, 0.0f) || !valid_polygon(polygon)) {
+            skipped += polygon_area(polygon);
+            continue;
+        }
+
+        ShapePolygon shape;
+        shape.count = polygon.size();
+        std::copy(polygon.begin(), polygon.end(), shape.vertices);
+        result.push_back(shape);
+    }
+
+    if (result.empty() || skipped > 0.05f * area) {
+        return false;
+    }
+
+    polygons.insert(polygons.end(), result.begin(), result.end());
+    return true;
+}
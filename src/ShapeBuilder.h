@@ -0,0 +1,55 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_SHAPEBUILDER_H
+#define NUMPTYPHYSICS_SHAPEBUILDER_H
+
+#include "Common.h"
+
+#include <vector>
+
+struct ShapePolygon {
+    int count;
+    b2Vec2 vertices[b2_maxPolygonVertices];
+};
+
+/**
+ * Turns a stroke path into the convex polygons of its body. Every
+ * segment is a bar of the given half-thickness; runs of segments that
+ * stay within the tolerance of their chord are merged into the convex
+ * hull of their bars, as long as that hull is a valid Box2D polygon.
+ * Closed paths can instead be filled: the loop is ear clipped and the
+ * triangles are merged back into convex pieces (Hertel-Mehlhorn).
+ * Points, thickness and tolerance are in metres.
+ **/
+class ShapeBuilder {
+public:
+    ShapeBuilder(float32 halfThickness, float32 tolerance);
+
+    void build(const std::vector<b2Vec2> &points, std::vector<ShapePolygon> &polygons) const;
+
+    // Fails (and leaves polygons alone) if the loop crosses itself or
+    // can't be split into valid Box2D polygons
+    bool fill(const std::vector<b2Vec2> &loop, std::vector<ShapePolygon> &polygons) const;
+
+private:
+    void bar(const b2Vec2 &p1, const b2Vec2 &p2, b2Vec2 *corners) const;
+    bool merge(const std::vector<b2Vec2> &points, int first, int last, ShapePolygon &polygon) const;
+
+    float32 m_halfThickness;
+    float32 m_tolerance;
+};
+
+#endif /* NUMPTYPHYSICS_SHAPEBUILDER_H */
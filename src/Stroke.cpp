@@ -15,6 +15,7 @@
 
 #include "Stroke.h"
 #include "Scene.h"
+#include "Profiler.h"
 
 #include "thp_format.h"
 
@@ -38,6 +39,8 @@ static struct {
 
 Stroke::Stroke(const Path &path)
     : m_rawPath(path)
+    , m_generation(0)
+    , m_xformGeneration(-1)
     , m_body(nullptr)
 {
     m_colour = NP::Colour::DEFAULT;
@@ -48,7 +51,9 @@ Stroke::Stroke(const Path &path)
 }
 
 Stroke::Stroke(const std::string &str)
-    : m_body(nullptr)
+    : m_generation(0)
+    , m_xformGeneration(-1)
+    , m_body(nullptr)
 {
     int col = 0;
     m_colour = NP::Colour::DEFAULT;
@@ -88,7 +93,9 @@ Stroke::Stroke(const std::string &str)
 }
 
 Stroke::Stroke(const std::string &flags, const std::string &rgb, const std::string &svgpath)
-    : m_body(nullptr)
+    : m_generation(0)
+    , m_xformGeneration(-1)
+    , m_body(nullptr)
 {
     m_colour = NP::Colour::DEFAULT;
     m_attributes = 0;
@@ -126,10 +133,15 @@ Stroke::reset(b2World *world)
     }
 
     m_body = NULL;
-    m_xformAngle = 7.0f;
+    m_closed = false;
+    m_solid = false;
+    m_generation++;
     m_jointed[0] = m_jointed[1] = false;
     m_shapePath = m_rawPath;
+    m_screenPath.clear();
+    m_mesh.reset();
     m_hide = 0;
+    m_radius = 0.0f;
 }
 
 std::string
@@ -183,10 +195,83 @@ Stroke::setColour(int c)
     m_colour = c;
 }
 
+static void
+shape_points(const Path &path, std::vector<b2Vec2> &points)
+{
+    points.resize(path.numPoints());
+    for ( int i=0; i<path.numPoints(); i++ ) {
+        points[i] = path.point(i);
+        points[i] *= 1.0f/PIXELS_PER_METREf;
+    }
+}
+
 void
-Stroke::createBodies(b2World &world)
+Stroke::createBodies(b2World &world, bool fill)
 {
     process();
+
+    m_solid = false;
+    if ( fill && m_closed &&
+            !(m_attributes & (ATTRIB_DECOR | ATTRIB_TOKEN | ATTRIB_GOAL |
+                              ATTRIB_GROUND | ATTRIB_SLEEPING)) ) {
+        std::vector<b2Vec2> loop;
+        shape_points(m_shapePath, loop);
+        m_solid = canFill(world, loop);
+    }
+
+    createBody(world);
+}
+
+bool
+Stroke::canFill(b2World &world, const std::vector<b2Vec2> &loop)
+{
+    // A loop drawn around something stays a ring, so it can still trap it
+    b2Vec2 position = m_origin;
+    position *= 1.0f/PIXELS_PER_METREf;
+
+    b2AABB aabb;
+    aabb.lowerBound = aabb.upperBound = loop[0] + position;
+    for (auto &p: loop) {
+        aabb.lowerBound = b2Min(aabb.lowerBound, p + position);
+        aabb.upperBound = b2Max(aabb.upperBound, p + position);
+    }
+
+    b2Shape *shapes[64];
+    int count = world.Query(aabb, shapes, 64);
+    if (count == 64) {
+        return false;
+    }
+
+    for (int i=0; i<count; i++) {
+        b2Vec2 center;
+        if (shapes[i]->GetType() == e_polygonShape) {
+            center = ((b2PolygonShape *)shapes[i])->GetCentroid();
+        } else {
+            center = ((b2CircleShape *)shapes[i])->GetLocalPosition();
+        }
+        center = b2Mul(shapes[i]->GetBody()->GetXForm(), center) - position;
+
+        // Even-odd rule
+        bool inside = false;
+        for (size_t j=0, k=loop.size()-1; j<loop.size(); k=j++) {
+            if ((loop[j].y > center.y) != (loop[k].y > center.y) &&
+                    center.x < loop[k].x + (loop[j].x - loop[k].x) *
+                    (center.y - loop[k].y) / (loop[j].y - loop[k].y)) {
+                inside = !inside;
+            }
+        }
+
+        if (inside) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+Stroke::createBody(b2World &world)
+{
     if ( hasAttribute( ATTRIB_DECOR ) ){
         return; //decorators have no physical embodiment
     }
@@ -199,16 +284,34 @@ Stroke::createBodies(b2World &world)
         if ( m_attributes & ATTRIB_SLEEPING ) {
             bodyDef.isSleeping = true;
         }
+        if ( !(m_attributes & (ATTRIB_TOKEN | ATTRIB_GOAL)) ) {
+            // Slow strokes can't tunnel, so piles of them skip CCD. Tokens
+            // and goals keep it, completing a level must not depend on it.
+            bodyDef.continuous = e_continuousFast;
+        }
         m_body = world.CreateBody( &bodyDef );
-        for ( int i=1; i<n; i++ ) {
-            BoxDef boxDef;
-            boxDef.init( m_shapePath.point(i-1),
-                    m_shapePath.point(i),
-                    m_attributes );
-            m_body->CreateShape( &boxDef );
+
+        std::vector<b2Vec2> points;
+        shape_points(m_shapePath, points);
+
+        std::vector<ShapePolygon> polygons;
+        ShapeBuilder builder(STROKE_HALF_THICKNESSf, STROKE_MERGE_TOLERANCEf/PIXELS_PER_METREf);
+        if ( !m_solid || !builder.fill(points, polygons) ) {
+            m_solid = false;
+            builder.build(points, polygons);
+        }
+
+        for (auto &polygon: polygons) {
+            ShapeDef shapeDef;
+            shapeDef.init(polygon, m_attributes);
+            m_body->CreateShape( &shapeDef );
         }
         m_body->SetMassFromShapes();
 
+        m_radius = 0.0f;
+        for (auto &p: m_rawPath) {
+            m_radius = b2Max(m_radius, p.Length());
+        }
     }
     transform();
 }
@@ -286,14 +389,40 @@ Stroke::draw(Canvas &canvas, int a)
         return;
     }
 
-    transform();
-    canvas.drawPath(m_screenPath, m_colour, a);
+    if (m_hide) {
+        // Shrinking away, the screen path is scaled each frame
+        Vec2 o = m_screenBbox.centroid();
+        m_screenPath -= o;
+        m_screenPath.scale( 0.99 );
+        m_screenPath += o;
+        m_screenBbox = m_screenPath.bbox();
+        m_hide++;
+
+        canvas.drawPath(m_screenPath, m_colour, a);
+    } else {
+        // Tessellate once, the renderer places the mesh at the body transform
+        if (!m_mesh) {
+            if (m_solid) {
+                // Filled bodies are still drawn as their (now closed) outline
+                m_mesh = canvas.makeMesh(Path(m_rawPath) & m_rawPath.point(0));
+            } else {
+                m_mesh = canvas.makeMesh(m_rawPath);
+            }
+        }
+
+        if (m_body) {
+            canvas.drawMesh(m_mesh, PIXELS_PER_METREf * m_body->GetPosition(),
+                            m_body->GetAngle(), m_colour, a);
+        } else {
+            canvas.drawMesh(m_mesh, b2Vec2(m_origin.x, m_origin.y), 0.f, m_colour, a);
+        }
+    }
 
     if ( false /* drawJoints */ ) {
         int jointcolour = canvas.makeColour(0xff0000);
         for ( int e=0; e<2; e++ ) {
             if (m_jointed[e]) {
-                const Vec2& pt = m_screenPath.endpt(e);
+                const Vec2& pt = m_xformedPath.endpt(e);
                 //canvas.drawPixel( pt.x, pt.y, jointcolour );
                 //canvas.drawRect( pt.x-1, pt.y-1, 3, 3, jointcolour );
                 canvas.drawRect( pt.x-1, pt.y, 3, 1, jointcolour );
@@ -303,7 +432,7 @@ Stroke::draw(Canvas &canvas, int a)
     }
 }
 
-std::list<Stroke *>
+std::list<StrokeHandle>
 Stroke::ropeify(Scene &scene)
 {
     Path path = m_rawPath;
@@ -313,9 +442,9 @@ Stroke::ropeify(Scene &scene)
     int color = NP::Colour::toIndex(m_colour);
     int attr = m_attributes | ATTRIB_ROPE;
 
-    std::list<Stroke *> result;
+    std::list<StrokeHandle> result;
     for (int i=0; i<path.size()-1; i++) {
-        Stroke *s = scene.newStroke(Path(path[i] + m_origin), color, attr);
+        StrokeHandle s = scene.newStroke(Path(path[i] + m_origin), color, attr);
         scene.extendStroke(s, path[i+1] + m_origin);
         result.push_back(s);
     }
@@ -329,6 +458,14 @@ Stroke::addPoint(const Vec2 &pp)
     if ( p == m_rawPath.point( m_rawPath.numPoints()-1 ) ) {
     } else {
         m_rawPath.push_back( p );
+        m_mesh.reset();
+        m_generation++;
+
+        if ( m_rawPath.numPoints() > STROKE_POINT_LIMIT ) {
+            // Long scribbles are simplified as they are drawn, so they
+            // never grow past the limit and activate in bounded time
+            m_rawPath.simplify( SIMPLIFY_THRESHOLDf, STROKE_POINT_LIMIT / 2 );
+        }
     }
 }
 
@@ -342,6 +479,7 @@ Stroke::origin(const Vec2 &p)
         m_body->SetXForm( pw, m_body->GetAngle() );
     }
     m_origin = p;
+    m_generation++;
 }
 
 b2Body *
@@ -369,26 +507,29 @@ Rect
 Stroke::screenBbox()
 {
     transform();
-    return m_screenBbox;
+    return m_hide ? m_screenBbox : m_xformedBbox;
 }
 
 Rect
 Stroke::worldBbox()
 {
-    return m_xformedPath.bbox();
+    transform();
+    return m_xformedBbox;
 }
 
 void
 Stroke::hide()
 {
     if ( m_hide==0 ) {
+        // The shrinking animation starts from where the stroke is now
+        transform();
+        m_screenPath = m_xformedPath;
+        m_screenBbox = m_xformedBbox;
         m_hide = 1;
 
         if (m_body) {
-            // stash the body where no-one will find it
-            m_body->SetXForm( b2Vec2(0.0f,WORLD_HEIGHT*2.0f), 0.0f );
-            m_body->SetLinearVelocity( b2Vec2(0.0f,0.0f) );
-            m_body->SetAngularVelocity( 0.0f );
+            // Out of the broadphase and the solver, it has no contacts left
+            m_body->Freeze();
         }
     }
 }
@@ -414,56 +555,51 @@ Stroke::endpt(unsigned char end)
 void
 Stroke::process()
 {
-    float32 thresh = SIMPLIFY_THRESHOLDf;
-    m_rawPath.simplify( thresh );
+    m_rawPath.simplify( SIMPLIFY_THRESHOLDf );
     m_shapePath = m_rawPath;
+    m_mesh.reset();
+    m_generation++;
 
-    while ( m_shapePath.numPoints() > MULTI_VERTEX_LIMIT ) {
-        thresh += SIMPLIFY_THRESHOLDf;
-        m_shapePath.simplify( thresh );
+    if ( m_shapePath.numPoints() > MULTI_VERTEX_LIMIT ) {
+        m_shapePath.simplify( SIMPLIFY_THRESHOLDf, MULTI_VERTEX_LIMIT );
     }
+
+    // Ropes are cut into links, they are never filled
+    int n = m_shapePath.numPoints();
+    m_closed = n > 3 && !hasAttribute( ATTRIB_ROPE ) &&
+        (m_shapePath.point(0) - m_shapePath.point(n-1)).Length() <=
+        CLOSED_SHAPE_THREHOLDf * PIXELS_PER_METREf;
 }
 
 bool
 Stroke::transform()
 {
-    // distinguish between xformed raw and shape path as needed
+    PROFILE_ZONE("Stroke::transform");
+
     if ( m_hide ) {
-        if ( m_hide < HIDE_STEPS ) {
-            Vec2 o = m_screenBbox.centroid();
-            m_screenPath -= o;
-            m_screenPath.scale( 0.99 );
-            m_screenPath += o;
-            m_screenBbox = m_screenPath.bbox();
-            m_hide++;
-            return true;
-        }
+        // Frozen where it was hidden, draw() shrinks the screen path
+        return false;
     } else if ( m_body ) {
-        if ( hasAttribute( ATTRIB_DECOR ) ) {
-            return false; // decor never moves
-        } else if ( hasAttribute( ATTRIB_GROUND )
-                && m_xformAngle == m_body->GetAngle() ) {
-            return false; // ground strokes never move.
-        } else if ( m_xformAngle != m_body->GetAngle()
-                ||  ! (m_xformPos == m_body->GetPosition()) ) {
-            b2Mat22 rot( m_body->GetAngle() );
-            b2Vec2 orig = PIXELS_PER_METREf * m_body->GetPosition();
-            m_xformedPath = m_rawPath;
-            m_xformedPath.rotate( rot );
-            m_xformedPath.translate( Vec2(orig) );
-            m_xformAngle = m_body->GetAngle();
-            m_xformPos = m_body->GetPosition();
-            m_screenPath = m_xformedPath;
-            m_screenBbox = m_screenPath.bbox();
-        } else {
+        float32 angle = m_body->GetAngle();
+        const b2Vec2 &pos = m_body->GetPosition();
+        if ( m_xformGeneration == m_generation
+                && m_xformAngle == angle && m_xformPos == pos ) {
             return false;
         }
+
+        m_xformedPath.setTransformed( m_rawPath, b2Mat22( angle ),
+                                      Vec2( PIXELS_PER_METREf * pos ) );
+        m_xformAngle = angle;
+        m_xformPos = pos;
     } else {
-        m_xformedPath = m_rawPath;
-        m_xformedPath.translate( m_origin );
-        m_screenPath = m_xformedPath;
-        m_screenBbox = m_screenPath.bbox();
-        return !hasAttribute(ATTRIB_DECOR);
+        if ( m_xformGeneration == m_generation ) {
+            return false;
+        }
+
+        m_xformedPath.setTransformed( m_rawPath, m_origin );
     }
+
+    m_xformGeneration = m_generation;
+    m_xformedBbox = m_xformedPath.bbox();
     return true;
 }
@@ -20,6 +20,8 @@
 #include "Config.h"
 #include "Canvas.h"
 #include "Colour.h"
+#include "ShapeBuilder.h"
+#include "StrokeMap.h"
 
 #include <vector>
 #include <list>
@@ -67,29 +69,44 @@ struct JointDef : public b2RevoluteJointDef {
     }
 };
 
-struct BoxDef : public b2PolygonDef {
-    float32 vec2Angle(b2Vec2 v) { return b2Atan2(v.y, v.x); }
+// Collision categories of stroke shapes. Ground strokes don't collide
+// with each other, so overlapping ground doesn't even form pairs. A fixed
+// token or goal is both ground and token or goal.
+enum CollisionCategory {
+    CATEGORY_GROUND = 0x0001,
+    CATEGORY_STROKE = 0x0002,
+    CATEGORY_TOKEN = 0x0004,
+    CATEGORY_GOAL = 0x0008,
+};
 
-    void init(const Vec2 &p1, const Vec2 &p2, int attr)
+struct ShapeDef : public b2PolygonDef {
+    void init(const ShapePolygon &polygon, int attr)
     {
-        b2Vec2 barOrigin = p1;
-        b2Vec2 bar = p2 - p1;
-        bar *= 1.0f/PIXELS_PER_METREf;
-        barOrigin *= 1.0f/PIXELS_PER_METREf;;
-        SetAsBox( bar.Length()/2.0f, 0.1f,
-                0.5f*bar + barOrigin, vec2Angle( bar ));
-        //      SetAsBox( bar.Length()/2.0f+b2_toiSlop, b2_toiSlop*2.0f,
-        //	0.5f*bar + barOrigin, vec2Angle( bar ));
+        vertexCount = polygon.count;
+        for (int i=0; i<polygon.count; i++) {
+            vertices[i] = polygon.vertices[i];
+        }
         friction = 0.3f;
-        if (attr & ATTRIB_GROUND) {
-            density = 0.0f;
-        } else if (attr & ATTRIB_GOAL) {
+        filter.maskBits = 0xFFFF;
+        if (attr & ATTRIB_GOAL) {
             density = 100.0f;
+            filter.categoryBits = CATEGORY_GOAL;
         } else if (attr & ATTRIB_TOKEN) {
             density = 3.0f;
             friction = 0.1f;
+            filter.categoryBits = CATEGORY_TOKEN;
         } else {
             density = 5.0f;
+            filter.categoryBits = CATEGORY_STROKE;
+        }
+        if (attr & ATTRIB_GROUND) {
+            density = 0.0f;
+            if (filter.categoryBits == CATEGORY_STROKE) {
+                filter.categoryBits = CATEGORY_GROUND;
+            } else {
+                filter.categoryBits |= CATEGORY_GROUND;
+            }
+            filter.maskBits = 0xFFFF & ~CATEGORY_GROUND;
         }
         restitution = 0.2f;
     }
@@ -111,12 +128,14 @@ public:
     void setColour(int c);
     int colour() { return m_colour; }
 
-    void createBodies(b2World &world);
+    // A closed loop is only filled if fill is set, and never for tokens,
+    // goals, fixed or sleeping strokes
+    void createBodies(b2World &world, bool fill=false);
     void determineJoints(Stroke *other, std::vector<Joint> &joints);
     void join(b2World *world, Stroke *other, unsigned char end);
     bool maybeCreateJoint(b2World &world, Stroke *other);
     void draw(Canvas &canvas, int a);
-    std::list<Stroke *> ropeify(Scene &scene);
+    std::list<StrokeHandle> ropeify(Scene &scene);
 
     void addPoint(const Vec2 &pp);
     void origin(const Vec2 &p);
@@ -135,8 +154,16 @@ public:
 
     Vec2 origin() { return m_origin; }
 
+    // Furthest distance of the path from the body origin, in pixels
+    float32 radius() { return m_radius; }
+
+    StrokeHandle handle() { return m_handle; }
+    void setHandle(StrokeHandle h) { m_handle = h; }
+
 private:
     void process();
+    bool canFill(b2World &world, const std::vector<b2Vec2> &loop);
+    void createBody(b2World &world);
     bool transform();
 
 private:
@@ -145,14 +172,22 @@ private:
     int       m_attributes;
     Vec2      m_origin;
     Path      m_shapePath;
-    Path      m_xformedPath;
-    Path      m_screenPath;
+    Path      m_xformedPath;   // world space, kept up to date by transform()
+    Path      m_screenPath;    // only while hiding, shrinks every frame
+    NP::Mesh  m_mesh;
+    int       m_generation;    // bumped when the raw path or origin changes
+    int       m_xformGeneration;
     float32   m_xformAngle;
     b2Vec2    m_xformPos;
+    Rect      m_xformedBbox;
     Rect      m_screenBbox;
     b2Body*   m_body;
+    bool      m_closed;
+    bool      m_solid;
     bool      m_jointed[2];
     int       m_hide;
+    float32   m_radius;
+    StrokeHandle m_handle;
 };
 
 
@@ -0,0 +1,179 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "StrokeIndex.h"
+#include "Stroke.h"
+#include "Config.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+static Rect
+cellsOf(const Rect &r)
+{
+    // Paths are rounded to whole pixels, leave room for that
+    return Rect((r.tl.x - 1) >> STROKE_INDEX_CELL_SHIFT, (r.tl.y - 1) >> STROKE_INDEX_CELL_SHIFT,
+                (r.br.x + 1) >> STROKE_INDEX_CELL_SHIFT, (r.br.y + 1) >> STROKE_INDEX_CELL_SHIFT);
+}
+
+StrokeIndex::StrokeIndex()
+    : m_items()
+    , m_cells()
+    , m_dirty()
+    , m_found()
+    , m_order(0)
+    , m_stamp(0)
+{
+}
+
+void
+StrokeIndex::add(Stroke *s)
+{
+    Item &item = m_items[s];
+    item.stroke = s;
+    item.order = m_order++;
+    item.binned = false;
+    item.dirty = false;
+    item.stamp = m_stamp;
+    moved(s);
+}
+
+void
+StrokeIndex::remove(Stroke *s)
+{
+    auto it = m_items.find(s);
+    if (it == m_items.end()) {
+        return;
+    }
+
+    Item *item = &it->second;
+    unbin(item);
+    if (item->dirty) {
+        m_dirty.erase(std::find(m_dirty.begin(), m_dirty.end(), item));
+    }
+    m_items.erase(it);
+}
+
+void
+StrokeIndex::moved(Stroke *s)
+{
+    auto it = m_items.find(s);
+    if (it != m_items.end() && !it->second.dirty) {
+        it->second.dirty = true;
+        m_dirty.push_back(&it->second);
+    }
+}
+
+void
+StrokeIndex::clear()
+{
+    m_items.clear();
+    m_cells.clear();
+    m_dirty.clear();
+    m_order = 0;
+}
+
+void
+StrokeIndex::query(const Rect &area, std::vector<Stroke *> &result)
+{
+    update();
+
+    m_stamp++;
+    m_found.clear();
+
+    Rect cells = cellsOf(area);
+    for (int y=cells.tl.y; y<=cells.br.y; y++) {
+        for (int x=cells.tl.x; x<=cells.br.x; x++) {
+            auto it = m_cells.find(((long long)x << 32) ^ (unsigned int)y);
+            if (it == m_cells.end()) {
+                continue;
+            }
+
+            for (auto &item: it->second) {
+                if (item->stamp != m_stamp) {
+                    item->stamp = m_stamp;
+                    m_found.push_back(item);
+                }
+            }
+        }
+    }
+
+    std::sort(m_found.begin(), m_found.end(), [] (const Item *a, const Item *b) {
+        return a->order < b->order;
+    });
+
+    result.clear();
+    for (auto &item: m_found) {
+        result.push_back(item->stroke);
+    }
+}
+
+void
+StrokeIndex::query(const Vec2 &pt, float32 radius, std::vector<Stroke *> &result)
+{
+    int r = int(std::ceil(radius));
+    query(Rect(pt - Vec2(r, r), pt + Vec2(r, r)), result);
+}
+
+void
+StrokeIndex::update()
+{
+    for (auto &item: m_dirty) {
+        Rect cells = cellsOf(item->stroke->worldBbox());
+        if (!item->binned || cells.tl != item->cells.tl || cells.br != item->cells.br) {
+            unbin(item);
+            bin(item, cells);
+        }
+        item->dirty = false;
+    }
+    m_dirty.clear();
+}
+
+void
+StrokeIndex::bin(Item *item, const Rect &cells)
+{
+    for (int y=cells.tl.y; y<=cells.br.y; y++) {
+        for (int x=cells.tl.x; x<=cells.br.x; x++) {
+            cell(x, y).push_back(item);
+        }
+    }
+    item->cells = cells;
+    item->binned = true;
+}
+
+void
+StrokeIndex::unbin(Item *item)
+{
+    if (!item->binned) {
+        return;
+    }
+
+    for (int y=item->cells.tl.y; y<=item->cells.br.y; y++) {
+        for (int x=item->cells.tl.x; x<=item->cells.br.x; x++) {
+            std::vector<Item *> &items = cell(x, y);
+            auto it = std::find(items.begin(), items.end(), item);
+            *it = items.back();
+            items.pop_back();
+        }
+    }
+    item->binned = false;
+}
+
+std::vector<StrokeIndex::Item *> &
+StrokeIndex::cell(int x, int y)
+{
+    return m_cells[((long long)x << 32) ^ (unsigned int)y];
+}
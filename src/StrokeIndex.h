@@ -0,0 +1,71 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_STROKEINDEX_H
+#define NUMPTYPHYSICS_STROKEINDEX_H
+
+#include "Common.h"
+
+#include <vector>
+#include <unordered_map>
+
+class Stroke;
+
+/**
+ * Uniform grid over the world bounding boxes of strokes, so picking and
+ * joint detection only measure the strokes near a point instead of all
+ * of them. Strokes that may have moved are marked with moved() and are
+ * binned again on the next query. Queries return candidates in the
+ * order the strokes were added, the caller still does the exact test.
+ **/
+class StrokeIndex {
+public:
+    StrokeIndex();
+
+    // Strokes are ordered after all strokes added before them
+    void add(Stroke *s);
+    void remove(Stroke *s);
+    void moved(Stroke *s);
+    void clear();
+
+    // Strokes whose bounding box touches the area (or comes within
+    // radius of the point), in the order they were added
+    void query(const Rect &area, std::vector<Stroke *> &result);
+    void query(const Vec2 &pt, float32 radius, std::vector<Stroke *> &result);
+
+private:
+    struct Item {
+        Stroke *stroke;
+        int order;
+        Rect cells;
+        bool binned;
+        bool dirty;
+        int stamp;
+    };
+
+    void update();
+    void bin(Item *item, const Rect &cells);
+    void unbin(Item *item);
+    std::vector<Item *> &cell(int x, int y);
+
+    std::unordered_map<Stroke *, Item> m_items;
+    std::unordered_map<long long, std::vector<Item *>> m_cells;
+    std::vector<Item *> m_dirty;
+    std::vector<Item *> m_found;
+    int m_order;
+    int m_stamp;
+};
+
+#endif /* NUMPTYPHYSICS_STROKEINDEX_H */
@@ -0,0 +1,138 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "StrokeMap.h"
+#include "Stroke.h"
+
+
+StrokeMap::StrokeMap()
+    : m_slots()
+    , m_free(-1)
+    , m_first(-1)
+    , m_last(-1)
+    , m_count(0)
+{
+}
+
+StrokeHandle
+StrokeMap::insert(Stroke *s)
+{
+    int index = m_free;
+    if (index == -1) {
+        index = m_slots.size();
+        m_slots.push_back(Slot{nullptr, 0, -1, -1, false});
+    } else {
+        m_free = m_slots[index].next;
+    }
+
+    Slot &slot = m_slots[index];
+    slot.stroke = s;
+    slot.prev = m_last;
+    slot.next = -1;
+    slot.protect = false;
+
+    if (m_last == -1) {
+        m_first = index;
+    } else {
+        m_slots[m_last].next = index;
+    }
+    m_last = index;
+    m_count++;
+
+    StrokeHandle h(index, slot.generation);
+    s->setHandle(h);
+    return h;
+}
+
+void
+StrokeMap::erase(StrokeHandle h)
+{
+    if (!get(h)) {
+        return;
+    }
+
+    Slot &slot = m_slots[h.index];
+    if (slot.prev == -1) {
+        m_first = slot.next;
+    } else {
+        m_slots[slot.prev].next = slot.next;
+    }
+    if (slot.next == -1) {
+        m_last = slot.prev;
+    } else {
+        m_slots[slot.next].prev = slot.prev;
+    }
+
+    slot.stroke = nullptr;
+    slot.generation++;
+    slot.next = m_free;
+    m_free = h.index;
+    m_count--;
+}
+
+Stroke *
+StrokeMap::get(StrokeHandle h) const
+{
+    if (h.index < 0 || h.index >= m_slots.size() || m_slots[h.index].generation != h.generation) {
+        return nullptr;
+    }
+
+    return m_slots[h.index].stroke;
+}
+
+bool
+StrokeMap::isProtected(StrokeHandle h) const
+{
+    return get(h) && m_slots[h.index].protect;
+}
+
+void
+StrokeMap::setProtected(StrokeHandle h, bool protect)
+{
+    if (get(h)) {
+        m_slots[h.index].protect = protect;
+    }
+}
+
+StrokeHandle
+StrokeMap::back() const
+{
+    if (m_last == -1) {
+        return StrokeHandle();
+    }
+
+    return StrokeHandle(m_last, m_slots[m_last].generation);
+}
+
+void
+StrokeMap::clear(bool deleteStrokes)
+{
+    m_free = -1;
+    for (int i=m_slots.size()-1; i>=0; i--) {
+        Slot &slot = m_slots[i];
+        if (slot.stroke) {
+            if (deleteStrokes) {
+                delete slot.stroke;
+            }
+            slot.stroke = nullptr;
+            slot.generation++;
+        }
+        slot.next = m_free;
+        m_free = i;
+    }
+
+    m_first = m_last = -1;
+    m_count = 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_STROKEMAP_H
+#define NUMPTYPHYSICS_STROKEMAP_H
+
+#include <vector>
+
+class Stroke;
+
+struct StrokeHandle {
+    StrokeHandle() : index(-1), generation(0) {}
+    StrokeHandle(int index, unsigned int generation) : index(index), generation(generation) {}
+
+    bool operator==(const StrokeHandle &o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const StrokeHandle &o) const { return !(*this == o); }
+
+    int index;
+    unsigned int generation;
+};
+
+/**
+ * Generational slot map holding the strokes of a scene in the order
+ * they were added. A handle stays valid until its stroke is erased,
+ * stale handles resolve to nullptr. Inserting, erasing and looking up
+ * a stroke (and its protected flag) are O(1), the map doesn't own the
+ * strokes.
+ **/
+class StrokeMap {
+public:
+    class iterator {
+    public:
+        iterator(StrokeMap *map, int slot) : m_map(map), m_slot(slot) {}
+
+        Stroke *&operator*() const { return m_map->m_slots[m_slot].stroke; }
+        iterator &operator++() { m_slot = m_map->m_slots[m_slot].next; return *this; }
+        bool operator!=(const iterator &o) const { return m_slot != o.m_slot; }
+
+        StrokeHandle handle() const { return StrokeHandle(m_slot, m_map->m_slots[m_slot].generation); }
+
+    private:
+        StrokeMap *m_map;
+        int m_slot;
+    };
+
+    StrokeMap();
+
+    // Appends the stroke and tells it its handle
+    StrokeHandle insert(Stroke *s);
+    void erase(StrokeHandle h);
+    Stroke *get(StrokeHandle h) const;
+
+    bool isProtected(StrokeHandle h) const;
+    void setProtected(StrokeHandle h, bool protect);
+
+    StrokeHandle back() const;
+    int size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    // Invalidates all handles, deleteStrokes also deletes the strokes
+    void clear(bool deleteStrokes=false);
+
+    iterator begin() { return iterator(this, m_first); }
+    iterator end() { return iterator(this, -1); }
+
+private:
+    struct Slot {
+        Stroke *stroke;
+        unsigned int generation;
+        int prev;
+        int next; // next free slot, if stroke is null
+        bool protect;
+    };
+
+    std::vector<Slot> m_slots;
+    int m_free;
+    int m_first;
+    int m_last;
+    int m_count;
+};
+
+#endif /* NUMPTYPHYSICS_STROKEMAP_H */
@@ -0,0 +1,372 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "Thumbnails.h"
+#include "Config.h"
+#include "Canvas.h"
+#include "Scene.h"
+#include "Os.h"
+
+#include "petals_log.h"
+#include "thp_format.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+
+static const char THUMBNAIL_MAGIC[8] = { 'N', 'P', 'T', 'H', 'U', 'M', 'B', '1' };
+
+static uint64_t
+fnv1a64(const std::string &data)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c: data) {
+        h = (h ^ c) * 1099511628211ull;
+    }
+    return h;
+}
+
+// Box filter, each destination pixel averages the source pixels it covers
+static void
+downscale(const std::vector<unsigned char> &src, int sw, int sh,
+          std::vector<unsigned char> &dst, int dw, int dh)
+{
+    dst.resize(dw * dh * 4);
+
+    for (int y=0; y<dh; y++) {
+        int y1 = y * sh / dh, y2 = std::max(y1 + 1, (y + 1) * sh / dh);
+        for (int x=0; x<dw; x++) {
+            int x1 = x * sw / dw, x2 = std::max(x1 + 1, (x + 1) * sw / dw);
+
+            unsigned int sum[4] = { 0, 0, 0, 0 };
+            for (int sy=y1; sy<y2; sy++) {
+                for (int sx=x1; sx<x2; sx++) {
+                    for (int c=0; c<4; c++) {
+                        sum[c] += src[(sy * sw + sx) * 4 + c];
+                    }
+                }
+            }
+
+            int count = (y2 - y1) * (x2 - x1);
+            for (int c=0; c<4; c++) {
+                dst[(y * dw + x) * 4 + c] = sum[c] / count;
+            }
+        }
+    }
+}
+
+
+Thumbnail::Thumbnail(const std::string &file)
+    : file(file)
+    , mtime(-1)
+    , hash(0)
+    , scene()
+    , pixels()
+    , w(0)
+    , h(0)
+{
+}
+
+Thumbnail::~Thumbnail()
+{
+}
+
+
+ThumbnailCache::ThumbnailCache(const std::string &dir)
+    : m_dir(dir)
+    , m_mutex()
+    , m_index()
+    , m_indexLines(0)
+{
+    OS->ensurePath(m_dir);
+    loadIndex();
+}
+
+Vec2
+ThumbnailCache::size()
+{
+    return Vec2(WORLD_WIDTH / ICON_SCALE_FACTOR, WORLD_HEIGHT / ICON_SCALE_FACTOR);
+}
+
+void
+ThumbnailCache::loadIndex()
+{
+    // One "<mtime> <hash> <file>" line per update, later lines win
+    std::ifstream is(Config::joinPath(m_dir, "index").c_str());
+
+    std::string line;
+    while (std::getline(is, line)) {
+        std::istringstream ls(line);
+        Entry entry;
+        std::string file;
+        if (ls >> entry.mtime >> std::hex >> entry.hash && ls.get() == ' ' &&
+                std::getline(ls, file) && !file.empty()) {
+            m_index[file] = entry;
+        }
+        m_indexLines++;
+    }
+
+    if (m_indexLines > 2 * int(m_index.size()) + 16) {
+        // Mostly superseded lines, rewrite the index
+        std::ofstream os(Config::joinPath(m_dir, "index").c_str(), std::ios::trunc);
+        for (auto &it: m_index) {
+            os << it.second.mtime << ' ' << std::hex << it.second.hash << std::dec
+               << ' ' << it.first << '\n';
+        }
+        m_indexLines = m_index.size();
+    }
+}
+
+void
+ThumbnailCache::update(const std::string &file, const Entry &entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(file);
+    if (it != m_index.end() && it->second.hash != entry.hash) {
+        uint64_t stale = it->second.hash;
+        it->second = entry;
+
+        // Drop the outdated image unless another level shares it
+        if (std::none_of(m_index.begin(), m_index.end(),
+                    [stale] (const std::pair<const std::string, Entry> &e) { return e.second.hash == stale; })) {
+            std::remove(imagePath(stale).c_str());
+        }
+    }
+
+    m_index[file] = entry;
+
+    std::ofstream os(Config::joinPath(m_dir, "index").c_str(), std::ios::app);
+    os << entry.mtime << ' ' << std::hex << entry.hash << std::dec << ' ' << file << '\n';
+    m_indexLines++;
+}
+
+std::string
+ThumbnailCache::imagePath(uint64_t hash)
+{
+    return Config::joinPath(m_dir, thp::format("%016llx.thumb", (unsigned long long)hash));
+}
+
+bool
+ThumbnailCache::loadImage(Thumbnail &thumb)
+{
+    std::ifstream is(imagePath(thumb.hash).c_str(), std::ios::binary);
+
+    char magic[sizeof(THUMBNAIL_MAGIC)];
+    int32_t wh[2];
+    if (!is.read(magic, sizeof(magic)) || memcmp(magic, THUMBNAIL_MAGIC, sizeof(magic)) != 0 ||
+            !is.read(reinterpret_cast<char *>(wh), sizeof(wh)) ||
+            wh[0] <= 0 || wh[1] <= 0 || wh[0] > WORLD_WIDTH || wh[1] > WORLD_HEIGHT) {
+        return false;
+    }
+
+    thumb.pixels.resize(wh[0] * wh[1] * 4);
+    if (!is.read(reinterpret_cast<char *>(thumb.pixels.data()), thumb.pixels.size())) {
+        thumb.pixels.clear();
+        return false;
+    }
+
+    thumb.w = wh[0];
+    thumb.h = wh[1];
+    return true;
+}
+
+bool
+ThumbnailCache::storeImage(const Thumbnail &thumb)
+{
+    std::ofstream os(imagePath(thumb.hash).c_str(), std::ios::binary | std::ios::trunc);
+
+    int32_t wh[2] = { thumb.w, thumb.h };
+    os.write(THUMBNAIL_MAGIC, sizeof(THUMBNAIL_MAGIC));
+    os.write(reinterpret_cast<const char *>(wh), sizeof(wh));
+    os.write(reinterpret_cast<const char *>(thumb.pixels.data()), thumb.pixels.size());
+
+    if (!os) {
+        LOG_WARNING("Could not write thumbnail: %s", imagePath(thumb.hash).c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool
+ThumbnailCache::fetch(Thumbnail &thumb)
+{
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(thumb.file);
+        if (it != m_index.end()) {
+            known = true;
+            thumb.mtime = it->second.mtime;
+            thumb.hash = it->second.hash;
+        }
+    }
+
+    long mtime = OS->mtime(thumb.file);
+    bool unchanged = (known && mtime == thumb.mtime);
+    if (unchanged && loadImage(thumb)) {
+        return true;
+    }
+
+    std::string level = Config::readFile(thumb.file);
+    thumb.mtime = mtime;
+    thumb.hash = fnv1a64(level);
+
+    // A touched level or a copy of another one might not need drawing
+    if (!unchanged && loadImage(thumb)) {
+        update(thumb.file, Entry{thumb.mtime, thumb.hash});
+        return true;
+    }
+
+    thumb.scene.reset(new Scene(true));
+    if (!thumb.scene->load(level)) {
+        thumb.scene.reset();
+    }
+
+    return false;
+}
+
+bool
+ThumbnailCache::draw(Thumbnail &thumb)
+{
+    auto world = Vec2(WORLD_WIDTH, WORLD_HEIGHT);
+    RenderTarget target(world, Rect(Vec2(0, 0), world));
+
+    target.begin();
+    thumb.scene->draw(target, true);
+    target.end();
+    thumb.scene.reset();
+
+    thumb.pixels.resize(world.x * world.y * 4);
+    if (!target.read(thumb.pixels.data())) {
+        // Renderer without readback (headless)
+        thumb.pixels.clear();
+        return false;
+    }
+
+    thumb.w = world.x;
+    thumb.h = world.y;
+    return true;
+}
+
+void
+ThumbnailCache::store(Thumbnail &thumb)
+{
+    Vec2 size = ThumbnailCache::size();
+    std::vector<unsigned char> rgba;
+    downscale(thumb.pixels, thumb.w, thumb.h, rgba, size.x, size.y);
+
+    thumb.pixels.swap(rgba);
+    thumb.w = size.x;
+    thumb.h = size.y;
+
+    if (storeImage(thumb)) {
+        update(thumb.file, Entry{thumb.mtime, thumb.hash});
+    }
+}
+
+NP::Texture
+ThumbnailCache::upload(const Thumbnail &thumb)
+{
+    return OS->renderer()->load(const_cast<unsigned char *>(thumb.pixels.data()), thumb.w, thumb.h);
+}
+
+
+ThumbnailLoader::ThumbnailLoader(ThumbnailCache &cache, int threads)
+    : m_cache(cache)
+    , m_mutex()
+    , m_finished()
+    , m_generation(0)
+    , m_pool(threads)
+{
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    // Queued jobs still get run by the pool, make them return right away
+    cancel();
+}
+
+void
+ThumbnailLoader::request(int id, const std::string &file)
+{
+    submit(std::make_shared<Job>(id, m_generation, file), true);
+}
+
+void
+ThumbnailLoader::cancel()
+{
+    m_generation++;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished.clear();
+}
+
+void
+ThumbnailLoader::submit(std::shared_ptr<Job> job, bool fetch)
+{
+    m_pool.submit([this, job, fetch] () {
+        if (job->generation != m_generation) {
+            return;
+        }
+
+        if (fetch) {
+            m_cache.fetch(job->thumb);
+        } else {
+            m_cache.store(job->thumb);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (job->generation == m_generation) {
+            m_finished.push_back(job);
+        }
+    });
+}
+
+void
+ThumbnailLoader::poll(std::function<void(int id, NP::Texture texture)> done)
+{
+    std::vector<std::shared_ptr<Job>> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        finished.swap(m_finished);
+    }
+
+    bool drawn = false;
+    for (auto &job: finished) {
+        Thumbnail &thumb = job->thumb;
+
+        if (thumb.scene) {
+            if (drawn) {
+                // Drawing is expensive, leave the rest for the next frame
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_finished.push_back(job);
+            } else if (ThumbnailCache::draw(thumb)) {
+                drawn = true;
+                submit(job, false);
+            } else {
+                done(job->id, nullptr);
+            }
+        } else if (!thumb.pixels.empty()) {
+            done(job->id, ThumbnailCache::upload(thumb));
+        } else {
+            done(job->id, nullptr);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of NumptyPhysics <http://thp.io/2015/numptyphysics/>
+ * Coyright (c) 2015 Thomas Perl <m@thp.io>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef NUMPTYPHYSICS_THUMBNAILS_H
+#define NUMPTYPHYSICS_THUMBNAILS_H
+
+#include "Renderer.h"
+
+#include "thp_jobpool.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+class Scene;
+
+
+struct Thumbnail {
+    Thumbnail(const std::string &file);
+    ~Thumbnail();
+
+    std::string file;
+    long mtime;
+    uint64_t hash;
+
+    // Parsed level, waiting to be drawn on the render thread
+    std::unique_ptr<Scene> scene;
+
+    // RGBA pixels, either the world-sized readback or the final thumbnail
+    std::vector<unsigned char> pixels;
+    int w;
+    int h;
+};
+
+/**
+ * Pre-scaled level previews stored below the user data dir. Images are
+ * named by the hash of the level contents; an index maps each level file
+ * to its mtime and content hash, so unchanged levels are found without
+ * reading them and touched levels only need to be re-hashed.
+ *
+ * fetch() and store() only touch files and memory and may be called from
+ * any thread; draw() and upload() need the renderer.
+ **/
+class ThumbnailCache {
+public:
+    ThumbnailCache(const std::string &dir);
+
+    // Load the stored image (true), or parse the level for drawing (false)
+    bool fetch(Thumbnail &thumb);
+
+    // Scale down the drawn level and save it
+    void store(Thumbnail &thumb);
+
+    static bool draw(Thumbnail &thumb);
+    static NP::Texture upload(const Thumbnail &thumb);
+
+    static Vec2 size();
+
+private:
+    struct Entry {
+        long mtime;
+        uint64_t hash;
+    };
+
+    void loadIndex();
+    void update(const std::string &file, const Entry &entry);
+
+    std::string imagePath(uint64_t hash);
+    bool loadImage(Thumbnail &thumb);
+    bool storeImage(const Thumbnail &thumb);
+
+    std::string m_dir;
+    std::mutex m_mutex;
+    std::map<std::string, Entry> m_index;
+    int m_indexLines;
+};
+
+/**
+ * Produces thumbnails in the background: stored images are read and
+ * levels are parsed and scaled down on worker threads, while drawing
+ * and texture uploads happen in poll() on the render thread.
+ **/
+class ThumbnailLoader {
+public:
+    ThumbnailLoader(ThumbnailCache &cache, int threads);
+    ~ThumbnailLoader();
+
+    void request(int id, const std::string &file);
+
+    // Drop all outstanding requests
+    void cancel();
+
+    // Hand out finished thumbnails (nullptr if the level can't be shown),
+    // drawing at most one new level per call
+    void poll(std::function<void(int id, NP::Texture texture)> done);
+
+private:
+    struct Job {
+        Job(int id, int generation, const std::string &file)
+            : id(id), generation(generation), thumb(file) {}
+
+        int id;
+        int generation;
+        Thumbnail thumb;
+    };
+
+    void submit(std::shared_ptr<Job> job, bool fetch);
+
+    ThumbnailCache &m_cache;
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<Job>> m_finished;
+    std::atomic<int> m_generation;
+
+    // Last member, so that the workers are gone before the rest
+    thp::JobPool m_pool;
+};
+
+#endif /* NUMPTYPHYSICS_THUMBNAILS_H */
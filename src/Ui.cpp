@@ -20,6 +20,7 @@
 #include "Os.h"
 #include "Config.h"
 #include "Colour.h"
+#include "Profiler.h"
 
 #include "petals_log.h"
 #include "thp_iterutils.h"
@@ -790,6 +791,13 @@ void ScrollArea::virtualSize( const Vec2& size )
   m_contents->sizeTo(size);
 }
 
+Rect ScrollArea::viewport() const
+{
+  // Visible part of the contents, in content coordinates
+  Vec2 org = m_contents->position().tl;
+  return Rect(m_pos.tl - org, m_pos.br - org);
+}
+
 void ScrollArea::draw( Canvas& screen, const Rect& area )
 {
   TemporaryClip clip(screen, m_pos);
@@ -863,6 +871,7 @@ void Container::onTick( int tick )
 
 void Container::draw( Canvas& screen, const Rect& area )
 {
+  PROFILE_ZONE("Container::draw");
   WidgetParent::draw(screen,area);
   for (int i=0; i<m_children.size(); ++i) {
     if (m_children[i]->position().intersects(area)) {
@@ -1297,6 +1306,8 @@ MessageBox::MessageBox( const Tr& text )
 ////////////////////////////////////////////////////////////////
 
 
+static constexpr NP::TextureHandle ICONS_TEXTURE("icons.png");
+
 void
 StockIcon::draw(Canvas &screen, const Rect &area, enum Kind kind, const Vec2 &pos)
 {
@@ -1323,8 +1334,9 @@ StockIcon::draw(Canvas &screen, const Rect &area, enum Kind kind, const Vec2 &po
     Rect dst(pos.x - size() / 2, pos.y - size() / 2,
              pos.x + size() / 2, pos.y + size() / 2);
 
-    Image icons("icons.png", true);
-    screen.drawAtlas(icons, src, dst);
+    // Resolved on first use and kept, like the cache keeps the texture
+    static Image *icons = new Image(ICONS_TEXTURE);
+    screen.drawAtlas(*icons, src, dst);
 }
 
 int
@@ -333,6 +333,7 @@ class ScrollArea : public Panel
   virtual void empty();
 
   virtual void virtualSize( const Vec2& size );
+  Rect viewport() const;
  protected:
   Canvas* m_canvas;
   Draggable* m_contents;